@@ -0,0 +1,116 @@
+// arena.c
+
+#include <err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+// alignment of every allocation, enough for any scalar type
+#define ALIGNMENT 16
+
+struct ARENA_struct {
+  uint8_t *base;
+  size_t size;
+  size_t used;
+  size_t peak;
+};
+
+// allocate an arena of size bytes
+ARENA_type *ARENA_create(size_t size) {
+
+  ARENA_type *arena = malloc(sizeof(ARENA_type));
+  if (arena == NULL) {
+    warn("failed to allocate arena structure");
+    return NULL;
+  }
+
+  arena->base = malloc(size);
+  if (arena->base == NULL) {
+    warn("failed to allocate arena: %zu bytes", size);
+    free(arena);
+    return NULL;
+  }
+  memset(arena->base, 0, size);
+  arena->size = size;
+  arena->used = 0;
+  arena->peak = 0;
+
+  return arena;
+}
+
+// release an arena
+bool ARENA_destroy(ARENA_type *arena) {
+  if (arena == NULL) {
+    return false;
+  }
+  free(arena->base);
+  free(arena);
+  return true;
+}
+
+// take size bytes aligned for any type
+void *ARENA_allocate(ARENA_type *arena, size_t size) {
+
+  size_t start = (arena->used + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+  if (start > arena->size || size > arena->size - start) {
+    return NULL;
+  }
+  arena->used = start + size;
+  if (arena->used > arena->peak) {
+    arena->peak = arena->used;
+  }
+  return arena->base + start;
+}
+
+// give back everything allocated since the last reset
+void ARENA_reset(ARENA_type *arena) {
+  arena->used = 0;
+}
+
+// most bytes in use at once since the arena was created
+size_t ARENA_peak(const ARENA_type *arena) {
+  return arena->peak;
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  ARENA_type *arena = ARENA_create(1000);
+  assert(arena != NULL);
+
+  // aligned, distinct and taken in order
+  uint8_t *a = ARENA_allocate(arena, 1);
+  uint8_t *b = ARENA_allocate(arena, 100);
+  assert(a != NULL && b != NULL);
+  assert((uintptr_t)a % ALIGNMENT == 0 && (uintptr_t)b % ALIGNMENT == 0);
+  assert(b >= a + 1);
+  memset(b, 0xff, 100);
+
+  // full, and a failure takes nothing
+  assert(ARENA_allocate(arena, 1000) == NULL);
+  uint8_t *c = ARENA_allocate(arena, 800);
+  assert(c != NULL);
+  assert(ARENA_allocate(arena, 100) == NULL);
+  assert(ARENA_peak(arena) == (size_t)(c - a) + 800);
+
+  // a reset gives the same memory again, the peak is kept
+  ARENA_reset(arena);
+  assert(ARENA_allocate(arena, 1) == a);
+  assert(ARENA_peak(arena) == (size_t)(c - a) + 800);
+
+  printf("arena peak: %zu bytes\n", ARENA_peak(arena));
+  assert(ARENA_destroy(arena));
+  return 0;
+}
+#endif
@@ -0,0 +1,41 @@
+// arena.h
+
+#if !defined(ARENA_H)
+#define ARENA_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// scratch arena
+// =============
+//
+// memory for things that only live until the end of a frame, handed
+// out by moving a pointer and all given back at once by a reset, so
+// drawing a frame never calls malloc; an arena must only be used by
+// one thread at a time
+
+// type to hold an arena
+typedef struct ARENA_struct ARENA_type;
+
+// functions
+// =========
+
+// allocate an arena of size bytes, the memory is touched so that it
+// is resident before the first frame
+// returns NULL on failure
+ARENA_type *ARENA_create(size_t size);
+
+// release an arena
+bool ARENA_destroy(ARENA_type *arena);
+
+// take size bytes aligned for any type
+// returns NULL if the arena is full
+void *ARENA_allocate(ARENA_type *arena, size_t size);
+
+// give back everything allocated since the last reset
+void ARENA_reset(ARENA_type *arena);
+
+// most bytes in use at once since the arena was created
+size_t ARENA_peak(const ARENA_type *arena);
+
+#endif
@@ -0,0 +1,405 @@
+// atlas-main.c
+//
+// bake glyphs of fonts at fixed pixel sizes into an atlas file that
+// lcd_clock can memory map instead of rasterising with FreeType
+
+#include <err.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_BITMAP_H
+
+#include "atlas.h"
+#include "unicode.h"
+
+#define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof((a)[0]))
+
+// always baked: printable ASCII and the weekdays shown by lcd_clock
+static const char default_text[] = "日一二三四五六";
+static const uint32_t default_first = 0x20;
+static const uint32_t default_last = 0x7e;
+
+// a growable array
+typedef struct {
+  void *data;
+  size_t count;
+  size_t allocated;
+} array_type;
+
+static void *array_append(array_type *a, size_t size, size_t count) {
+  if (a->count + count > a->allocated) {
+    size_t n = a->allocated == 0 ? 256 : a->allocated;
+    while (n < a->count + count) {
+      n *= 2;
+    }
+    a->data = realloc(a->data, n * size);
+    if (a->data == NULL) {
+      err(EXIT_FAILURE, "cannot allocate: %zu bytes", n * size);
+    }
+    a->allocated = n;
+  }
+  void *p = (uint8_t *)a->data + a->count * size;
+  a->count += count;
+  return p;
+}
+
+// a strike being built
+typedef struct {
+  ATLAS_strike_type header;
+  array_type index;    // uint32_t
+  array_type metrics;  // ATLAS_metrics_type
+  array_type coverage; // uint8_t
+} strike_type;
+
+static array_type codepoints; // uint32_t
+static array_type strikes;    // strike_type
+
+static void add_codepoint(uint32_t codepoint) {
+  *(uint32_t *)array_append(&codepoints, sizeof(uint32_t), 1) = codepoint;
+}
+
+static void add_text(const char *text, size_t length) {
+  uint32_t *buffer = malloc((length + 1) * sizeof(uint32_t));
+  if (buffer == NULL) {
+    err(EXIT_FAILURE, "cannot allocate text buffer");
+  }
+  size_t count = length + 1;
+  (void)string_to_ucs4(text, buffer, &count);
+  for (size_t i = 0; i < count; ++i) {
+    if (buffer[i] >= 0x20) {
+      add_codepoint(buffer[i]);
+    }
+  }
+  free(buffer);
+}
+
+static void add_text_file(const char *text_path) {
+  FILE *f = fopen(text_path, "r");
+  if (f == NULL) {
+    err(EXIT_FAILURE, "cannot open: %s", text_path);
+  }
+  array_type text = {0};
+  size_t n;
+  char buffer[4096];
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+    memcpy(array_append(&text, 1, n), buffer, n);
+  }
+  if (ferror(f)) {
+    err(EXIT_FAILURE, "cannot read: %s", text_path);
+  }
+  fclose(f);
+
+  *(char *)array_append(&text, 1, 1) = '\0';
+  add_text(text.data, text.count);
+  free(text.data);
+}
+
+static void add_range(const char *range) {
+  char *end;
+  unsigned long first = strtoul(range, &end, 0);
+  unsigned long last = first;
+  if (*end == '-') {
+    last = strtoul(end + 1, &end, 0);
+  }
+  if (*end != '\0' || last < first || last > 0x10ffff) {
+    errx(EXIT_FAILURE, "invalid range: %s", range);
+  }
+  for (unsigned long c = first; c <= last; ++c) {
+    add_codepoint(c);
+  }
+}
+
+static int compare_codepoint(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// sort and remove duplicates
+static void sort_codepoints(void) {
+  uint32_t *c = codepoints.data;
+  qsort(c, codepoints.count, sizeof(uint32_t), compare_codepoint);
+  size_t n = 0;
+  for (size_t i = 0; i < codepoints.count; ++i) {
+    if (n == 0 || c[n - 1] != c[i]) {
+      c[n++] = c[i];
+    }
+  }
+  codepoints.count = n;
+}
+
+// render all codepoints of one font at one size
+static void bake_strike(FT_Library library, FT_Face face, const char *name,
+                        int height, int verbose) {
+
+  int error = FT_Set_Pixel_Sizes(face, 0, height);
+  if (error != 0) {
+    errx(EXIT_FAILURE, "FreeType pixel sizes error: %d", error);
+  }
+
+  strike_type *s = array_append(&strikes, sizeof(strike_type), 1);
+  memset(s, 0, sizeof(*s));
+  strlcpy(s->header.name, name, sizeof(s->header.name));
+  s->header.width = 0;
+  s->header.height = height;
+
+  FT_Bitmap converted;
+  FT_Bitmap_Init(&converted);
+
+  const uint32_t *c = codepoints.data;
+  for (size_t i = 0; i < codepoints.count; ++i) {
+    FT_UInt glyph_index = FT_Get_Char_Index(face, c[i]);
+    if (glyph_index == 0) {
+      continue; // not in this font, lcd_clock will fall back
+    }
+    error = FT_Load_Glyph(face, glyph_index, FT_LOAD_RENDER);
+    if (error != 0) {
+      warnx("cannot render: U+%04X", c[i]);
+      continue;
+    }
+
+    FT_GlyphSlot slot = face->glyph; // a small shortcut
+    FT_Bitmap *bitmap = &slot->bitmap;
+    if (bitmap->pixel_mode != FT_PIXEL_MODE_GRAY ||
+        bitmap->num_grays != 256) {
+      error = FT_Bitmap_Convert(library, bitmap, &converted, 1);
+      if (error != 0) {
+        warnx("cannot convert: U+%04X", c[i]);
+        continue;
+      }
+      bitmap = &converted;
+      if (bitmap->num_grays > 1 && bitmap->num_grays != 256) {
+        const unsigned int max = bitmap->num_grays - 1;
+        for (unsigned int n = 0; n < bitmap->rows * bitmap->pitch; ++n) {
+          bitmap->buffer[n] = bitmap->buffer[n] * 255 / max;
+        }
+      }
+    }
+
+    *(uint32_t *)array_append(&s->index, sizeof(uint32_t), 1) = c[i];
+
+    ATLAS_metrics_type *m =
+        array_append(&s->metrics, sizeof(ATLAS_metrics_type), 1);
+    m->left = slot->bitmap_left;
+    m->top = slot->bitmap_top;
+    m->advance = slot->advance.x >> 6;
+    m->width = bitmap->width;
+    m->rows = bitmap->rows;
+    m->padding = 0;
+    m->offset = s->coverage.count;
+
+    // store rows without any pitch padding
+    uint8_t *p = array_append(&s->coverage, 1, bitmap->width * bitmap->rows);
+    for (unsigned int r = 0; r < bitmap->rows; ++r) {
+      memcpy(p, bitmap->buffer + r * bitmap->pitch, bitmap->width);
+      p += bitmap->width;
+    }
+  }
+  FT_Bitmap_Done(library, &converted);
+
+  s->header.glyph_count = s->index.count;
+
+  if (verbose > 0) {
+    printf("strike: %s @ %d: glyphs: %zu  coverage: %zu bytes\n", name, height,
+           s->index.count, s->coverage.count);
+  }
+}
+
+// process "font:height[,height…]"
+static void bake_font(FT_Library library, const char *spec, int verbose) {
+
+  char *font_path = strdup(spec);
+  if (font_path == NULL) {
+    err(EXIT_FAILURE, "cannot allocate font path");
+  }
+  char *sizes = strrchr(font_path, ':');
+  if (sizes == NULL) {
+    errx(EXIT_FAILURE, "missing sizes: %s", spec);
+  }
+  *sizes++ = '\0';
+
+  const char *name = strrchr(font_path, '/');
+  name = (name == NULL) ? font_path : name + 1;
+  if (strlen(name) >= sizeof(((ATLAS_strike_type *)NULL)->name)) {
+    errx(EXIT_FAILURE, "font file name too long: %s", name);
+  }
+
+  FT_Face face;
+  int error = FT_New_Face(library, font_path, 0, &face);
+  if (error == FT_Err_Unknown_File_Format) {
+    errx(EXIT_FAILURE, "FreeType unknown font format: %s", font_path);
+  } else if (error != 0) {
+    errx(EXIT_FAILURE, "FreeType face error: %d: %s", error, font_path);
+  }
+
+  for (char *h = strtok(sizes, ","); h != NULL; h = strtok(NULL, ",")) {
+    char *end;
+    long height = strtol(h, &end, 10);
+    if (*end != '\0' || height <= 0 || height > 1000) {
+      errx(EXIT_FAILURE, "invalid size: %s", h);
+    }
+    bake_strike(library, face, name, height, verbose);
+  }
+
+  FT_Done_Face(face);
+  free(font_path);
+}
+
+static uint32_t align4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+static void write_bytes(FILE *f, const void *data, size_t length,
+                        size_t *offset, const char *atlas_path) {
+  static const uint8_t zero[4] = {0};
+  while (*offset % 4 != 0) {
+    if (fwrite(zero, 1, 1, f) != 1) {
+      err(EXIT_FAILURE, "cannot write: %s", atlas_path);
+    }
+    ++*offset;
+  }
+  if (length > 0 && fwrite(data, length, 1, f) != 1) {
+    err(EXIT_FAILURE, "cannot write: %s", atlas_path);
+  }
+  *offset += length;
+}
+
+static void write_atlas(const char *atlas_path) {
+
+  strike_type *s = strikes.data;
+
+  // lay out the file
+  size_t offset = align4(sizeof(ATLAS_header_type));
+  const uint32_t strike_offset = offset;
+  offset = align4(offset + strikes.count * sizeof(ATLAS_strike_type));
+  for (size_t i = 0; i < strikes.count; ++i) {
+    s[i].header.index_offset = offset;
+    offset = align4(offset + s[i].index.count * sizeof(uint32_t));
+    s[i].header.metrics_offset = offset;
+    offset = align4(offset + s[i].metrics.count * sizeof(ATLAS_metrics_type));
+    s[i].header.coverage_offset = offset;
+    offset = align4(offset + s[i].coverage.count);
+  }
+  if (offset > UINT32_MAX) {
+    errx(EXIT_FAILURE, "atlas too large: %zu bytes", offset);
+  }
+
+  ATLAS_header_type header = {
+      .magic = ATLAS_MAGIC,
+      .version = ATLAS_VERSION,
+      .byte_order = ATLAS_BYTE_ORDER,
+      .file_length = offset,
+      .strike_count = strikes.count,
+      .strike_offset = strike_offset,
+  };
+
+  FILE *f = fopen(atlas_path, "wb");
+  if (f == NULL) {
+    err(EXIT_FAILURE, "cannot create: %s", atlas_path);
+  }
+
+  size_t written = 0;
+  write_bytes(f, &header, sizeof(header), &written, atlas_path);
+  for (size_t i = 0; i < strikes.count; ++i) {
+    write_bytes(f, &s[i].header, sizeof(s[i].header), &written, atlas_path);
+  }
+  for (size_t i = 0; i < strikes.count; ++i) {
+    write_bytes(f, s[i].index.data, s[i].index.count * sizeof(uint32_t),
+                &written, atlas_path);
+    write_bytes(f, s[i].metrics.data,
+                s[i].metrics.count * sizeof(ATLAS_metrics_type), &written,
+                atlas_path);
+    write_bytes(f, s[i].coverage.data, s[i].coverage.count, &written,
+                atlas_path);
+  }
+  write_bytes(f, NULL, 0, &written, atlas_path); // final alignment
+
+  if (fclose(f) != 0) {
+    err(EXIT_FAILURE, "cannot write: %s", atlas_path);
+  }
+}
+
+void usage(const char *program) {
+  printf("usage: %s [options] font:height[,height...]...\n", program);
+  printf("       --help                 -h            this message\n"
+         "       --verbose              -v            more messages\n"
+         "       --output=FILE          -o FILE       atlas file to create\n"
+         "       --text=FILE            -t FILE       bake the characters in "
+         "a UTF-8 file\n"
+         "       --range=FIRST-LAST     -r FIRST-LAST bake a range of "
+         "codepoints\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+
+  extern char *optarg;
+  extern int optind;
+
+  // options descriptor
+  static struct option longopts[] = {
+      {"help", no_argument, NULL, 'h'},
+      {"verbose", no_argument, NULL, 'v'},
+      {"output", required_argument, NULL, 'o'},
+      {"text", required_argument, NULL, 't'},
+      {"range", required_argument, NULL, 'r'},
+      {NULL, 0, NULL, 0}};
+
+  const char *program = "lcd_atlas";
+  int verbose = 0;
+  const char *atlas_path = NULL;
+
+  add_text(default_text, sizeof(default_text));
+  for (uint32_t c = default_first; c <= default_last; ++c) {
+    add_codepoint(c);
+  }
+
+  int ch = 0;
+  while ((ch = getopt_long(argc, argv, "o:r:t:vh", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'o':
+      atlas_path = optarg;
+      break;
+    case 'r':
+      add_range(optarg);
+      break;
+    case 't':
+      add_text_file(optarg);
+      break;
+    case 'v':
+      ++verbose;
+      break;
+    case 'h':
+    case '?':
+    default:
+      usage(program);
+    }
+  argc -= optind;
+  argv += optind;
+
+  if (atlas_path == NULL || argc < 1) {
+    usage(program);
+  }
+
+  sort_codepoints();
+
+  FT_Library library;
+  int error = FT_Init_FreeType(&library);
+  if (error != 0) {
+    errx(EXIT_FAILURE, "FreeType setup failed: error: %d", error);
+  }
+
+  for (int i = 0; i < argc; ++i) {
+    bake_font(library, argv[i], verbose);
+  }
+
+  write_atlas(atlas_path);
+
+  FT_Done_FreeType(library);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+// atlas.c
+
+#include <err.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "atlas.h"
+
+// atlas information
+struct ATLAS_struct {
+  const uint8_t *data;
+  size_t length;
+  const ATLAS_header_type *header;
+  const ATLAS_strike_type *strikes;
+};
+
+// check a table lies inside the file
+static bool inside(const ATLAS_type *atlas, uint32_t offset, size_t count,
+                   size_t size) {
+  return offset % 4 == 0 && offset <= atlas->length &&
+         count <= (atlas->length - offset) / size;
+}
+
+// map an atlas file, returns NULL if missing or invalid
+ATLAS_type *ATLAS_open(const char *atlas_path) {
+
+  ATLAS_type *atlas = malloc(sizeof(ATLAS_type));
+  if (atlas == NULL) {
+    warn("failed to allocate atlas structure");
+    return NULL;
+  }
+
+  int fd = open(atlas_path, O_RDONLY);
+  if (fd < 0) {
+    warn("cannot open atlas: %s", atlas_path);
+    free(atlas);
+    return NULL;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) < 0) {
+    warn("cannot stat atlas: %s", atlas_path);
+    close(fd);
+    free(atlas);
+    return NULL;
+  }
+
+  void *data = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    warn("cannot map atlas: %s", atlas_path);
+    free(atlas);
+    return NULL;
+  }
+
+  atlas->data = data;
+  atlas->length = sb.st_size;
+  atlas->header = data;
+
+  const ATLAS_header_type *h = atlas->header;
+  if (atlas->length < sizeof(ATLAS_header_type) ||
+      memcmp(h->magic, ATLAS_MAGIC, sizeof(h->magic)) != 0 ||
+      h->version != ATLAS_VERSION || h->byte_order != ATLAS_BYTE_ORDER ||
+      h->file_length != atlas->length ||
+      !inside(atlas, h->strike_offset, h->strike_count,
+              sizeof(ATLAS_strike_type))) {
+    warnx("invalid atlas: %s", atlas_path);
+    ATLAS_close(atlas);
+    return NULL;
+  }
+  atlas->strikes =
+      (const ATLAS_strike_type *)(atlas->data + h->strike_offset);
+
+  for (uint32_t i = 0; i < h->strike_count; ++i) {
+    const ATLAS_strike_type *s = &atlas->strikes[i];
+    if (!inside(atlas, s->index_offset, s->glyph_count, sizeof(uint32_t)) ||
+        !inside(atlas, s->metrics_offset, s->glyph_count,
+                sizeof(ATLAS_metrics_type)) ||
+        !inside(atlas, s->coverage_offset, 0, 1)) {
+      warnx("invalid atlas strike: %u in: %s", i, atlas_path);
+      ATLAS_close(atlas);
+      return NULL;
+    }
+
+    // every bitmap must be inside the file
+    const ATLAS_metrics_type *m =
+        (const ATLAS_metrics_type *)(atlas->data + s->metrics_offset);
+    size_t available = atlas->length - s->coverage_offset;
+    for (uint32_t g = 0; g < s->glyph_count; ++g) {
+      size_t size = (size_t)m[g].width * m[g].rows;
+      if (m[g].offset > available || size > available - m[g].offset) {
+        warnx("invalid atlas glyph: %u/%u in: %s", i, g, atlas_path);
+        ATLAS_close(atlas);
+        return NULL;
+      }
+    }
+  }
+
+  return atlas;
+}
+
+// unmap the atlas
+bool ATLAS_close(ATLAS_type *atlas) {
+  if (atlas == NULL) {
+    return false;
+  }
+  munmap((void *)atlas->data, atlas->length);
+  free(atlas);
+  return true;
+}
+
+// find the strike for a font file at a pixel size
+const ATLAS_strike_type *ATLAS_strike(ATLAS_type *atlas, const char *font_path,
+                                      int width, int height) {
+  if (atlas == NULL) {
+    return NULL;
+  }
+
+  const char *name = strrchr(font_path, '/');
+  name = (name == NULL) ? font_path : name + 1;
+
+  for (uint32_t i = 0; i < atlas->header->strike_count; ++i) {
+    const ATLAS_strike_type *s = &atlas->strikes[i];
+    if (s->width == (uint32_t)width && s->height == (uint32_t)height &&
+        strncmp(s->name, name, sizeof(s->name)) == 0) {
+      return s;
+    }
+  }
+  return NULL;
+}
+
+// look up a codepoint in a strike
+const ATLAS_metrics_type *ATLAS_glyph(ATLAS_type *atlas,
+                                      const ATLAS_strike_type *strike,
+                                      uint32_t codepoint,
+                                      const uint8_t **coverage) {
+
+  const uint32_t *index =
+      (const uint32_t *)(atlas->data + strike->index_offset);
+
+  // binary search of the sorted codepoints
+  size_t low = 0;
+  size_t high = strike->glyph_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (index[mid] < codepoint) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == strike->glyph_count || index[low] != codepoint) {
+    return NULL;
+  }
+
+  const ATLAS_metrics_type *m =
+      (const ATLAS_metrics_type *)(atlas->data + strike->metrics_offset) +
+      low;
+  *coverage = atlas->data + strike->coverage_offset + m->offset;
+  return m;
+}
@@ -0,0 +1,83 @@
+// atlas.h
+
+#if !defined(ATLAS_H)
+#define ATLAS_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// file format
+// ===========
+//
+// a baked atlas holds pre-rasterised glyphs for a number of strikes,
+// a strike being one font file at one pixel size.  All values are in
+// host byte order; byte_order is checked on loading.  All offsets are
+// from the start of the file and are 4 byte aligned.
+//
+//   header
+//   strike[strike_count]
+//   for each strike:
+//     uint32_t codepoint[glyph_count]       sorted ascending
+//     metrics[glyph_count]                  same order as codepoints
+//     uint8_t coverage[]                    8 bit grey, pitch = width
+
+#define ATLAS_MAGIC "LCDA"
+#define ATLAS_VERSION 1
+#define ATLAS_BYTE_ORDER 0x01020304
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t file_length;
+  uint32_t strike_count;
+  uint32_t strike_offset;
+} ATLAS_header_type;
+
+typedef struct {
+  char name[48]; // base name of the font file
+  uint32_t width;
+  uint32_t height;
+  uint32_t glyph_count;
+  uint32_t index_offset;
+  uint32_t metrics_offset;
+  uint32_t coverage_offset;
+} ATLAS_strike_type;
+
+typedef struct {
+  int16_t left;     // bitmap offset right of the pen position
+  int16_t top;      // bitmap offset up from the baseline
+  int16_t advance;  // horizontal advance in pixels
+  uint16_t width;   // bitmap width, also the pitch
+  uint16_t rows;    // bitmap rows
+  uint16_t padding; // zero
+  uint32_t offset;  // from coverage_offset of the strike
+} ATLAS_metrics_type;
+
+// type to hold a loaded atlas
+typedef struct ATLAS_struct ATLAS_type;
+
+// functions
+// =========
+
+// map an atlas file, returns NULL if missing or invalid
+ATLAS_type *ATLAS_open(const char *atlas_path);
+
+// unmap the atlas
+bool ATLAS_close(ATLAS_type *atlas);
+
+// find the strike for a font file at a pixel size
+// only the base name of the font path is compared
+// returns NULL if not present
+const ATLAS_strike_type *ATLAS_strike(ATLAS_type *atlas, const char *font_path,
+                                      int width, int height);
+
+// look up a codepoint in a strike
+// returns NULL if not present, otherwise sets the coverage bitmap
+const ATLAS_metrics_type *ATLAS_glyph(ATLAS_type *atlas,
+                                      const ATLAS_strike_type *strike,
+                                      uint32_t codepoint,
+                                      const uint8_t **coverage);
+
+#endif
@@ -0,0 +1,344 @@
+// bench.c
+
+#include <err.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "ili9486.h"
+
+struct BENCH_bus_struct {
+  ILI9486_transport_type transport;
+  pthread_mutex_t lock; // the controller does one transfer at a time
+  uint32_t bps;
+  unsigned int overhead; // microseconds per transfer
+  BENCH_bus_counters_type counters;
+};
+
+static int64_t now_ns(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+// hold the bus for the time a transfer takes, spinning as a sleep
+// would take a whole scheduler tick
+static void transfer(BENCH_bus_type *bus, size_t length) {
+  pthread_mutex_lock(&bus->lock);
+  int64_t ns = (int64_t)bus->overhead * 1000 +
+               (int64_t)length * 8 * 1000000000 / bus->bps;
+  int64_t end = now_ns() + ns;
+  while (now_ns() < end) {
+  }
+  bus->counters.bytes += length;
+  ++bus->counters.transfers;
+  pthread_mutex_unlock(&bus->lock);
+}
+
+// RS is a GPIO write, which costs nothing next to a transfer
+static void bus_select(void *context, bool data) {
+  (void)context;
+  (void)data;
+}
+
+static void bus_send(void *context, const void *buffer, size_t length) {
+  (void)buffer;
+  transfer(context, length);
+}
+
+// nothing answers, so reads return zeros
+static void bus_read(void *context, const void *buffer, void *received,
+                     size_t length) {
+  (void)buffer;
+  transfer(context, length);
+  memset(received, 0, length);
+}
+
+static bool bus_speed(void *context, uint32_t bps) {
+  BENCH_bus_type *bus = context;
+  if (bps == 0) {
+    return false;
+  }
+  pthread_mutex_lock(&bus->lock);
+  bus->bps = bps;
+  pthread_mutex_unlock(&bus->lock);
+  return true;
+}
+
+// simulate an SPI bus
+BENCH_bus_type *BENCH_bus_create(unsigned int overhead) {
+
+  BENCH_bus_type *bus = calloc(1, sizeof(BENCH_bus_type));
+  if (bus == NULL) {
+    warn("failed to allocate simulated bus");
+    return NULL;
+  }
+  if (pthread_mutex_init(&bus->lock, NULL) != 0) {
+    warnx("cannot create simulated bus lock");
+    free(bus);
+    return NULL;
+  }
+  bus->transport = (ILI9486_transport_type){
+      .context = bus,
+      .select = bus_select,
+      .send = bus_send,
+      .read = bus_read,
+      .speed = bus_speed,
+  };
+  bus->bps = 1000000;
+  bus->overhead = overhead;
+
+  return bus;
+}
+
+// release a simulated bus
+void BENCH_bus_destroy(BENCH_bus_type *bus) {
+  if (bus == NULL) {
+    return;
+  }
+  pthread_mutex_destroy(&bus->lock);
+  free(bus);
+}
+
+// transport for ILI9486_config_type
+const ILI9486_transport_type *BENCH_bus_transport(BENCH_bus_type *bus) {
+  return &bus->transport;
+}
+
+// what the bus has sent so far
+void BENCH_bus_counters(BENCH_bus_type *bus,
+                        BENCH_bus_counters_type *counters) {
+  pthread_mutex_lock(&bus->lock);
+  *counters = bus->counters;
+  pthread_mutex_unlock(&bus->lock);
+}
+
+// panel loads
+// ===========
+//
+// each frame draws into the framebuffer and sends it, random sizes and
+// places come from a fixed seed so that runs can be compared
+
+static uint32_t next_random(uint32_t *seed) {
+  uint32_t x = *seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *seed = x;
+  return x;
+}
+
+static ILI9486_colour_type random_colour(uint32_t *seed) {
+  uint32_t c = next_random(seed);
+  return (ILI9486_colour_type){
+      .red = c & 0xff, .green = (c >> 8) & 0xff, .blue = (c >> 16) & 0xff};
+}
+
+// fill and send a random square with sides from low to high pixels
+static void random_square(ILI9486_type *lcd, uint32_t *seed, int low,
+                          int high) {
+  int size = low + next_random(seed) % (high - low + 1);
+  int x = next_random(seed) % (ILI9486_width(lcd) - size + 1);
+  int y = next_random(seed) % (ILI9486_height(lcd) - size + 1);
+  ILI9486_fill(lcd, x, y, size, size, random_colour(seed));
+  ILI9486_damage(lcd, x, y, size, size, ILI9486_PRIORITY_NORMAL);
+  ILI9486_sync(lcd, 0);
+}
+
+static void full_screen(ILI9486_type *lcd, uint32_t *seed) {
+  ILI9486_fill(lcd, 0, 0, ILI9486_width(lcd), ILI9486_height(lcd),
+               random_colour(seed));
+  ILI9486_refresh(lcd);
+}
+
+static void large_squares(ILI9486_type *lcd, uint32_t *seed) {
+  random_square(lcd, seed, 128, ILI9486_height(lcd));
+}
+
+static void medium_squares(ILI9486_type *lcd, uint32_t *seed) {
+  random_square(lcd, seed, 32, 127);
+}
+
+static void small_squares(ILI9486_type *lcd, uint32_t *seed) {
+  random_square(lcd, seed, 8, 31);
+}
+
+static void single_rows(ILI9486_type *lcd, uint32_t *seed) {
+  int y = next_random(seed) % ILI9486_height(lcd);
+  ILI9486_fill(lcd, 0, y, ILI9486_width(lcd), 1, random_colour(seed));
+  ILI9486_damage(lcd, 0, y, ILI9486_width(lcd), 1, ILI9486_PRIORITY_NORMAL);
+  ILI9486_sync(lcd, 0);
+}
+
+static void tiny_windows(ILI9486_type *lcd, uint32_t *seed) {
+  random_square(lcd, seed, 4, 4);
+}
+
+static const struct {
+  const char *name;
+  void (*frame)(ILI9486_type *lcd, uint32_t *seed);
+} patterns[BENCH_PANEL_PATTERNS] = {
+    {"full screen", full_screen},       {"squares 128+", large_squares},
+    {"squares 32-127", medium_squares}, {"squares 8-31", small_squares},
+    {"single rows", single_rows},       {"4x4 windows", tiny_windows},
+};
+
+static double now_seconds(void) {
+  return now_ns() / 1e9;
+}
+
+// draw and send each standard load for a time
+void BENCH_panel(ILI9486_type *lcd, unsigned int milliseconds,
+                 BENCH_result_type results[BENCH_PANEL_PATTERNS]) {
+
+  uint32_t seed = 0x2545f491;
+
+  for (size_t i = 0; i < BENCH_PANEL_PATTERNS; ++i) {
+    ILI9486_counters_type before;
+    ILI9486_counters(lcd, &before);
+
+    uint64_t frames = 0;
+    double start = now_seconds();
+    double elapsed = 0;
+    do {
+      patterns[i].frame(lcd, &seed);
+      ++frames;
+      elapsed = now_seconds() - start;
+    } while (elapsed * 1000 < milliseconds);
+
+    ILI9486_counters_type after;
+    ILI9486_counters(lcd, &after);
+    results[i] = (BENCH_result_type){
+        .pattern = patterns[i].name,
+        .seconds = elapsed,
+        .frames = frames,
+        .bytes = after.bytes - before.bytes,
+        .transfers = after.transfers - before.transfers,
+    };
+  }
+}
+
+// print the rates achieved and the most the SPI clock allows
+void BENCH_panel_report(const BENCH_result_type *results, size_t count,
+                        uint32_t bps) {
+
+  double limit = bps / 8.0; // bytes a second
+
+  printf("SPI clock: %" PRIu32 " Hz  limit: %.2f MB/s\n", bps, limit / 1e6);
+  printf("%-16s %10s %10s %8s %11s %6s\n", "pattern", "frames/s", "limit/s",
+         "MB/s", "transfers/s", "bus");
+  for (size_t i = 0; i < count; ++i) {
+    const BENCH_result_type *r = &results[i];
+    double rate = r->bytes / r->seconds;
+    double frame = (r->frames > 0) ? (double)r->bytes / r->frames : 0;
+    printf("%-16s %10.1f %10.1f %8.2f %11.0f %5.0f%%\n", r->pattern,
+           r->frames / r->seconds, (frame > 0) ? limit / frame : 0,
+           rate / 1e6, r->transfers / r->seconds, 100 * rate / limit);
+  }
+}
+
+static int compare(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// value that percent of the samples are at or below, by nearest rank
+int64_t BENCH_percentile(int64_t *samples, size_t count,
+                         unsigned int percent) {
+
+  if (count == 0) {
+    return 0;
+  }
+  qsort(samples, count, sizeof(samples[0]), compare);
+
+  size_t rank = (count * percent + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+  if (rank > count) {
+    rank = count;
+  }
+  return samples[rank - 1];
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  int64_t samples[] = {50, 10, 40, 20, 30, 100, 90, 80, 70, 60};
+  size_t count = sizeof(samples) / sizeof(samples[0]);
+  assert(BENCH_percentile(samples, count, 50) == 50);
+  assert(BENCH_percentile(samples, count, 90) == 90);
+  assert(BENCH_percentile(samples, count, 99) == 100);
+  assert(BENCH_percentile(samples, count, 100) == 100);
+  assert(BENCH_percentile(samples, count, 0) == 10);
+  assert(BENCH_percentile(samples, 0, 50) == 0);
+
+  // 8000 bytes at 1 MHz is 64 ms, plus 1 ms of overheads; only the
+  // lower bound is checked as a loaded host makes it take longer
+  BENCH_bus_type *bus = BENCH_bus_create(100);
+  assert(bus != NULL);
+  const ILI9486_transport_type *t = BENCH_bus_transport(bus);
+  assert(t->speed(t->context, 1000000));
+  assert(!t->speed(t->context, 0));
+
+  static uint8_t buffer[800];
+  int64_t start = now_ns();
+  for (int i = 0; i < 10; ++i) {
+    t->select(t->context, true);
+    t->send(t->context, buffer, sizeof(buffer));
+  }
+  int64_t elapsed = now_ns() - start;
+  printf("simulated: %lld us\n", (long long)(elapsed / 1000));
+  assert(elapsed >= 65000000);
+
+  uint8_t received[4] = {1, 2, 3, 4};
+  t->read(t->context, buffer, received, sizeof(received));
+  assert(received[0] == 0 && received[3] == 0);
+
+  BENCH_bus_counters_type counters;
+  BENCH_bus_counters(bus, &counters);
+  assert(counters.bytes == 10 * sizeof(buffer) + sizeof(received));
+  assert(counters.transfers == 11);
+
+  // panel loads over the simulated bus, the clock is set by the panel
+  ILI9486_config_type config = ILI9486_CONFIG_WAVESHARE;
+  config.transport = t;
+  ILI9486_type *lcd = ILI9486_create(&config, false);
+  assert(lcd != NULL);
+
+  BENCH_result_type results[BENCH_PANEL_PATTERNS];
+  BENCH_panel(lcd, 100, results);
+  BENCH_panel_report(results, BENCH_PANEL_PATTERNS, ILI9486_bps(lcd));
+  for (size_t i = 0; i < BENCH_PANEL_PATTERNS; ++i) {
+    assert(results[i].frames > 0);
+    assert(results[i].bytes / results[i].seconds <= ILI9486_bps(lcd) / 8);
+  }
+
+  // a full screen cannot send faster than the bus
+  const BENCH_result_type *full = &results[0];
+  assert(full->bytes >= full->frames * 480 * 320 * 3);
+  double busy =
+      full->bytes * 8.0 / ILI9486_bps(lcd) + full->transfers * 100e-6;
+  assert(busy / full->seconds <= 1.0);
+  assert(results[5].transfers > results[5].frames);
+
+  ILI9486_destroy(lcd);
+  BENCH_bus_destroy(bus);
+  return 0;
+}
+#endif
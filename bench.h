@@ -0,0 +1,75 @@
+// bench.h
+
+#if !defined(BENCH_H)
+#define BENCH_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ili9486.h"
+
+// benchmarks
+// ==========
+//
+// percentiles of latency samples, and a panel bus that takes as long
+// as SPI would without any hardware so that drawing and scheduling can
+// be timed on any machine
+
+// type to hold a simulated bus
+typedef struct BENCH_bus_struct BENCH_bus_type;
+
+// a panel load run by BENCH_panel
+typedef struct {
+  const char *pattern;
+  double seconds;     // spent running it
+  uint64_t frames;    // refreshes or syncs
+  uint64_t bytes;     // over the bus, commands included
+  uint64_t transfers; // SPI transfers
+} BENCH_result_type;
+
+// number of loads run by BENCH_panel
+#define BENCH_PANEL_PATTERNS 6
+
+// bytes and transfers that went over a simulated bus
+typedef struct {
+  uint64_t bytes;
+  uint64_t transfers;
+} BENCH_bus_counters_type;
+
+// functions
+// =========
+
+// simulate an SPI bus where each transfer takes overhead microseconds
+// plus the time of its bytes at the current clock; panels sharing the
+// bus take turns as they would on the controller
+// returns NULL on failure
+BENCH_bus_type *BENCH_bus_create(unsigned int overhead);
+
+// release a simulated bus, after the panels using it
+void BENCH_bus_destroy(BENCH_bus_type *bus);
+
+// transport for ILI9486_config_type, valid until the bus is destroyed
+const ILI9486_transport_type *BENCH_bus_transport(BENCH_bus_type *bus);
+
+// what the bus has sent so far
+void BENCH_bus_counters(BENCH_bus_type *bus,
+                        BENCH_bus_counters_type *counters);
+
+// draw and send each standard load for milliseconds: full screen
+// fills, random rectangles of three sizes, single rows and tiny
+// windows, the screen is left with random content
+void BENCH_panel(ILI9486_type *lcd, unsigned int milliseconds,
+                 BENCH_result_type results[BENCH_PANEL_PATTERNS]);
+
+// print the rates achieved and the most the SPI clock allows
+void BENCH_panel_report(const BENCH_result_type *results, size_t count,
+                        uint32_t bps);
+
+// value that percent of the samples are at or below, the samples are
+// sorted in place
+// returns 0 if there are none
+int64_t BENCH_percentile(int64_t *samples, size_t count,
+                         unsigned int percent);
+
+#endif
@@ -2,11 +2,17 @@
 
 #include <err.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h> // mlockall
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/stat.h>  // chmod
@@ -18,10 +24,19 @@
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include FT_COLOR_H
-#include FT_BITMAP_H
 
+#include "arena.h"
+#include "atlas.h"
+#include "bench.h"
+#include "colour.h"
+#include "face.h"
+#include "font.h"
+#include "gpio.h"
 #include "ili9486.h"
+#include "message.h"
+#include "pool.h"
+#include "sprite.h"
+#include "touch.h"
 #include "unicode.h"
 
 #define X11_RGB(R, G, B)                                                       \
@@ -29,7 +44,6 @@
       .red = R,                                                                \
       .green = G,                                                              \
       .blue = B,                                                               \
-      .alpha = 255,                                                            \
   }
 #include "x11-rgb-txt.h"
 
@@ -38,8 +52,16 @@
 // suggest some leading spaces (14) for message to scroll better
 #define UNIX_SOCKET_1 "/tmp/clock.sock"
 #define UNIX_SOCKET_2 "/tmp/clock2.sock"
+
+// for placing icons from the --sprites sheet, a line for each:
+//   echo 'sun 416 136' | nc -U /tmp/clock-icon.sock
+// an icon replaces any at the same place, "clear" removes them all
+#define UNIX_SOCKET_ICON "/tmp/clock-icon.sock"
 #define SOCKET_MODE (0777)
 
+// tuned SPI settings from --calibrate
+#define STATE_FILE "/var/db/lcd_clock.state"
+
 // font configuration
 
 // #define FONT_FILE "/usr/pkg/share/fonts/X11/TTF/FreeMonoBold.ttf"
@@ -60,31 +82,180 @@ const int date_font_height = 92;
 const int message_font_width = 0;
 const int message_font_height = 64;
 
-#define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof((a)[0]))
+// fonts tried in order for characters missing from a field's font
+static const char *const time_font_fallback[] = {
+    "/usr/pkg/share/fonts/X11/TTF/NotoSansMonoCJKtc-Bold.otf",
+    NULL,
+};
+static const char *const date_font_fallback[] = {
+    "/usr/pkg/share/fonts/X11/TTF/DejaVuSans-Bold.ttf",
+    NULL,
+};
+static const char *const message_font_fallback[] = {
+    "/usr/pkg/share/fonts/X11/TTF/NotoSans-Bold.ttf",
+    "/usr/pkg/share/fonts/X11/TTF/DejaVuSans-Bold.ttf",
+    NULL,
+};
 
-static bool render(int x, int y, int x_offset, int incr, const char *str,
-                   FT_Library library, FT_Face face, FT_Color foreground,
-                   FT_Color background);
+#define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof((a)[0]))
 
-static void dump_bitmap(const char *title, FT_Bitmap *bitmap) {
+// baselines of the fields
+static const int time_baseline = 100;
+static const int date_baseline = 200;
+static const int message_baseline = 290;
+
+// longest a frame may spend sending changes, in microseconds
+static const unsigned int frame_deadline = 100000;
+
+// microseconds each transfer costs on the simulated bus, about what
+// an SPI ioctl takes on a Pi
+static const unsigned int simulated_overhead = 20;
+
+// milliseconds each load of --bench-panel runs
+static const unsigned int panel_bench_time = 5000;
+
+// scratch for the glyphs a worker renders in one frame, a whole line
+// of the largest font is well under this
+static const size_t frame_arena_size = 1024 * 1024;
+
+// milliseconds the time takes to grow to full size at the start of
+// each minute with --grow, from half its height
+static const long grow_time = 600;
+
+// pixels a second the message scrolls, about a cell every time the
+// whole screen was sent at 30 MHz
+static const int64_t ticker_speed = 256;
+
+// most icons on the screen at once
+#define MAX_ICONS 8
+
+// stages of a tick timed by --bench
+static const char *const bench_stages[] = {
+    "second seen", // the loop noticed the new second
+    "rendered",    // the frame was drawn in memory
+    "first byte",  // the first transfer of the time started
+    "last byte",   // the time was on the panel
+};
+#define BENCH_STAGES 4
+
+// the panel, or panels tiled side by side, being drawn on
+static ILI9486_type *display = NULL;
+
+// day of the week in English and Chinese
+static const char *const wday[7] = {
+    "Su日", "Mo一", "Tu二", "We三", "Th四", "Fr五", "Sa六",
+};
+
+// stack faulted in by --realtime, more than a frame ever uses
+#define STACK_PREFAULT (256 * 1024)
+
+// how late the time lands after the second it shows, in 1 ms buckets
+// with the last one for anything later
+#define JITTER_BUCKETS 100
+
+typedef struct {
+  unsigned int count;
+  unsigned int histogram[JITTER_BUCKETS];
+  unsigned int max; // microseconds
+  uint64_t total;   // ..
+} jitter_type;
+
+// the fonts of the fields, one set for each worker as a FreeType
+// library and its faces must only be used by one thread
+typedef struct {
+  FT_Library library;
+  ARENA_type *arena; // glyphs rendered this frame
+  FONT_type *time;
+  FONT_type *date;
+  FONT_type *message;
+} fonts_type;
+
+// colours of the fields for a period of the day
+typedef struct {
+  ILI9486_colour_type time;
+  ILI9486_colour_type day;
+  ILI9486_colour_type date;
+  ILI9486_colour_type message;
+  ILI9486_colour_type background;
+  ILI9486_colour_type gradient; // background at the bottom
+  bool graded;                  // gradient was given
+} colours_type;
+
+// an icon from the sprite sheet placed on the background
+typedef struct {
+  const SPRITE_entry_type *sprite;
+  const uint8_t *pixels;
+  const uint8_t *alpha; // NULL for opaque
+  int x;
+  int y;
+} icon_type;
+
+// part of the screen that a worker draws on, right and bottom are
+// exclusive
+typedef struct {
+  int left;
+  int top;
+  int right;
+  int bottom;
+} clip_type;
+
+// what the workers draw for a frame
+typedef struct {
+  const colours_type *theme;
+  char time[20];
+  int time_height; // pixels, less while the time grows
+  const char *day;
+  char date[20];
+  int date_x;    // left of the day
+  int day_width; // pixels
+  int date_cell; // pixel width of a cell of the date font
+  const MESSAGE_type *message;
+  size_t m_first; // first codepoint shown
+  int m_offset;   // pixels of it scrolled off
+  int m_cell;     // pixel width of a cell of the message font
+  int m_ascent;
+  int m_descent;
+} frame_type;
+
+// a job for a worker: draw part of the frame inside a clip
+typedef struct {
+  POOL_function_type *draw;
+  const frame_type *frame;
+  clip_type clip;
+} part_type;
+
+static void render(const clip_type *clip, int x, int y, int x_offset,
+                   int cell, const char *str, FONT_type *font,
+                   ILI9486_colour_type foreground);
+static void render_ucs4(const clip_type *clip, int x, int y, int x_offset,
+                        int cell, const uint32_t *text, size_t length,
+                        FONT_type *font, ILI9486_colour_type foreground);
+
+static void render_message(const clip_type *clip, int x, int y, int x_offset,
+                           int cell, int ascent, int descent,
+                           const MESSAGE_type *message, size_t first,
+                           FONT_type *font, ILI9486_colour_type foreground);
+
+static void dump_glyph(const char *title, FONT_glyph_type *glyph) {
 #if 1
   (void)title;
-  (void)bitmap;
+  (void)glyph;
 #else
   printf("------------------------------\n");
   printf("Dump of: %s\n", title);
-  printf("rows:  %6d\n", bitmap->rows);
-  printf("width: %6d\n", bitmap->width);
-  printf("pitch: %6d\n", bitmap->pitch);
-  printf("grays: %6d\n", bitmap->num_grays);
-  printf("pixel: %6d\n", bitmap->pixel_mode);
-
-  uint8_t *p = (uint8_t *)(bitmap->buffer);
-  for (int r = 0; r < bitmap->rows; ++r) {
-    for (int w = 0; w < bitmap->pitch; ++w) {
+  printf("rows:    %6d\n", glyph->rows);
+  printf("width:   %6d\n", glyph->width);
+  printf("pitch:   %6d\n", glyph->pitch);
+  printf("left:    %6d\n", glyph->left);
+  printf("top:     %6d\n", glyph->top);
+  printf("advance: %6d\n", glyph->advance);
+
+  const uint8_t *p = glyph->coverage;
+  for (int r = 0; r < glyph->rows; ++r) {
+    for (int w = 0; w < glyph->pitch; ++w) {
       printf("%02x ", p[w]);
     }
-    p += bitmap->pitch;
+    p += glyph->pitch;
     printf("\n");
   }
 #endif
@@ -140,16 +311,426 @@ static int make_listen_socket(const char *unix_path) {
   return server_fd;
 }
 
+// run the calling thread at a SCHED_FIFO priority on one CPU,
+// -1 leaves either unchanged
+static void realtime_self(int priority, int cpu) {
+
+  if (priority >= 0) {
+    struct sched_param param = {.sched_priority = priority};
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+      errx(EXIT_FAILURE, "cannot set real-time priority %d: %s", priority,
+           strerror(rc));
+    }
+  }
+
+  if (cpu >= 0) {
+    cpuset_t *set = cpuset_create();
+    if (set == NULL) {
+      err(EXIT_FAILURE, "cannot create cpu set");
+    }
+    cpuset_zero(set);
+    if (cpuset_set((cpuid_t)cpu, set) != 0) {
+      errx(EXIT_FAILURE, "invalid cpu: %d", cpu);
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), cpuset_size(set), set);
+    if (rc != 0) {
+      errx(EXIT_FAILURE, "cannot pin to cpu %d: %s", cpu, strerror(rc));
+    }
+    cpuset_destroy(set);
+  }
+}
+
+// load the field fonts with their fallbacks into a FreeType library
+// of their own; date and message normally use the same file, which
+// is only mapped once and parsed once for each library
+static void load_fonts(fonts_type *fonts, bool sdf, ATLAS_type *atlas,
+                       int verbose) {
+
+  fonts->library = FONT_library();
+  if (fonts->library == NULL) {
+    errx(EXIT_FAILURE, "FreeType setup failed");
+  }
+
+  fonts->time = FONT_create(fonts->library, TIME_FONT_FILE, time_font_width,
+                            time_font_height);
+  if (fonts->time == NULL) {
+    errx(EXIT_FAILURE, "cannot load font: %s", TIME_FONT_FILE);
+  }
+
+  fonts->date = FONT_create(fonts->library, DATE_FONT_FILE, date_font_width,
+                            date_font_height);
+  if (fonts->date == NULL) {
+    errx(EXIT_FAILURE, "cannot load font: %s", DATE_FONT_FILE);
+  }
+
+  fonts->message = FONT_create(fonts->library, MESSAGE_FONT_FILE,
+                               message_font_width, message_font_height);
+  if (fonts->message == NULL) {
+    errx(EXIT_FAILURE, "cannot load font: %s", MESSAGE_FONT_FILE);
+  }
+
+  // a missing fallback font only loses its characters
+  struct {
+    FONT_type *font;
+    const char *const *fallback;
+  } chains[] = {
+      {fonts->time, time_font_fallback},
+      {fonts->date, date_font_fallback},
+      {fonts->message, message_font_fallback},
+  };
+  for (size_t i = 0; i < SIZE_OF_ARRAY(chains); ++i) {
+    for (const char *const *f = chains[i].fallback; *f != NULL; ++f) {
+      if (!FONT_fallback(chains[i].font, *f) && verbose > 0) {
+        printf("fallback font not loaded: %s\n", *f);
+      }
+    }
+  }
+
+  // one distance field per glyph and face serves every size
+  FONT_type *all[] = {fonts->time, fonts->date, fonts->message};
+  for (size_t i = 0; sdf && i < SIZE_OF_ARRAY(all); ++i) {
+    if (!FONT_sdf(all[i], true)) {
+      errx(EXIT_FAILURE, "distance fields need FreeType 2.11 or later");
+    }
+  }
+
+  for (size_t i = 0; atlas != NULL && i < SIZE_OF_ARRAY(all); ++i) {
+    if (!FONT_atlas(all[i], atlas) && verbose > 0) {
+      printf("atlas: missing font size: %zu\n", i);
+    }
+  }
+
+  fonts->arena = ARENA_create(frame_arena_size);
+  if (fonts->arena == NULL) {
+    errx(EXIT_FAILURE, "cannot allocate frame arena");
+  }
+  for (size_t i = 0; i < SIZE_OF_ARRAY(all); ++i) {
+    FONT_scratch(all[i], fonts->arena);
+  }
+}
+
+// release the fonts, their arena and their library
+static void unload_fonts(fonts_type *fonts) {
+  FONT_destroy(fonts->time);
+  FONT_destroy(fonts->date);
+  FONT_destroy(fonts->message);
+  ARENA_destroy(fonts->arena);
+  FONT_library_destroy(fonts->library);
+}
+
+// colours of the analog face from a theme
+static FACE_colours_type face_colours(const colours_type *theme) {
+  return (FACE_colours_type){
+      .dial = theme->day,
+      .hands = theme->time,
+      .seconds = theme->date,
+  };
+}
+
+// the background of a theme, a vertical gradient from the background
+// colour down to the gradient colour with any analog dial and the
+// icons over it, kept as the panel's background layer
+static void paint_background(const colours_type *theme, FACE_type *face,
+                             const icon_type *icons, size_t icon_count) {
+  const ILI9486_colour_type *a = &theme->background;
+  const ILI9486_colour_type *b = &theme->gradient;
+  const int height = ILI9486_height(display);
+  for (int y = 0; y < height; ++y) {
+    int d = height > 1 ? height - 1 : 1;
+    ILI9486_colour_type c = {
+        .red = a->red + (b->red - a->red) * y / d,
+        .green = a->green + (b->green - a->green) * y / d,
+        .blue = a->blue + (b->blue - a->blue) * y / d,
+    };
+    ILI9486_fill(display, 0, y, ILI9486_width(display), 1, c);
+  }
+  if (face != NULL) {
+    FACE_colours_type colours = face_colours(theme);
+    FACE_dial(face, &colours);
+  }
+  for (size_t i = 0; i < icon_count; ++i) {
+    const icon_type *icon = &icons[i];
+    ILI9486_rect_sprite(display, icon->x, icon->y, icon->sprite->width,
+                        icon->sprite->height, icon->pixels, icon->alpha);
+  }
+  if (!ILI9486_capture(display)) {
+    errx(EXIT_FAILURE, "cannot keep the background");
+  }
+}
+
+// apply the lines of an icon command: "NAME X Y" places a sprite,
+// replacing any icon at the same place, and "clear" removes them all;
+// every line is answered on the client socket
+static void icon_command(int client_fd, char *command, SPRITE_type *sheet,
+                         icon_type *icons, size_t *icon_count) {
+
+  char *last = NULL;
+  for (char *line = strtok_r(command, "\r\n", &last); line != NULL;
+       line = strtok_r(NULL, "\r\n", &last)) {
+
+    char name[sizeof(((SPRITE_entry_type *)NULL)->name)];
+    int x = 0;
+    int y = 0;
+    char extra = 0;
+    int n = sscanf(line, "%31s %d %d %c", name, &x, &y, &extra);
+    if (n == 1 && strcmp(name, "clear") == 0) {
+      *icon_count = 0;
+      dprintf(client_fd, "ok\r\n");
+      continue;
+    }
+    if (n != 3) {
+      dprintf(client_fd, "invalid: %s (name x y, or clear)\r\n", line);
+      continue;
+    }
+
+    icon_type icon = {.x = x, .y = y};
+    icon.sprite = SPRITE_find(sheet, name, &icon.pixels, &icon.alpha);
+    if (icon.sprite == NULL) {
+      dprintf(client_fd, "unknown icon: %s\r\n", name);
+      continue;
+    }
+    size_t i = 0;
+    while (i < *icon_count && (icons[i].x != x || icons[i].y != y)) {
+      ++i;
+    }
+    if (i == MAX_ICONS) {
+      dprintf(client_fd, "too many icons: %s\r\n", line);
+      continue;
+    }
+    icons[i] = icon;
+    if (i == *icon_count) {
+      ++*icon_count;
+    }
+    dprintf(client_fd, "ok\r\n");
+  }
+}
+
+// the background of a part, copied from the layer
+static void clear_part(const part_type *part) {
+  const clip_type *c = &part->clip;
+  ILI9486_restore(display, c->left, c->top, c->right - c->left,
+                  c->bottom - c->top);
+}
+
+// the fields, each drawn by a worker with its fonts inside its part
+static void draw_time(void *context, void *arg) {
+  const fonts_type *fonts = context;
+  const part_type *part = arg;
+  const frame_type *f = part->frame;
+
+  // each worker has its own time font, resizing is a no-op unless the
+  // time is growing and with distance fields renders nothing again
+  (void)FONT_resize(fonts->time, time_font_width, f->time_height);
+  clear_part(part);
+  render(&part->clip, 0, time_baseline, 0, 0, f->time, fonts->time,
+         f->theme->time);
+}
+
+static void draw_date(void *context, void *arg) {
+  const fonts_type *fonts = context;
+  const part_type *part = arg;
+  const frame_type *f = part->frame;
+
+  clear_part(part);
+  render(&part->clip, f->date_x, date_baseline, 0, f->date_cell, f->day,
+         fonts->date, f->theme->day);
+  render(&part->clip, f->date_x + f->day_width, date_baseline, 0,
+         f->date_cell, f->date, fonts->date, f->theme->date);
+}
+
+static void draw_message(void *context, void *arg) {
+  const fonts_type *fonts = context;
+  const part_type *part = arg;
+  const frame_type *f = part->frame;
+
+  clear_part(part);
+  render_message(&part->clip, 0, message_baseline, f->m_offset, f->m_cell,
+                 f->m_ascent, f->m_descent, f->message, f->m_first,
+                 fonts->message, f->theme->message);
+}
+
+// move the ticker left by a number of pixels, the first character
+// leaves once all of its cells have gone and the message restarts at
+// its end
+static void advance_ticker(const MESSAGE_type *message, int cell,
+                           int64_t pixels, size_t *first, int *offset) {
+
+  // a message without width cannot move
+  if (*first >= message->length || message->cell[message->length] == 0) {
+    *first = 0;
+    *offset = 0;
+    return;
+  }
+
+  // whole passes of the message do not change what is shown
+  pixels %= (int64_t)message->cell[message->length] * cell;
+
+  while (pixels > 0) {
+    int left = (int)(message->cell[*first + 1] - message->cell[*first]) *
+                   cell - *offset;
+    if (pixels < left) {
+      *offset += (int)pixels;
+      return;
+    }
+    pixels -= left;
+    *offset = 0;
+    if (++*first == message->length) {
+      *first = 0;
+    }
+  }
+}
+
+// keep every page resident, including those mapped later, and fault
+// in the stack so that drawing a second never waits for paging
+static void lock_memory(void) {
+
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+    err(EXIT_FAILURE, "cannot lock memory");
+  }
+
+  volatile uint8_t stack[STACK_PREFAULT];
+  for (size_t i = 0; i < sizeof(stack); i += 512) {
+    stack[i] = 0;
+  }
+}
+
+// look up and render each character of a string once, filling the
+// codepoint tables and glyph caches before they are needed
+static void warm_glyphs(FONT_type *font, const char *str) {
+
+  utf8_cursor_type cursor;
+  utf8_cursor_init(&cursor, str);
+
+  uint32_t c = 0;
+  while (utf8_cursor_next(&cursor, &c)) {
+    FONT_glyph_type glyph;
+    (void)FONT_glyph(font, c, &glyph);
+  }
+}
+
+// record how many microseconds after its second the time was sent
+static void jitter_add(jitter_type *jitter, unsigned int late) {
+
+  unsigned int bucket = late / 1000;
+  if (bucket >= JITTER_BUCKETS) {
+    bucket = JITTER_BUCKETS - 1;
+  }
+  ++jitter->histogram[bucket];
+  ++jitter->count;
+  jitter->total += late;
+  if (late > jitter->max) {
+    jitter->max = late;
+  }
+}
+
+// upper bound in milliseconds of the bucket holding a percentile
+static unsigned int jitter_percentile(const jitter_type *jitter,
+                                      unsigned int percent) {
+
+  unsigned int wanted = (jitter->count * percent + 99) / 100;
+  unsigned int seen = 0;
+  for (unsigned int i = 0; i < JITTER_BUCKETS; ++i) {
+    seen += jitter->histogram[i];
+    if (seen >= wanted) {
+      return i + 1;
+    }
+  }
+  return JITTER_BUCKETS;
+}
+
+// print the ticks since the last report and start again
+static void jitter_report(jitter_type *jitter) {
+
+  if (jitter->count > 0) {
+    printf("ticks: %u  late p50: <%u ms  p99: <%u ms  max: %u us  "
+           "mean: %" PRIu64 " us\n",
+           jitter->count, jitter_percentile(jitter, 50),
+           jitter_percentile(jitter, 99), jitter->max,
+           jitter->total / jitter->count);
+  }
+  memset(jitter, 0, sizeof(*jitter));
+}
+
+// microseconds from the start of second clk to a time
+static int64_t since_second(time_t clk, const struct timespec *t) {
+  return (int64_t)(t->tv_sec - clk) * 1000000 + t->tv_nsec / 1000;
+}
+
+// print the percentiles of each stage of the benchmarked ticks
+static void bench_report(int64_t *samples[BENCH_STAGES], size_t count) {
+
+  static const unsigned int percent[] = {50, 90, 99, 100};
+
+  printf("ticks: %zu  microseconds after the second\n", count);
+  printf("%-12s %8s %8s %8s %8s\n", "stage", "p50", "p90", "p99", "max");
+  for (size_t s = 0; s < BENCH_STAGES; ++s) {
+    printf("%-12s", bench_stages[s]);
+    for (size_t p = 0; p < SIZE_OF_ARRAY(percent); ++p) {
+      printf(" %8" PRId64,
+             BENCH_percentile(samples[s], count, percent[p]));
+    }
+    printf("\n");
+  }
+}
+
 void usage(const char *program) {
   printf("usage: %s [options]\n", program);
   printf("       --help                 -h            this message\n"
          "       --verbose              -v            more messages\n"
+         "       --analog=FPS           -A FPS        analog face, the seconds "
+         "hand moves FPS\n"
+         "                                            times a second\n"
+         "       --atlas=FILE           -a FILE       pre-rendered glyphs from "
+         "lcd_atlas\n"
          "       --daemon               -b            background as a daemon\n"
+         "       --bench=N              -B N          time N ticks in stages "
+         "and exit\n"
+         "       --bench-panel          -f            measure fill rate and "
+         "bus throughput and exit\n"
+         "       --calibrate            -C            find the fastest SPI "
+         "settings and exit\n"
+         "       --colour=P.F=NAME      -c P.F=NAME   X11 colour for period P "
+         "field F\n"
+         "       --grow                 -g            the time grows into place "
+         "each minute\n"
+         "       --jobs=N               -j N          draw with N threads, "
+         "default: one per CPU\n"
+         "       --model=NAME           -m NAME       panel model, default: "
+         "waveshare-c\n"
+         "       --cpu=R[,F]            -P R[,F]      draw on CPU R and flush "
+         "panels on CPU F\n"
+         "       --panel=A:RS:RST       -p A:RS:RST   panel at SPI address A "
+         "with RS and reset GPIO\n"
+         "                                            pins, repeat for panels "
+         "side by side\n"
+         "       --realtime             -R            lock memory, real-time "
+         "priority, report\n"
+         "                                            how late each second is "
+         "shown\n"
          "       --rotate               -r            rotate display 180 "
-         "degrees\n");
+         "degrees\n"
+         "       --sdf                  -s            scale glyphs from "
+         "distance fields\n"
+         "       --simulate             -S            no hardware, simulate "
+         "the SPI bus timing\n"
+         "       --sprites=FILE         -i FILE       icons from lcd_sprite, "
+         "placed through\n"
+         "                                            " UNIX_SOCKET_ICON "\n"
+         "       --touch                -t            enable the touch panel\n"
+         "       --touch-calibration=C  -T C          touch coefficients "
+         "XX,XY,X0,YX,YY,Y0\n"
+         "       --warm                 -w            do not reset display if "
+         "already set up\n");
+  printf("models:");
+  for (size_t i = 0; ILI9486_model(i) != NULL; ++i) {
+    printf(" %s", ILI9486_model(i));
+  }
+  printf("\n");
   exit(1);
 }
 
+#if !TESTING
 int main(int argc, char *argv[]) {
 
   extern char *optarg;
@@ -158,26 +739,179 @@ int main(int argc, char *argv[]) {
   // options descriptor
   static struct option longopts[] = {
       {"help", no_argument, NULL, 'h'},
+      {"atlas", required_argument, NULL, 'a'},
+      {"analog", required_argument, NULL, 'A'},
       {"verbose", no_argument, NULL, 'v'},
       {"daemon", no_argument, NULL, 'b'},
+      {"bench", required_argument, NULL, 'B'},
+      {"bench-panel", no_argument, NULL, 'f'},
+      {"calibrate", no_argument, NULL, 'C'},
+      {"colour", required_argument, NULL, 'c'},
+      {"grow", no_argument, NULL, 'g'},
+      {"jobs", required_argument, NULL, 'j'},
+      {"sprites", required_argument, NULL, 'i'},
+      {"model", required_argument, NULL, 'm'},
+      {"cpu", required_argument, NULL, 'P'},
+      {"panel", required_argument, NULL, 'p'},
+      {"realtime", no_argument, NULL, 'R'},
       {"rotate", no_argument, NULL, 'r'},
+      {"sdf", no_argument, NULL, 's'},
+      {"simulate", no_argument, NULL, 'S'},
+      {"touch", no_argument, NULL, 't'},
+      {"touch-calibration", required_argument, NULL, 'T'},
+      {"warm", no_argument, NULL, 'w'},
       //{"pidfile", required_argument, NULL, 'p'},
       {NULL, 0, NULL, 0}};
 
   const char *program = "lcd_clock";
   int verbose = 0;
   bool background = false;
+  bool calibrate = false;
+  bool warm = false;
+  bool sdf = false;
+  bool grow = false;
+  unsigned int analog_fps = 0;
+  const char *atlas_file = NULL;
+  const char *sprite_file = NULL;
+  const char *colour_spec[32];
+  size_t colour_count = 0;
   ILI9486_rotation_type rotate = ILI9486_ROTATION_0;
+  ILI9486_config_type panels[ILI9486_MAX_TILES];
+  size_t panel_count = 0;
+  const char *model = NULL;
+  bool touch_enabled = false;
+  TOUCH_config_type touch_config = TOUCH_CONFIG_WAVESHARE;
+  bool realtime = false;
+  int render_cpu = -1;
+  int flush_cpu = -1;
+  size_t bench_ticks = 0;
+  bool bench_panel = false;
+  bool simulate = false;
+  long workers = sysconf(_SC_NPROCESSORS_ONLN);
 
   int ch = 0;
-  while ((ch = getopt_long(argc, argv, "brvh", longopts, NULL)) != -1)
+  while ((ch = getopt_long(argc, argv, "A:a:bB:Cc:fgi:j:m:P:p:RrSstT:wvh", longopts,
+                           NULL)) != -1)
     switch (ch) {
+    case 'A': {
+      char *end = NULL;
+      unsigned long n = strtoul(optarg, &end, 10);
+      if (end == optarg || *end != '\0' || n == 0 || n > 60) {
+        errx(EXIT_FAILURE, "invalid analog frame rate: %s (1…60)", optarg);
+      }
+      analog_fps = n;
+      break;
+    }
+    case 'a':
+      atlas_file = optarg;
+      break;
     case 'b':
       background = true;
       break;
+    case 'B': {
+      char *end = NULL;
+      unsigned long n = strtoul(optarg, &end, 10);
+      if (end == optarg || *end != '\0' || n == 0 || n > 86400) {
+        errx(EXIT_FAILURE, "invalid bench ticks: %s (1…86400)", optarg);
+      }
+      bench_ticks = n;
+      break;
+    }
+    case 'C':
+      calibrate = true;
+      break;
+    case 'f':
+      bench_panel = true;
+      break;
+    case 'g':
+      grow = true;
+      break;
+    case 'c':
+      if (colour_count == SIZE_OF_ARRAY(colour_spec)) {
+        errx(EXIT_FAILURE, "too many colours");
+      }
+      colour_spec[colour_count++] = optarg;
+      break;
+    case 'i':
+      sprite_file = optarg;
+      break;
+    case 'j': {
+      char *end = NULL;
+      workers = strtol(optarg, &end, 10);
+      if (end == optarg || *end != '\0' || workers < 1 ||
+          workers > POOL_MAX_WORKERS) {
+        errx(EXIT_FAILURE, "invalid jobs: %s (1…%d)", optarg,
+             POOL_MAX_WORKERS);
+      }
+      break;
+    }
+    case 'm':
+      model = optarg;
+      break;
+    case 'P': {
+      int n = sscanf(optarg, "%d,%d", &render_cpu, &flush_cpu);
+      if (n < 1 || render_cpu < 0 || (n == 2 && flush_cpu < 0)) {
+        errx(EXIT_FAILURE, "invalid cpu: %s (render[,flush])", optarg);
+      }
+      if (n == 1) {
+        flush_cpu = render_cpu;
+      }
+      break;
+    }
+    case 'p': {
+      if (panel_count == SIZE_OF_ARRAY(panels)) {
+        errx(EXIT_FAILURE, "too many panels");
+      }
+      ILI9486_config_type config = ILI9486_CONFIG_WAVESHARE;
+      if (sscanf(optarg, "%d:%d:%d", &config.spi_address, &config.rs_pin,
+                 &config.reset_pin) != 3) {
+        errx(EXIT_FAILURE, "invalid panel: %s (address:rs:reset)", optarg);
+      }
+      // each pin is written by one flush thread only, and creating a
+      // panel resets it, so no pin may be shared
+      if (config.rs_pin == config.reset_pin) {
+        errx(EXIT_FAILURE, "panel: %s uses pin: %d twice", optarg,
+             config.rs_pin);
+      }
+      for (size_t i = 0; i < panel_count; ++i) {
+        const int pins[] = {panels[i].rs_pin, panels[i].reset_pin};
+        for (size_t k = 0; k < SIZE_OF_ARRAY(pins); ++k) {
+          if (pins[k] == config.rs_pin || pins[k] == config.reset_pin) {
+            errx(EXIT_FAILURE, "panel: %s shares pin: %d with panel: %zu",
+                 optarg, pins[k], i);
+          }
+        }
+      }
+      panels[panel_count++] = config;
+      break;
+    }
+    case 'R':
+      realtime = true;
+      break;
     case 'r':
       rotate = ILI9486_ROTATION_180;
       break;
+    case 's':
+      sdf = true;
+      break;
+    case 'S':
+      simulate = true;
+      break;
+    case 't':
+      touch_enabled = true;
+      break;
+    case 'T': {
+      TOUCH_calibration_type *c = &touch_config.calibration;
+      if (sscanf(optarg, "%lf,%lf,%lf,%lf,%lf,%lf", &c->xx, &c->xy, &c->x0,
+                 &c->yx, &c->yy, &c->y0) != 6) {
+        errx(EXIT_FAILURE, "invalid touch calibration: %s", optarg);
+      }
+      touch_enabled = true;
+      break;
+    }
+    case 'w':
+      warm = true;
+      break;
     case 'v':
       ++verbose;
       break;
@@ -214,65 +948,154 @@ int main(int argc, char *argv[]) {
     /* NOTREACHED */
   }
 
+  // Unix socket for placing icons, only with a sprite sheet
+  int icon_fd = -1;
+  if (sprite_file != NULL) {
+    icon_fd = make_listen_socket(UNIX_SOCKET_ICON);
+  }
+
   // LCD configuration
 
-  if (!ILI9486_create(rotate)) {
-    err(EXIT_FAILURE, "ili9486 create failed");
+  if (panel_count == 0) {
+    panels[panel_count++] = (ILI9486_config_type)ILI9486_CONFIG_WAVESHARE;
   }
 
-  ILI9486_clear(0, 0, 0);
-
-  FT_Library library;
+  // the simulated panels share one bus, as real ones do
+  BENCH_bus_type *bus = NULL;
+  if (simulate) {
+    bus = BENCH_bus_create(simulated_overhead);
+    if (bus == NULL) {
+      errx(EXIT_FAILURE, "cannot create simulated bus");
+    }
+  }
 
-  int error = FT_Init_FreeType(&library);
-  if (error != 0) {
-    err(EXIT_FAILURE, "FreeType setup failed: error: %d", error);
+  // several panels become one canvas, each flushed by its own thread;
+  // in real-time mode even a single panel gets a thread so that
+  // flushing can run above drawing, and on its own CPU
+  ILI9486_type *lcd[ILI9486_MAX_TILES];
+  for (size_t i = 0; i < panel_count; ++i) {
+    panels[i].rotate = rotate;
+    panels[i].model = model;
+    panels[i].state_file = STATE_FILE;
+    panels[i].threaded = panel_count > 1 || realtime || flush_cpu >= 0;
+    panels[i].transport = (bus != NULL) ? BENCH_bus_transport(bus) : NULL;
+    lcd[i] = ILI9486_create(&panels[i], warm);
+    if (lcd[i] == NULL) {
+      errx(EXIT_FAILURE, "ili9486 create failed for panel: %zu", i);
+    }
+  }
+  if (calibrate) {
+    for (size_t i = 0; i < panel_count; ++i) {
+      ILI9486_tuning_type tuning;
+      if (!ILI9486_calibrate(lcd[i], &tuning)) {
+        errx(EXIT_FAILURE, "calibration failed for panel: %zu", i);
+      }
+      printf("panel: %zu  SPI clock: %u Hz  chunk: %zu bytes\n", i,
+             (unsigned int)tuning.bps, tuning.chunk);
+      ILI9486_clear(lcd[i], 0, 0, 0);
+      ILI9486_refresh(lcd[i]);
+      if (!ILI9486_destroy(lcd[i])) {
+        err(EXIT_FAILURE, "ili9486 destroy failed");
+      }
+    }
+    return EXIT_SUCCESS;
+  }
+  if (panel_count == 1) {
+    display = lcd[0];
+  } else {
+    display = ILI9486_tile(lcd, panel_count, panel_count);
+    if (display == NULL) {
+      errx(EXIT_FAILURE, "cannot tile %zu panels", panel_count);
+    }
   }
 
-  FT_Face time_face;
-  error = FT_New_Face(library, TIME_FONT_FILE, 0, &time_face);
-  if (error == FT_Err_Unknown_File_Format) {
-    err(EXIT_FAILURE, "FreeType unknown font format: %d", error);
-  } else if (error != 0) {
-    err(EXIT_FAILURE, "FreeType face error: %d", error);
+  // flushing outranks drawing, which outranks everything else
+  int flush_priority = -1;
+  int render_priority = -1;
+  if (realtime) {
+    int low = sched_get_priority_min(SCHED_FIFO);
+    int high = sched_get_priority_max(SCHED_FIFO);
+    flush_priority = low + (high - low) / 2 + 1;
+    render_priority = flush_priority - 1;
   }
-  error = FT_Set_Pixel_Sizes(time_face, time_font_width, time_font_height);
-  if (error != 0) {
-    err(EXIT_FAILURE, "FreeType pixel sizes error: %d", error);
+  if (!ILI9486_realtime(display, flush_priority, flush_cpu)) {
+    errx(EXIT_FAILURE, "cannot set up flush threads");
   }
 
-  FT_Face date_face;
-  error = FT_New_Face(library, DATE_FONT_FILE, 0, &date_face);
-  if (error == FT_Err_Unknown_File_Format) {
-    err(EXIT_FAILURE, "FreeType unknown font format: %d", error);
-  } else if (error != 0) {
-    err(EXIT_FAILURE, "FreeType face error: %d", error);
+  ILI9486_clear(display, 0, 0, 0);
+
+  if (bench_panel) {
+    BENCH_result_type results[BENCH_PANEL_PATTERNS];
+    BENCH_panel(display, panel_bench_time, results);
+    BENCH_panel_report(results, BENCH_PANEL_PATTERNS, ILI9486_bps(display));
+    ILI9486_clear(display, 0, 0, 0);
+    ILI9486_refresh(display);
+    if (!ILI9486_destroy(display)) {
+      err(EXIT_FAILURE, "ili9486 destroy failed");
+    }
+    BENCH_bus_destroy(bus);
+    return EXIT_SUCCESS;
   }
-  error = FT_Set_Pixel_Sizes(date_face, date_font_width, date_font_height);
-  if (error != 0) {
-    err(EXIT_FAILURE, "FreeType pixel sizes error: %d", error);
+
+  // the touch panel is on the first panel, turning the display turns
+  // the touch coordinates with it
+  TOUCH_type *touch = NULL;
+  if (touch_enabled) {
+    if (rotate == ILI9486_ROTATION_180) {
+      TOUCH_calibration_type *c = &touch_config.calibration;
+      c->xx = -c->xx;
+      c->xy = -c->xy;
+      c->x0 = touch_config.width - 1 - c->x0;
+      c->yx = -c->yx;
+      c->yy = -c->yy;
+      c->y0 = touch_config.height - 1 - c->y0;
+    }
+    touch = TOUCH_create(&touch_config, NULL);
+    if (touch == NULL) {
+      errx(EXIT_FAILURE, "touch panel create failed");
+    }
   }
 
-  FT_Face message_face;
-  error = FT_New_Face(library, MESSAGE_FONT_FILE, 0, &message_face);
-  if (error == FT_Err_Unknown_File_Format) {
-    err(EXIT_FAILURE, "FreeType unknown font format: %d", error);
-  } else if (error != 0) {
-    err(EXIT_FAILURE, "FreeType face error: %d", error);
+  // glyphs are taken from the atlas first, FreeType is only used for
+  // codepoints that were not baked
+  ATLAS_type *atlas = NULL;
+  if (atlas_file != NULL) {
+    atlas = ATLAS_open(atlas_file);
+    if (atlas == NULL) {
+      errx(EXIT_FAILURE, "cannot load atlas: %s", atlas_file);
+    }
   }
-  error =
-      FT_Set_Pixel_Sizes(message_face, message_font_width, message_font_height);
-  if (error != 0) {
-    err(EXIT_FAILURE, "FreeType pixel sizes error: %d", error);
+
+  // icons are drawn straight from the mapped sheet, which must already
+  // be in the panel's pixel format
+  SPRITE_type *sheet = NULL;
+  if (sprite_file != NULL) {
+    sheet = SPRITE_open(sprite_file);
+    if (sheet == NULL) {
+      errx(EXIT_FAILURE, "cannot load sprites: %s", sprite_file);
+    }
+    if (SPRITE_format(sheet) != ILI9486_format(display)) {
+      errx(EXIT_FAILURE, "sprites are not in the panel's pixel format: %s",
+           sprite_file);
+    }
   }
 
-  typedef struct {
-    FT_Color time;
-    FT_Color day;
-    FT_Color date;
-    FT_Color message;
-    FT_Color background;
-  } colours_type;
+  // the fields are drawn in parallel, each worker with its own fonts
+  if (workers > POOL_MAX_WORKERS) {
+    workers = POOL_MAX_WORKERS;
+  } else if (workers < 1) {
+    workers = 1;
+  }
+  static fonts_type fonts[POOL_MAX_WORKERS];
+  void *contexts[POOL_MAX_WORKERS];
+  for (long i = 0; i < workers; ++i) {
+    load_fonts(&fonts[i], sdf, atlas, (i == 0) ? verbose : 0);
+    contexts[i] = &fonts[i];
+  }
+  POOL_type *pool = POOL_create(workers, contexts);
+  if (pool == NULL) {
+    errx(EXIT_FAILURE, "cannot start %ld workers", workers);
+  }
 
   typedef struct {
     colours_type early;
@@ -324,13 +1147,85 @@ int main(int argc, char *argv[]) {
               .background = X11_RGB_red,
           },
   };
+
+  // colours by name override the theme, as: period.field=name
+  for (size_t i = 0; i < colour_count; ++i) {
+    const char *spec = colour_spec[i];
+    const char *dot = strchr(spec, '.');
+    const char *equals = strchr(spec, '=');
+    if (dot == NULL || equals == NULL || equals < dot) {
+      errx(EXIT_FAILURE, "invalid colour: %s (period.field=name)", spec);
+    }
+
+    const struct {
+      const char *name;
+      colours_type *colours;
+    } periods[] = {
+        {"early", &themes.early},         {"morning", &themes.morning},
+        {"afternoon", &themes.afternoon}, {"evening", &themes.evening},
+        {"unsync", &themes.unsync},
+    };
+    const struct {
+      const char *name;
+      size_t offset;
+    } fields[] = {
+        {"time", offsetof(colours_type, time)},
+        {"day", offsetof(colours_type, day)},
+        {"date", offsetof(colours_type, date)},
+        {"message", offsetof(colours_type, message)},
+        {"background", offsetof(colours_type, background)},
+        {"gradient", offsetof(colours_type, gradient)},
+    };
+
+    colours_type *colours = NULL;
+    for (size_t p = 0; p < SIZE_OF_ARRAY(periods); ++p) {
+      if (strlen(periods[p].name) == (size_t)(dot - spec) &&
+          memcmp(periods[p].name, spec, dot - spec) == 0) {
+        colours = periods[p].colours;
+      }
+    }
+    ILI9486_colour_type *colour = NULL;
+    for (size_t f = 0; colours != NULL && f < SIZE_OF_ARRAY(fields); ++f) {
+      if (strlen(fields[f].name) == (size_t)(equals - dot - 1) &&
+          memcmp(fields[f].name, dot + 1, equals - dot - 1) == 0) {
+        colour = (ILI9486_colour_type *)((char *)colours + fields[f].offset);
+      }
+    }
+    if (colour == NULL) {
+      errx(EXIT_FAILURE, "unknown period or field: %s", spec);
+    }
+    if (!COLOUR_name(equals + 1, strlen(equals + 1), colour)) {
+      errx(EXIT_FAILURE, "unknown colour: %s", equals + 1);
+    }
+    if (colour == &colours->gradient) {
+      colours->graded = true;
+    }
+  }
+
+  // backgrounds are flat unless given a gradient
+  colours_type *all_themes[] = {&themes.early, &themes.morning,
+                                &themes.afternoon, &themes.evening,
+                                &themes.unsync};
+  for (size_t i = 0; i < SIZE_OF_ARRAY(all_themes); ++i) {
+    if (!all_themes[i]->graded) {
+      all_themes[i]->gradient = all_themes[i]->background;
+    }
+  }
+
   colours_type *theme = &themes.morning;
 
-  ILI9486_clear(theme->background.red, theme->background.green,
-                theme->background.blue);
-  ILI9486_refresh();
+  // a warm start leaves the previous display until the first frame
+  if (!warm) {
+    ILI9486_clear(display, theme->background.red, theme->background.green,
+                  theme->background.blue);
+    ILI9486_refresh(display);
+  }
+
+  // the CJK monospace fonts have square wide characters, so one cell,
+  // the advance of ASCII, is half the font height
+  const int date_cell_width = date_font_height / 2;
+  const int message_cell_width = message_font_height / 2;
 
-  size_t m_pos = 0;
   int m_offset = 0;
 #if 1
   char message[1024];
@@ -354,9 +1249,145 @@ int main(int argc, char *argv[]) {
   memset(message1, 0, sizeof(message1));
   memset(message2, 0, sizeof(message2));
 
+  // the message is parsed and laid out once when it arrives, the
+  // scrolling line starts at codepoint m_first
+  static MESSAGE_type m_message;
+  size_t m_first = 0;
+  (void)MESSAGE_parse(&m_message, message);
+
+  // height of the band behind message text with a background colour
+  FT_Face m_face = FONT_face(fonts[0].message);
+  const int m_ascent = m_face->size->metrics.ascender >> 6;
+  const int m_descent = -m_face->size->metrics.descender >> 6;
+
+  // bands of the time and date lines, only sent when they change
+  FT_Face t_face = FONT_face(fonts[0].time);
+  const int t_ascent = t_face->size->metrics.ascender >> 6;
+  const int t_descent = -t_face->size->metrics.descender >> 6;
+  FT_Face d_face = FONT_face(fonts[0].date);
+  const int d_ascent = d_face->size->metrics.ascender >> 6;
+  const int d_descent = -d_face->size->metrics.descender >> 6;
+
+  const colours_type *last_theme = NULL;
+  char last_time[20] = "";
+  int last_time_height = 0;
+  char last_date[40] = "";
+
+  // each field is drawn in a band of the screen, where two bands would
+  // overlap they are split halfway so no two workers write the same
+  // pixels; the message band is cut into a strip for each worker as a
+  // new message can need many glyphs rendered at once
+  const int width = ILI9486_width(display);
+  const int time_date =
+      (time_baseline + t_descent + date_baseline - d_ascent) / 2;
+  const int date_message =
+      (date_baseline + d_descent + message_baseline - m_ascent) / 2;
+  static frame_type frame;
+  frame.date_cell = date_cell_width;
+  frame.m_cell = message_cell_width;
+  frame.m_ascent = m_ascent;
+  frame.m_descent = m_descent;
+  frame.message = &m_message;
+
+  part_type parts[2 + POOL_MAX_WORKERS];
+  size_t part_count = 0;
+  parts[part_count++] = (part_type){
+      .draw = draw_time,
+      .clip = {.right = width, .bottom = time_date},
+  };
+  parts[part_count++] = (part_type){
+      .draw = draw_date,
+      .clip = {.top = time_date, .right = width, .bottom = date_message},
+  };
+  for (long i = 0; i < workers; ++i) {
+    parts[part_count++] = (part_type){
+        .draw = draw_message,
+        .clip = {.left = width * i / workers,
+                 .top = date_message,
+                 .right = width * (i + 1) / workers,
+                 .bottom = ILI9486_height(display)},
+    };
+  }
+  for (size_t i = 0; i < part_count; ++i) {
+    parts[i].frame = &frame;
+  }
+
+  // the rows of message text, scrolled in place between redraws, and
+  // the columns a scroll uncovers
+  const int m_top = message_baseline - m_ascent;
+  const int m_bottom = message_baseline + m_descent;
+  part_type uncovered = {.draw = draw_message, .frame = &frame};
+  int last_position = -1;
+
+  // icons are part of the background, an icon on the message rows
+  // would move with a scroll so the ticker is redrawn instead
+  icon_type icons[MAX_ICONS];
+  size_t icon_count = 0;
+  bool icons_changed = false;
+  bool ticker_icons = false;
+
+  // the analog face takes the place of the time and date, above the
+  // rows that the message scrolls
+  FACE_type *face = NULL;
+  size_t face_frames = 0;
+  uint64_t face_pixels = 0;
+  if (analog_fps > 0) {
+    int bottom = m_top < date_message ? m_top : date_message;
+    face = FACE_create(display, width / 2, bottom / 2, bottom / 2 - 2);
+    if (face == NULL) {
+      errx(EXIT_FAILURE, "cannot create analog face");
+    }
+  }
+
+  // nothing the loop touches may be paged in or rendered for the first
+  // time once the clock is running
+  if (realtime) {
+    for (long w = 0; w < workers; ++w) {
+      warm_glyphs(fonts[w].time, "0123456789:");
+      warm_glyphs(fonts[w].date, " 0123456789-");
+      for (size_t i = 0; i < SIZE_OF_ARRAY(wday); ++i) {
+        warm_glyphs(fonts[w].date, wday[i]);
+      }
+      warm_glyphs(fonts[w].message, message);
+    }
+    lock_memory();
+  }
+  if (!POOL_realtime(pool, render_priority, render_cpu)) {
+    errx(EXIT_FAILURE, "cannot set up workers");
+  }
+  realtime_self(render_priority, render_cpu);
+
+  jitter_type jitter;
+  memset(&jitter, 0, sizeof(jitter));
+
+  // the first tick starts part way through a second and is not counted
+  int64_t *bench_samples[BENCH_STAGES];
+  size_t bench_count = 0;
+  bool bench_started = false;
+  for (size_t s = 0; s < BENCH_STAGES && bench_ticks > 0; ++s) {
+    bench_samples[s] = calloc(bench_ticks, sizeof(int64_t));
+    if (bench_samples[s] == NULL) {
+      err(EXIT_FAILURE, "cannot allocate bench samples");
+    }
+  }
+
+  // the ticker moves by the time since it started, so its speed does
+  // not depend on how long each frame takes
+  struct timespec ticker_start;
+  clock_gettime(CLOCK_MONOTONIC, &ticker_start);
+  int64_t scrolled = 0;
+
   bool sync = false;
+  int last_minute = -1;
   for (;;) {
-    time_t clk = time(NULL);
+    // nothing allocated while drawing outlives a frame
+    for (long w = 0; w < workers; ++w) {
+      ARENA_reset(fonts[w].arena);
+    }
+
+    struct timespec seen;
+    clock_gettime(CLOCK_REALTIME, &seen);
+    time_t clk = seen.tv_sec;
     struct tm now;
     localtime_r(&clk, &now);
 
@@ -364,6 +1395,29 @@ int main(int argc, char *argv[]) {
       struct ntptimeval ntv;
       sync = ntp_gettime(&ntv) != TIME_ERROR;
     }
+    if (now.tm_min != last_minute) {
+      if (verbose > 1) {
+        GPIO_counters_type gpio;
+        GPIO_counters(&gpio);
+        printf("gpio writes: %" PRIu64 "  ioctls: %" PRIu64
+               "  skipped: %" PRIu64 "\n",
+               gpio.writes, gpio.ioctls, gpio.writes - gpio.ioctls);
+        for (long w = 0; w < workers; ++w) {
+          printf("worker: %ld  arena peak: %zu bytes\n", w,
+                 ARENA_peak(fonts[w].arena));
+        }
+        if (face_frames > 0) {
+          printf("face frames: %zu  pixels: %" PRIu64 "/frame\n",
+                 face_frames, face_pixels / face_frames);
+        }
+        face_frames = 0;
+        face_pixels = 0;
+      }
+      if (realtime || verbose > 0) {
+        jitter_report(&jitter);
+      }
+      last_minute = now.tm_min;
+    }
     if (!sync) {
       theme = &themes.unsync;
     } else if (now.tm_hour < 6) {
@@ -376,50 +1430,172 @@ int main(int argc, char *argv[]) {
       theme = &themes.evening;
     }
 
-    ILI9486_clear(theme->background.red, theme->background.green,
-                  theme->background.blue);
-
-    char buffer[20];
-
-    (void)strftime(buffer, sizeof(buffer), "%H:%M:%S", &now);
-    render(0, 100, 0, 0, buffer, library, time_face, theme->time,
-           theme->background);
+    // the workers draw the fields while the changes are worked out
+    frame.theme = theme;
+    (void)strftime(frame.time, sizeof(frame.time), "%H:%M:%S", &now);
+    frame.time_height = time_font_height;
+    long into_minute = now.tm_sec * 1000L + seen.tv_nsec / 1000000;
+    if (grow && into_minute < grow_time) {
+      frame.time_height =
+          time_font_height * (grow_time + into_minute) / (2 * grow_time);
+    }
+    frame.day = wday[now.tm_wday];
+    (void)strftime(frame.date, sizeof(frame.date), " %m-%d", &now);
+    frame.m_first = m_first;
+    frame.m_offset = m_offset;
+
+    // centre the day and date from their cell widths
+    frame.day_width = utf8_string_width(frame.day) * date_cell_width;
+    int date_width = utf8_string_width(frame.date) * date_cell_width;
+    frame.date_x = (width - frame.day_width - date_width) / 2;
+
+    // a new theme or icons paint the background once, each part drawn
+    // from then on starts from a copy of it; only changed fields are
+    // drawn and sent, the time before anything else
+    bool repaint = theme != last_theme || icons_changed;
+    if (repaint) {
+      paint_background(theme, face, icons, icon_count);
+      ILI9486_damage(display, 0, 0, width, ILI9486_height(display),
+                     ILI9486_PRIORITY_NORMAL);
+      ticker_icons = false;
+      for (size_t i = 0; i < icon_count; ++i) {
+        ticker_icons = ticker_icons ||
+                       (icons[i].y < m_bottom &&
+                        icons[i].y + icons[i].sprite->height > m_top);
+      }
+      last_theme = theme;
+      icons_changed = false;
+    }
+    bool tick = strcmp(frame.time, last_time) != 0;
+    bool grown = frame.time_height != last_time_height;
+    last_time_height = frame.time_height;
+    if ((tick || grown) && face == NULL) {
+      ILI9486_damage(display, 0, time_baseline - t_ascent, width,
+                     t_ascent + t_descent, ILI9486_PRIORITY_HIGH);
+    }
+    if (tick) {
+      strlcpy(last_time, frame.time, sizeof(last_time));
+    }
 
-    const char *wday[7] = {
-        "Su日", "Mo一", "Tu二", "We三", "Th四", "Fr五", "Sa六",
-    };
+    char date[40];
+    snprintf(date, sizeof(date), "%s%s", frame.day, frame.date);
+    bool new_date = strcmp(date, last_date) != 0;
+    if (new_date && face == NULL) {
+      ILI9486_damage(display, 0, date_baseline - d_ascent, width,
+                     d_ascent + d_descent, ILI9486_PRIORITY_NORMAL);
+    }
+    if (new_date) {
+      strlcpy(last_date, date, sizeof(last_date));
+    }
 
-    render(0, 200, 0, 0, wday[now.tm_wday], library, date_face, theme->day,
-           theme->background);
+    // the ticker moves left, so unless it jumped or the background
+    // changed the pixels already drawn are shifted and only the
+    // uncovered columns are drawn; it is left alone while it is still
+    int position =
+        (int)m_message.cell[m_first] * message_cell_width + m_offset;
+    int shift = position - last_position;
+    bool redraw = last_position < 0 || repaint;
+    bool still = !redraw && shift == 0;
+    bool scroll = !redraw && !ticker_icons && shift > 0 && shift < width;
+    last_position = position;
+
+    bool draw[2 + POOL_MAX_WORKERS];
+    draw[0] = face == NULL && (tick || grown || repaint);
+    draw[1] = face == NULL && (new_date || repaint);
+    for (size_t i = 2; i < part_count; ++i) {
+      draw[i] = !scroll && !still;
+    }
+    if (still) {
+      // nothing to send
+    } else if (scroll) {
+      ILI9486_scroll(display, 0, m_top, width, m_bottom - m_top, -shift,
+                     ILI9486_PRIORITY_LOW);
+      uncovered.clip = (clip_type){
+          .left = width - shift, .top = m_top, .right = width,
+          .bottom = m_bottom};
+      if (!POOL_submit(pool, uncovered.draw, &uncovered)) {
+        errx(EXIT_FAILURE, "worker queue is full");
+      }
+    } else {
+      ILI9486_damage(display, 0, m_top, width, m_bottom - m_top,
+                     ILI9486_PRIORITY_LOW);
+    }
+    for (size_t i = 0; i < part_count; ++i) {
+      if (draw[i] && !POOL_submit(pool, parts[i].draw, &parts[i])) {
+        errx(EXIT_FAILURE, "worker queue is full");
+      }
+    }
 
-    (void)strftime(buffer, sizeof(buffer), " %m-%d", &now);
-    render(200, 200, 0, 0, buffer, library, date_face, theme->date,
-           theme->background);
+    // the hands move while the workers draw the message, restoring and
+    // drawing only around where they were and are now; the step of the
+    // second the seconds hand shows changes analog_fps times a second
+    if (face != NULL) {
+      long step = seen.tv_nsec / (1000000000 / analog_fps);
+      double seconds = now.tm_hour * 3600 + now.tm_min * 60 + now.tm_sec +
+                       (double)step / analog_fps;
+      FACE_colours_type colours = face_colours(theme);
+      size_t pixels =
+          FACE_hands(face, &colours, seconds,
+                     tick ? ILI9486_PRIORITY_HIGH : ILI9486_PRIORITY_NORMAL);
+      if (pixels > 0) {
+        ++face_frames;
+        face_pixels += pixels;
+      }
+    }
 
-    const int incr = 32; // one ASCII or ½ Chinese
-    bool trunc = render(0, 290, m_offset, incr, &message[m_pos], library,
-                        message_face, theme->message, theme->background);
+    POOL_join(pool);
+
+    // scroll by the pixels due since the ticker started
+    struct timespec ticker_now;
+    clock_gettime(CLOCK_MONOTONIC, &ticker_now);
+    int64_t ns = (int64_t)(ticker_now.tv_sec - ticker_start.tv_sec) *
+                     1000000000 +
+                 (ticker_now.tv_nsec - ticker_start.tv_nsec);
+    int64_t due = ns / 1000000 * ticker_speed / 1000;
+    advance_ticker(&m_message, message_cell_width, due - scrolled, &m_first,
+                   &m_offset);
+    scrolled = due;
+    // printf("pos: %2zu, %2d\n", m_first, m_offset);
+
+    struct timespec rendered;
+    clock_gettime(CLOCK_REALTIME, &rendered);
+
+    // finish before the next second starts so that a long message
+    // update never delays the time, what does not fit waits for the
+    // next frame
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    unsigned int deadline = 1000000 - tv.tv_usec;
+    if (deadline > frame_deadline) {
+      deadline = frame_deadline;
+    }
+    (void)ILI9486_sync(display, deadline);
+
+    // the new second is on the panel now, a clock step backwards is
+    // not counted
+    if (tick) {
+      gettimeofday(&tv, NULL);
+      int64_t late = (int64_t)(tv.tv_sec - clk) * 1000000 + tv.tv_usec;
+      if (late >= 0) {
+        jitter_add(&jitter, late > UINT_MAX ? UINT_MAX : late);
+      }
+    }
 
-    if (trunc) {
-      m_offset = 0;
-      ++m_pos;
-      while ((message[m_pos] & 0xc0) == 0x80) {
-        ++m_pos;
+    ILI9486_timing_type timing;
+    if (tick && bench_ticks > 0) {
+      if (bench_started && ILI9486_timing(display, &timing)) {
+        bench_samples[0][bench_count] = since_second(clk, &seen);
+        bench_samples[1][bench_count] = since_second(clk, &rendered);
+        bench_samples[2][bench_count] = since_second(clk, &timing.first);
+        bench_samples[3][bench_count] = since_second(clk, &timing.last);
+        ++bench_count;
       }
-      if (message[m_pos] == '\0' || m_pos > sizeof(message) - 1) {
-        m_pos = 0;
+      bench_started = true;
+      if (bench_count == bench_ticks) {
+        bench_report(bench_samples, bench_count);
+        break;
       }
-    } else {
-      m_offset += incr;
     }
-    // printf("pos: %2lu, %2d\n", m_pos, m_offset);
-
-#if 1
-    ILI9486_refresh();
-#else
-    ILI9486_sync();
-    // sleep(1);
-#endif
 
     // usleep(1000);
 
@@ -427,6 +1603,12 @@ int main(int argc, char *argv[]) {
     FD_ZERO(&accepting);
     FD_SET(server_1_fd, &accepting);
     FD_SET(server_2_fd, &accepting);
+    if (icon_fd >= 0) {
+      FD_SET(icon_fd, &accepting);
+    }
+    if (touch != NULL) {
+      FD_SET(TOUCH_fd(touch), &accepting);
+    }
 
     struct timeval timeout = {
         .tv_sec = 0,
@@ -437,6 +1619,22 @@ int main(int argc, char *argv[]) {
       err(EXIT_FAILURE, "cannot select on server socket");
     }
 
+    // tapping the message line starts it again from the beginning
+    TOUCH_event_type event;
+    while (touch != NULL && TOUCH_event(touch, &event)) {
+      if (verbose > 0) {
+        printf("touch: %d  x: %3d  y: %3d  raw: %4d %4d  pressure: %4d\n",
+               event.action, event.x, event.y, event.raw_x, event.raw_y,
+               event.pressure);
+      }
+      if (event.action == TOUCH_RELEASE &&
+          event.y >= message_baseline - m_ascent) {
+        m_first = 0;
+        m_offset = 0;
+        last_position = -1;
+      }
+    }
+
     if (FD_ISSET(server_1_fd, &accepting)) {
       int client_fd = accept(server_1_fd, NULL, NULL);
 
@@ -452,7 +1650,10 @@ int main(int argc, char *argv[]) {
 
       close(client_fd);
 
-      m_pos = 0; // reset scroll point
+      (void)MESSAGE_parse(&m_message, message); // reset scroll point
+      m_first = 0;
+      m_offset = 0;
+      last_position = -1;
     }
 
     if (FD_ISSET(server_2_fd, &accepting)) {
@@ -470,77 +1671,512 @@ int main(int argc, char *argv[]) {
 
       close(client_fd);
 
-      m_pos = 0; // reset scroll point
+      (void)MESSAGE_parse(&m_message, message); // reset scroll point
+      m_first = 0;
+      m_offset = 0;
+      last_position = -1;
+    }
+
+    if (icon_fd >= 0 && FD_ISSET(icon_fd, &accepting)) {
+      int client_fd = accept(icon_fd, NULL, NULL);
+
+      char command[512];
+      ssize_t n = read(client_fd, command, sizeof(command) - 1);
+      if (n >= 0) {
+        command[n] = '\0';
+        icon_command(client_fd, command, sheet, icons, &icon_count);
+        icons_changed = true;
+      }
+
+      close(client_fd);
     }
   }
 
   // ILI9486_rect_rgba(70, 50, 0, 0, abitmap.width, abitmap.rows,
   //                  abitmap.pitch,
   //                  abitmap.buffer);
-  ILI9486_refresh();
-  sleep(2);
+  ILI9486_refresh(display);
+
+  // only --bench leaves the loop; stop the workers before their fonts
+  if (!POOL_destroy(pool)) {
+    errx(EXIT_FAILURE, "pool destroy failed");
+  }
+  for (long i = 0; i < workers; ++i) {
+    unload_fonts(&fonts[i]);
+  }
+  ATLAS_close(atlas);
+  for (size_t s = 0; s < BENCH_STAGES && bench_ticks > 0; ++s) {
+    free(bench_samples[s]);
+  }
+
+  if (touch != NULL && !TOUCH_destroy(touch)) {
+    err(EXIT_FAILURE, "touch panel destroy failed");
+  }
 
-  if (!ILI9486_destroy()) {
+  if (!ILI9486_destroy(display)) {
     err(EXIT_FAILURE, "ili9486 destroy failed");
   }
+  SPRITE_close(sheet);
+  FACE_destroy(face);
+  BENCH_bus_destroy(bus);
 
   return EXIT_SUCCESS;
 }
+#endif
 
-static bool render(int x, int y, int x_offset, int incr, const char *str,
-                   FT_Library library, FT_Face face, FT_Color foreground,
-                   FT_Color background) {
+static void render(const clip_type *clip, int x, int y, int x_offset,
+                   int cell, const char *str, FONT_type *font,
+                   ILI9486_colour_type foreground) {
 
-  bool rc = false;
   uint32_t text[20];
   size_t text_length = SIZE_OF_ARRAY(text);
   (void)string_to_ucs4(str, text, &text_length);
 
-  FT_GlyphSlot slot = face->glyph; // a small shortcut
+  render_ucs4(clip, x, y, x_offset, cell, text, text_length, font,
+              foreground);
+}
 
-  for (size_t n = 0; n < text_length; ++n) {
+// fill the part of a rectangle inside a clip
+static void fill_clipped(const clip_type *clip, int x, int y, int width,
+                         int height, ILI9486_colour_type colour) {
 
-    // load glyph image into the slot (erase previous one)
-    int error = FT_Load_Char(face, text[n], FT_LOAD_RENDER);
-    if (error != 0) {
-      continue; // ignore errors
+  int left = x > clip->left ? x : clip->left;
+  int top = y > clip->top ? y : clip->top;
+  int right = x + width < clip->right ? x + width : clip->right;
+  int bottom = y + height < clip->bottom ? y + height : clip->bottom;
+  if (left < right && top < bottom) {
+    ILI9486_fill(display, left, top, right - left, bottom - top, colour);
+  }
+}
+
+// blend the part of a coverage bitmap inside a clip over what is drawn
+// there, column offset_x of the bitmap is placed at x
+//
+// returns truncation occurred on the right
+static bool alpha_clipped(const clip_type *clip, int x, int y, int offset_x,
+                          int width, int rows, int pitch,
+                          const uint8_t *coverage,
+                          ILI9486_colour_type foreground) {
+
+  int offset_y = 0;
+  if (x < clip->left) {
+    offset_x += clip->left - x;
+    x = clip->left;
+  }
+  if (y < clip->top) {
+    offset_y += clip->top - y;
+    y = clip->top;
+  }
+
+  bool truncated = false;
+  if (x + width - offset_x > clip->right) {
+    width = clip->right - x + offset_x;
+    truncated = true;
+  }
+  if (y + rows - offset_y > clip->bottom) {
+    rows = clip->bottom - y + offset_y;
+  }
+  if (offset_x >= width || offset_y >= rows) {
+    return truncated;
+  }
+
+  return ILI9486_rect_over(display, x, y, offset_x, offset_y, width, rows,
+                           pitch, coverage, foreground) ||
+         truncated;
+}
+
+// render a parsed message from codepoint first with x_offset pixels
+// of it scrolled off, each span in its own colours over the theme's
+// background or a band of its own; the cells were laid out by
+// MESSAGE_parse so nothing is decoded or measured here
+static void render_message(const clip_type *clip, int x, int y, int x_offset,
+                           int cell, int ascent, int descent,
+                           const MESSAGE_type *message, size_t first,
+                           FONT_type *font, ILI9486_colour_type foreground) {
+
+  for (size_t s = MESSAGE_span(message, first); s < message->span_count;
+       ++s) {
+    const MESSAGE_span_type *span = &message->span[s];
+    size_t start = first > span->first ? first : span->first;
+    size_t end = span->first + span->length;
+
+    // pixel position of the start and end of the visible part
+    int left = x;
+    int offset = x_offset;
+    if (start != first) {
+      left += (message->cell[start] - message->cell[first]) * cell - x_offset;
+      offset = 0;
+    }
+    int right =
+        x + (message->cell[end] - message->cell[first]) * cell - x_offset;
+    if (left >= clip->right) {
+      break;
+    }
+    if (right + cell <= clip->left) {
+      continue; // a glyph may overhang its cells by up to a cell
     }
 
-    dump_bitmap("the glyph", &slot->bitmap);
-    FT_Vector zero = {.x = 0, .y = 0};
+    ILI9486_colour_type fg =
+        span->themed_foreground ? foreground : span->foreground;
+    if (!span->themed_background) {
+      fill_clipped(clip, left, y - ascent, right - left, ascent + descent,
+                   span->background);
+    }
+    render_ucs4(clip, left, y, offset, cell, &message->text[start],
+                end - start, font, fg);
+  }
+}
+
+// render length codepoints
+//
+// cell: zero to advance by the glyph, otherwise the pixel width of a
+//       cell to place characters by their East Asian width, then no
+//       glyph is loaded for characters outside the clip
+static void render_ucs4(const clip_type *clip, int x, int y, int x_offset,
+                        int cell, const uint32_t *text, size_t length,
+                        FONT_type *font, ILI9486_colour_type foreground) {
+
+  for (size_t n = 0; n < length; ++n) {
 
-    FT_Bitmap abitmap;
-    FT_Bitmap_Init(&abitmap);
+    uint32_t codepoint = text[n];
 
-    // make background only bitmap
-    FT_Bitmap_Blend(library, &slot->bitmap, zero, &abitmap, &zero, background);
-    uint8_t *p = (uint8_t *)(abitmap.buffer);
-    for (size_t r = 0; r < abitmap.rows; ++r) {
-      for (size_t w = 0; w < abitmap.width; ++w) {
-        ((FT_Color *)p)[w] = background;
+    // a glyph may overhang its cells by up to a cell
+    if (cell > 0) {
+      int advance = ucs4_width(codepoint) * cell;
+      if (x - cell >= clip->right) {
+        break; // end of the clip
       }
-      p += abitmap.pitch;
+      if (x + advance - x_offset + cell <= clip->left) {
+        x += advance - x_offset;
+        x_offset = 0;
+        continue; // left of the clip
+      }
+    }
+
+    // glyph from the atlas or rendered by FreeType
+    FONT_glyph_type glyph;
+    if (!FONT_glyph(font, codepoint, &glyph)) {
+      continue; // ignore errors
     }
 
-    FT_Bitmap_Blend(library, &slot->bitmap, zero, &abitmap, &zero, foreground);
+    dump_glyph("the glyph", &glyph);
 
     // render on LCD
-    bool trunc = ILI9486_rect_rgba(x + slot->bitmap_left, y - slot->bitmap_top,
-                                   x_offset, 0, abitmap.width, abitmap.rows,
-                                   abitmap.pitch, abitmap.buffer);
+    bool trunc = alpha_clipped(clip, x + glyph.left, y - glyph.top, x_offset,
+                               glyph.width, glyph.rows, glyph.pitch,
+                               glyph.coverage, foreground);
 
     // advance cursor
-    int advance = (slot->advance.x >> 6) - x_offset;
-    if (n == 0 && advance <= incr) {
-      rc = true;
-    }
-    x += advance;
+    int advance = cell > 0 ? ucs4_width(codepoint) * cell : glyph.advance;
+    x += advance - x_offset;
     x_offset = 0;
 
-    FT_Bitmap_Done(library, &abitmap);
-    if (trunc) {
+    if (trunc && cell == 0) {
       break; // end-of line / end of screen
     }
   }
-  return rc;
 }
+
+#if TESTING
+
+#include <assert.h>
+
+// the test is linked with --wrap for each of these so that every
+// allocation made while drawing is counted, FreeType included as its
+// working memory comes through the recycler; workers count as well,
+// and an update lost between them cannot bring a count back to zero
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *p, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *p, size_t size);
+
+static volatile unsigned long allocations;
+
+void *__wrap_malloc(size_t size) {
+  ++allocations;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  ++allocations;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+  ++allocations;
+  return __real_realloc(p, size);
+}
+
+// a bus that sends instantly, the panel's speed is not tested here
+static void test_select(void *context, bool data) {
+  (void)context;
+  (void)data;
+}
+
+static void test_send(void *context, const void *buffer, size_t length) {
+  (void)context;
+  (void)buffer;
+  (void)length;
+}
+
+static void test_read(void *context, const void *buffer, void *received,
+                      size_t length) {
+  (void)context;
+  (void)buffer;
+  memset(received, 0, length);
+}
+
+static bool test_speed(void *context, uint32_t bps) {
+  (void)context;
+  (void)bps;
+  return true;
+}
+
+#define TEST_WORKERS 2
+
+// the clock's drawing state, set up as main does
+typedef struct {
+  fonts_type fonts[TEST_WORKERS];
+  POOL_type *pool;
+  colours_type themes[2];
+  MESSAGE_type message;
+  frame_type frame;
+  part_type parts[2 + TEST_WORKERS];
+  part_type uncovered;
+  int m_top;
+  int m_bottom;
+} test_type;
+
+// a frame of the main loop: a new theme now and then, every field
+// drawn by the workers from the background layer with the ticker
+// scrolled in place on odd frames, then the changes sent
+static void test_frame(test_type *t, int n) {
+
+  const int width = ILI9486_width(display);
+  frame_type *f = &t->frame;
+
+  for (long w = 0; w < TEST_WORKERS; ++w) {
+    ARENA_reset(t->fonts[w].arena);
+  }
+
+  if (n % 20 == 0) {
+    f->theme = &t->themes[n / 20 % 2];
+    paint_background(f->theme, NULL, NULL, 0);
+    ILI9486_damage(display, 0, 0, width, ILI9486_height(display),
+                   ILI9486_PRIORITY_NORMAL);
+  }
+
+  snprintf(f->time, sizeof(f->time), "%02d:%02d:%02d", n / 3600 % 24,
+           n / 60 % 60, n % 60);
+  f->day = wday[n % 7];
+  snprintf(f->date, sizeof(f->date), " %02d-%02d", 1 + n % 12, 1 + n % 28);
+  f->day_width = utf8_string_width(f->day) * f->date_cell;
+  int date_width = utf8_string_width(f->date) * f->date_cell;
+  f->date_x = (width - f->day_width - date_width) / 2;
+
+  bool scroll = n % 2 == 1;
+  size_t count = scroll ? 2 : SIZE_OF_ARRAY(t->parts);
+  if (scroll) {
+    ILI9486_scroll(display, 0, t->m_top, width, t->m_bottom - t->m_top,
+                   -f->m_cell, ILI9486_PRIORITY_LOW);
+    t->uncovered.clip = (clip_type){.left = width - f->m_cell,
+                                    .top = t->m_top,
+                                    .right = width,
+                                    .bottom = t->m_bottom};
+    assert(POOL_submit(t->pool, t->uncovered.draw, &t->uncovered));
+  }
+  for (size_t i = 0; i < count; ++i) {
+    assert(POOL_submit(t->pool, t->parts[i].draw, &t->parts[i]));
+  }
+  ILI9486_damage(display, 0, 0, width, t->m_top, ILI9486_PRIORITY_HIGH);
+  if (!scroll) {
+    ILI9486_damage(display, 0, t->m_top, width, t->m_bottom - t->m_top,
+                   ILI9486_PRIORITY_LOW);
+  }
+  POOL_join(t->pool);
+
+  if (++f->m_first == t->message.length) {
+    f->m_first = 0;
+  }
+  assert(ILI9486_sync(display, 0));
+}
+
+// what --realtime renders before the clock starts
+static void test_warm(test_type *t, const char *message) {
+  for (long w = 0; w < TEST_WORKERS; ++w) {
+    warm_glyphs(t->fonts[w].time, "0123456789:");
+    warm_glyphs(t->fonts[w].date, " 0123456789-");
+    for (size_t i = 0; i < SIZE_OF_ARRAY(wday); ++i) {
+      warm_glyphs(t->fonts[w].date, wday[i]);
+    }
+    warm_glyphs(t->fonts[w].message, message);
+  }
+}
+
+// count the allocations of the frames after the first few
+static unsigned long steady(test_type *t) {
+  for (int n = 0; n < 40; ++n) {
+    test_frame(t, n);
+  }
+  allocations = 0;
+  for (int n = 40; n < 200; ++n) {
+    test_frame(t, n);
+  }
+  return allocations;
+}
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  // the ticker moves by pixels across cells of different widths
+  static MESSAGE_type ticker;
+  assert(MESSAGE_parse(&ticker, "a日b"));
+  size_t first = 0;
+  int offset = 0;
+  advance_ticker(&ticker, 10, 15, &first, &offset);
+  assert(first == 1 && offset == 5);
+  advance_ticker(&ticker, 10, 24, &first, &offset);
+  assert(first == 2 && offset == 9);
+  advance_ticker(&ticker, 10, 1 + 4 * 40 + 3, &first, &offset);
+  assert(first == 0 && offset == 3);
+  assert(MESSAGE_parse(&ticker, "{red}"));
+  advance_ticker(&ticker, 10, 7, &first, &offset);
+  assert(first == 0 && offset == 0);
+
+  // the clock's fonts are installed from packages, not all hosts have
+  // them
+  const char *const needed[] = {TIME_FONT_FILE, DATE_FONT_FILE,
+                                MESSAGE_FONT_FILE};
+  for (size_t i = 0; i < SIZE_OF_ARRAY(needed); ++i) {
+    if (access(needed[i], R_OK) != 0) {
+      printf("skipped: no font: %s\n", needed[i]);
+      return 0;
+    }
+  }
+
+  // a threaded panel, as the clock runs it
+  const ILI9486_transport_type transport = {
+      .select = test_select,
+      .send = test_send,
+      .read = test_read,
+      .speed = test_speed,
+  };
+  ILI9486_config_type config = ILI9486_CONFIG_WAVESHARE;
+  config.transport = &transport;
+  config.threaded = true;
+  display = ILI9486_create(&config, false);
+  assert(display != NULL);
+
+  static test_type t;
+  void *contexts[TEST_WORKERS];
+  for (long w = 0; w < TEST_WORKERS; ++w) {
+    load_fonts(&t.fonts[w], false, NULL, 0);
+    contexts[w] = &t.fonts[w];
+  }
+  t.pool = POOL_create(TEST_WORKERS, contexts);
+  assert(t.pool != NULL);
+
+  t.themes[0] = (colours_type){
+      .time = X11_RGB_yellow,
+      .day = X11_RGB_gold,
+      .date = X11_RGB_orange,
+      .message = X11_RGB_gold2,
+      .background = X11_RGB_black,
+      .gradient = X11_RGB_grey20,
+  };
+  t.themes[1] = (colours_type){
+      .time = X11_RGB_LightCyan,
+      .day = X11_RGB_cyan,
+      .date = X11_RGB_SkyBlue,
+      .message = X11_RGB_LightBlue,
+      .background = X11_RGB_grey10,
+      .gradient = X11_RGB_grey10,
+  };
+
+  const char message[] = "   Wg {red}12:34{} {white/#004}27-33度{} "
+                         "{/yellow}多雲，午後有雷陣雨{}?   ";
+  assert(MESSAGE_parse(&t.message, message));
+
+  // the fields and the bands between them as in main
+  FT_Face m_face = FONT_face(t.fonts[0].message);
+  FT_Face t_face = FONT_face(t.fonts[0].time);
+  FT_Face d_face = FONT_face(t.fonts[0].date);
+  const int m_ascent = m_face->size->metrics.ascender >> 6;
+  const int m_descent = -m_face->size->metrics.descender >> 6;
+  const int t_descent = -t_face->size->metrics.descender >> 6;
+  const int d_ascent = d_face->size->metrics.ascender >> 6;
+  const int d_descent = -d_face->size->metrics.descender >> 6;
+  const int width = ILI9486_width(display);
+  const int time_date =
+      (time_baseline + t_descent + date_baseline - d_ascent) / 2;
+  const int date_message =
+      (date_baseline + d_descent + message_baseline - m_ascent) / 2;
+
+  t.frame = (frame_type){
+      .time_height = time_font_height,
+      .date_cell = date_font_height / 2,
+      .message = &t.message,
+      .m_cell = message_font_height / 2,
+      .m_ascent = m_ascent,
+      .m_descent = m_descent,
+  };
+  t.parts[0] = (part_type){
+      .draw = draw_time,
+      .clip = {.right = width, .bottom = time_date},
+  };
+  t.parts[1] = (part_type){
+      .draw = draw_date,
+      .clip = {.top = time_date, .right = width, .bottom = date_message},
+  };
+  for (long i = 0; i < TEST_WORKERS; ++i) {
+    t.parts[2 + i] = (part_type){
+        .draw = draw_message,
+        .clip = {.left = width * i / TEST_WORKERS,
+                 .top = date_message,
+                 .right = width * (i + 1) / TEST_WORKERS,
+                 .bottom = ILI9486_height(display)},
+    };
+  }
+  for (size_t i = 0; i < SIZE_OF_ARRAY(t.parts); ++i) {
+    t.parts[i].frame = &t.frame;
+  }
+  t.uncovered = (part_type){.draw = draw_message, .frame = &t.frame};
+  t.m_top = message_baseline - m_ascent;
+  t.m_bottom = message_baseline + m_descent;
+
+  // outlines rendered into the worker arenas
+  test_warm(&t, message);
+  unsigned long n = steady(&t);
+  printf("outlines: %lu allocations  arena peak: %zu bytes\n", n,
+         ARENA_peak(t.fonts[0].arena));
+  assert(n == 0);
+  assert(ARENA_peak(t.fonts[0].arena) > 0);
+
+  // distance fields are cached, after that only resolved
+  bool sdf = true;
+  for (long w = 0; w < TEST_WORKERS; ++w) {
+    FONT_type *all[] = {t.fonts[w].time, t.fonts[w].date,
+                        t.fonts[w].message};
+    for (size_t i = 0; i < SIZE_OF_ARRAY(all); ++i) {
+      sdf = sdf && FONT_sdf(all[i], true);
+    }
+  }
+  if (sdf) {
+    test_warm(&t, message);
+    n = steady(&t);
+    printf("distance fields: %lu allocations\n", n);
+    assert(n == 0);
+  }
+
+  assert(POOL_destroy(t.pool));
+  for (long w = 0; w < TEST_WORKERS; ++w) {
+    unload_fonts(&t.fonts[w]);
+  }
+  ILI9486_destroy(display);
+  return 0;
+}
+#endif
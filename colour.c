@@ -0,0 +1,183 @@
+// colour.c
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "colour.h"
+#include "x11-rgb-hash.h"
+
+// longest normalised name that can be in the table
+#define NAME_SIZE sizeof(x11_rgb_entry[0].name)
+
+// polynomial hash as used by scripts/convert-x11-rgb.sh
+static inline uint32_t hash(const char *s, size_t length, uint32_t m) {
+  uint32_t h = 0;
+  for (size_t i = 0; i < length; ++i) {
+    h = h * m + (uint8_t)s[i];
+  }
+  return h;
+}
+
+// look up an X11 colour name
+bool COLOUR_name(const char *name, size_t length,
+                 ILI9486_colour_type *colour) {
+
+  // normalise and compute the bucket hash in one pass
+  char key[NAME_SIZE];
+  size_t n = 0;
+  uint32_t h = 0;
+  for (size_t i = 0; i < length && name[i] != '\0'; ++i) {
+    char c = name[i];
+    if (c == ' ' || c == '_') {
+      continue;
+    }
+    if (n == NAME_SIZE - 1) {
+      return false; // too long to be a colour
+    }
+    c = tolower((unsigned char)c);
+    key[n++] = c;
+    h = h * X11_RGB_BUCKET_SEED + (uint8_t)c;
+  }
+  if (n == 0) {
+    return false;
+  }
+  key[n] = '\0';
+
+  uint32_t m = x11_rgb_seed[h % X11_RGB_BUCKETS];
+  size_t slot = hash(key, n, m) % X11_RGB_ENTRIES;
+  if (memcmp(key, x11_rgb_entry[slot].name, n + 1) != 0) {
+    return false;
+  }
+
+  colour->red = x11_rgb_entry[slot].red;
+  colour->green = x11_rgb_entry[slot].green;
+  colour->blue = x11_rgb_entry[slot].blue;
+  return true;
+}
+
+// value of a hex digit or -1
+static inline int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c = tolower((unsigned char)c);
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// parse "#rgb", "#rrggbb" or an X11 colour name
+bool COLOUR_parse(const char *text, size_t length,
+                  ILI9486_colour_type *colour) {
+
+  if (length == 0 || text[0] != '#') {
+    return COLOUR_name(text, length, colour);
+  }
+
+  int digits[6];
+  size_t n = length - 1;
+  if (n != 3 && n != 6) {
+    return false;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    digits[i] = hex_digit(text[i + 1]);
+    if (digits[i] < 0) {
+      return false;
+    }
+  }
+
+  if (n == 3) {
+    colour->red = digits[0] * 0x11;
+    colour->green = digits[1] * 0x11;
+    colour->blue = digits[2] * 0x11;
+  } else {
+    colour->red = digits[0] << 4 | digits[1];
+    colour->green = digits[2] << 4 | digits[3];
+    colour->blue = digits[4] << 4 | digits[5];
+  }
+  return true;
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stdio.h>
+
+#define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof((a)[0]))
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  // every entry must be found in its own slot
+  for (size_t i = 0; i < X11_RGB_ENTRIES; ++i) {
+    const char *name = x11_rgb_entry[i].name;
+    ILI9486_colour_type c;
+    assert(COLOUR_name(name, strlen(name), &c));
+    assert(c.red == x11_rgb_entry[i].red);
+    assert(c.green == x11_rgb_entry[i].green);
+    assert(c.blue == x11_rgb_entry[i].blue);
+  }
+
+  const struct {
+    const char *name;
+    size_t length;
+    bool found;
+    ILI9486_colour_type colour;
+  } tests[] = {
+      {"SteelBlue", 9, true, {70, 130, 180}},
+      {"steel blue", 10, true, {70, 130, 180}},
+      {"STEEL_BLUE", 10, true, {70, 130, 180}},
+      {"steel blue}", 10, true, {70, 130, 180}},
+      {"grey50", 6, true, {127, 127, 127}},
+      {"gray50", 6, true, {127, 127, 127}},
+      {"LightGoldenrodYellow", 20, true, {250, 250, 210}},
+      {"red", SIZE_MAX, true, {255, 0, 0}},
+      {"red", 2, false, {0, 0, 0}},
+      {"", 0, false, {0, 0, 0}},
+      {"   ", 3, false, {0, 0, 0}},
+      {"no such colour", 14, false, {0, 0, 0}},
+      {"light goldenrod yellow green blue", 33, false, {0, 0, 0}},
+  };
+
+  for (size_t i = 0; i < SIZE_OF_ARRAY(tests); ++i) {
+    ILI9486_colour_type c = {0, 0, 0};
+    bool found = COLOUR_name(tests[i].name, tests[i].length, &c);
+    printf("%-36s found: %d  rgb: %3d %3d %3d\n", tests[i].name, found, c.red,
+           c.green, c.blue);
+    assert(found == tests[i].found);
+    assert(c.red == tests[i].colour.red);
+    assert(c.green == tests[i].colour.green);
+    assert(c.blue == tests[i].colour.blue);
+  }
+
+  const struct {
+    const char *text;
+    bool found;
+    ILI9486_colour_type colour;
+  } parse_tests[] = {
+      {"#ff8000", true, {255, 128, 0}}, {"#F80", true, {255, 136, 0}},
+      {"#12345", false, {0, 0, 0}},     {"#12345g", false, {0, 0, 0}},
+      {"#", false, {0, 0, 0}},          {"orange", true, {255, 165, 0}},
+  };
+
+  for (size_t i = 0; i < SIZE_OF_ARRAY(parse_tests); ++i) {
+    ILI9486_colour_type c = {0, 0, 0};
+    bool found =
+        COLOUR_parse(parse_tests[i].text, strlen(parse_tests[i].text), &c);
+    printf("%-36s found: %d  rgb: %3d %3d %3d\n", parse_tests[i].text, found,
+           c.red, c.green, c.blue);
+    assert(found == parse_tests[i].found);
+    assert(c.red == parse_tests[i].colour.red);
+    assert(c.green == parse_tests[i].colour.green);
+    assert(c.blue == parse_tests[i].colour.blue);
+  }
+
+  return 0;
+}
+#endif
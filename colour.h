@@ -0,0 +1,27 @@
+// colour.h
+
+#if !defined(COLOUR_H)
+#define COLOUR_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ili9486.h"
+
+// functions
+// =========
+
+// look up an X11 colour name from the first length bytes of name,
+// case, spaces and underscores are ignored so "steel blue",
+// "SteelBlue" and "STEEL_BLUE" are the same
+// returns false if the name is unknown
+bool COLOUR_name(const char *name, size_t length,
+                 ILI9486_colour_type *colour);
+
+// parse the first length bytes of text as "#rgb", "#rrggbb" or an X11
+// colour name
+// returns false if not a colour
+bool COLOUR_parse(const char *text, size_t length,
+                  ILI9486_colour_type *colour);
+
+#endif
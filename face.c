@@ -0,0 +1,277 @@
+// face.c
+
+#include <err.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "face.h"
+#include "ili9486.h"
+#include "shape.h"
+
+#define HANDS 3
+#define HOUR 0
+#define MINUTE 1
+#define SECOND 2
+
+#define TWO_PI 6.28318531f
+
+// boxes along each hand, so a slanting hand is not redrawn and sent as
+// the whole square it crosses
+#define SEGMENTS 4
+
+// thinnest line that still looks solid once anti-aliased
+#define MIN_WIDTH 1.5f
+
+// sizes as fractions of the radius
+typedef struct {
+  float length; // from the centre to the tip
+  float tail;   // behind the centre
+  float width;
+} hand_shape_type;
+
+static const hand_shape_type hand_shapes[HANDS] = {
+    [HOUR] = {.length = 0.50f, .tail = 0.10f, .width = 0.070f},
+    [MINUTE] = {.length = 0.78f, .tail = 0.10f, .width = 0.045f},
+    [SECOND] = {.length = 0.88f, .tail = 0.20f, .width = 0.015f},
+};
+
+// the dial: a ring at the edge, a tick for each minute and longer,
+// wider ones for the hours
+static const float ring_width = 0.02f;
+static const float tick_outer = 0.94f;
+static const float minute_tick = 0.05f;
+static const float minute_width = 0.012f;
+static const float hour_tick = 0.12f;
+static const float hour_width = 0.035f;
+static const float centre_radius = 0.05f;
+
+// a hand where it was last drawn
+typedef struct {
+  float angle; // radians clockwise from twelve
+  float x0;    // end of the tail
+  float y0;    // ..
+  float x1;    // tip
+  float y1;    // ..
+  float width;
+  SHAPE_box_type box[SEGMENTS]; // from the tail to the tip
+} hand_type;
+
+struct FACE_struct {
+  ILI9486_type *lcd;
+  float x;
+  float y;
+  float radius;
+  SHAPE_box_type box; // everything the face draws
+  hand_type hand[HANDS];
+  bool all; // draw every hand next time, e.g. over a new dial
+};
+
+static float scaled(const FACE_type *face, float fraction) {
+  float width = face->radius * fraction;
+  return width < MIN_WIDTH ? MIN_WIDTH : width;
+}
+
+// a hand at an angle
+static hand_type place(const FACE_type *face, size_t i, float angle) {
+  const hand_shape_type *shape = &hand_shapes[i];
+  float dx = sinf(angle) * face->radius;
+  float dy = -cosf(angle) * face->radius;
+  hand_type h = {
+      .angle = angle,
+      .x0 = face->x - dx * shape->tail,
+      .y0 = face->y - dy * shape->tail,
+      .x1 = face->x + dx * shape->length,
+      .y1 = face->y + dy * shape->length,
+      .width = scaled(face, shape->width),
+  };
+  for (size_t k = 0; k < SEGMENTS; ++k) {
+    float t0 = (float)k / SEGMENTS;
+    float t1 = (float)(k + 1) / SEGMENTS;
+    h.box[k] = SHAPE_line_box(
+        h.x0 + (h.x1 - h.x0) * t0, h.y0 + (h.y1 - h.y0) * t0,
+        h.x0 + (h.x1 - h.x0) * t1, h.y0 + (h.y1 - h.y0) * t1, h.width);
+  }
+  return h;
+}
+
+// a face centred at x, y
+FACE_type *FACE_create(ILI9486_type *lcd, int x, int y, int radius) {
+
+  if (radius <= 0) {
+    warnx("invalid face radius: %d", radius);
+    return NULL;
+  }
+
+  FACE_type *face = calloc(1, sizeof(FACE_type));
+  if (face == NULL) {
+    warn("failed to allocate face structure");
+    return NULL;
+  }
+
+  face->lcd = lcd;
+  face->x = x;
+  face->y = y;
+  face->radius = radius;
+  face->box = SHAPE_disc_box(x, y, radius);
+  for (size_t i = 0; i < HANDS; ++i) {
+    face->hand[i] = place(face, i, 0);
+  }
+  face->all = true;
+
+  return face;
+}
+
+// release a face
+bool FACE_destroy(FACE_type *face) {
+  if (face == NULL) {
+    return false;
+  }
+  free(face);
+  return true;
+}
+
+// paint the dial
+void FACE_dial(FACE_type *face, const FACE_colours_type *colours) {
+
+  const float r = face->radius;
+  const float ring = scaled(face, ring_width);
+  SHAPE_ring(face->lcd, &face->box, face->x, face->y, r - ring / 2, ring,
+             colours->dial);
+
+  for (int i = 0; i < 60; ++i) {
+    float angle = TWO_PI * i / 60;
+    float length = (i % 5 == 0) ? hour_tick : minute_tick;
+    float width = scaled(face, (i % 5 == 0) ? hour_width : minute_width);
+    float dx = sinf(angle) * r;
+    float dy = -cosf(angle) * r;
+    SHAPE_line(face->lcd, &face->box, face->x + dx * (tick_outer - length),
+               face->y + dy * (tick_outer - length), face->x + dx * tick_outer,
+               face->y + dy * tick_outer, width, colours->dial);
+  }
+
+  face->all = true;
+}
+
+// move the hands to a time of day
+size_t FACE_hands(FACE_type *face, const FACE_colours_type *colours,
+                  double seconds, ILI9486_priority_type priority) {
+
+  double minutes = floor(seconds / 60);
+  float angle[HANDS] = {
+      [HOUR] = TWO_PI * fmod(minutes, 720) / 720,
+      [MINUTE] = TWO_PI * fmod(minutes, 60) / 60,
+      [SECOND] = TWO_PI * fmod(seconds, 60) / 60,
+  };
+
+  // where each segment of a hand was and where it goes must both be
+  // drawn again, with every hand crossing them
+  SHAPE_box_type dirty[HANDS * SEGMENTS];
+  size_t dirty_count = 0;
+  for (size_t i = 0; i < HANDS; ++i) {
+    if (angle[i] == face->hand[i].angle && !face->all) {
+      continue;
+    }
+    hand_type h = place(face, i, angle[i]);
+    for (size_t k = 0; k < SEGMENTS; ++k) {
+      dirty[dirty_count++] = SHAPE_union(&face->hand[i].box[k], &h.box[k]);
+    }
+    face->hand[i] = h;
+  }
+  if (face->all) {
+    dirty[0] = face->box;
+    dirty_count = 1;
+    face->all = false;
+  }
+
+  size_t pixels = 0;
+  const float cap = scaled(face, centre_radius);
+  for (size_t d = 0; d < dirty_count; ++d) {
+    const SHAPE_box_type *b = &dirty[d];
+    int width = b->right - b->left;
+    int height = b->bottom - b->top;
+    ILI9486_restore(face->lcd, b->left, b->top, width, height);
+    for (size_t i = 0; i < HANDS; ++i) {
+      const hand_type *h = &face->hand[i];
+      SHAPE_line(face->lcd, b, h->x0, h->y0, h->x1, h->y1, h->width,
+                 (i == SECOND) ? colours->seconds : colours->hands);
+    }
+    SHAPE_disc(face->lcd, b, face->x, face->y, cap, colours->seconds);
+    ILI9486_damage(face->lcd, b->left, b->top, width, height, priority);
+    pixels += (size_t)width * height;
+  }
+
+  return pixels;
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "bench.h"
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  BENCH_bus_type *bus = BENCH_bus_create(0);
+  assert(bus != NULL);
+  ILI9486_config_type config = ILI9486_CONFIG_WAVESHARE;
+  config.transport = BENCH_bus_transport(bus);
+  ILI9486_type *lcd = ILI9486_create(&config, false);
+  assert(lcd != NULL);
+
+  assert(FACE_create(lcd, 240, 160, 0) == NULL);
+  FACE_type *face = FACE_create(lcd, 240, 160, 150);
+  assert(face != NULL);
+
+  const FACE_colours_type colours = {
+      .dial = {.red = 255, .green = 255, .blue = 255},
+      .hands = {.red = 255, .green = 255},
+      .seconds = {.red = 255},
+  };
+  ILI9486_clear(lcd, 0, 0, 0);
+  FACE_dial(face, &colours);
+  assert(ILI9486_capture(lcd));
+
+  // the first time draws the whole face
+  const double start = 10 * 3600 + 10 * 60;
+  size_t all = FACE_hands(face, &colours, start, ILI9486_PRIORITY_NORMAL);
+  assert(all >= 300 * 300);
+  assert(FACE_hands(face, &colours, start, ILI9486_PRIORITY_NORMAL) == 0);
+
+  // a minute of sweeping at 30 frames a second only changes a strip
+  // around the seconds hand each frame
+  size_t most = 0;
+  size_t total = 0;
+  for (int frame = 1; frame < 60 * 30; ++frame) {
+    size_t pixels = FACE_hands(face, &colours, start + frame / 30.0,
+                               ILI9486_PRIORITY_NORMAL);
+    assert(pixels > 0);
+    most = pixels > most ? pixels : most;
+    total += pixels;
+  }
+  printf("face: %zu pixels  sweep frame: mean %zu  most %zu pixels\n", all,
+         total / (60 * 30 - 1), most);
+  assert(most < all / 5);
+  assert(total / (60 * 30 - 1) < all / 20);
+
+  // the minute moves the hour and minute hands as well
+  size_t minute =
+      FACE_hands(face, &colours, start + 60, ILI9486_PRIORITY_NORMAL);
+  assert(minute > most);
+
+  // a new dial redraws everything
+  FACE_dial(face, &colours);
+  assert(FACE_hands(face, &colours, start + 60, ILI9486_PRIORITY_NORMAL) ==
+         all);
+
+  assert(FACE_destroy(face));
+  ILI9486_destroy(lcd);
+  BENCH_bus_destroy(bus);
+  return 0;
+}
+#endif
@@ -0,0 +1,52 @@
+// face.h
+
+#if !defined(FACE_H)
+#define FACE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ili9486.h"
+
+// analog clock face
+// =================
+//
+// the dial is painted once into the background layer; each time the
+// hands move only the boxes they leave and enter are restored from
+// the layer, the hands drawn again inside them and marked changed, so
+// a sweeping seconds hand sends a thin strip a frame
+
+// colours of a face
+typedef struct {
+  ILI9486_colour_type dial;    // ring and ticks
+  ILI9486_colour_type hands;   // hour and minute hands
+  ILI9486_colour_type seconds; // seconds hand and centre
+} FACE_colours_type;
+
+// type to hold a face
+typedef struct FACE_struct FACE_type;
+
+// functions
+// =========
+
+// a face centred at x, y
+// returns NULL on failure
+FACE_type *FACE_create(ILI9486_type *lcd, int x, int y, int radius);
+
+// release a face
+bool FACE_destroy(FACE_type *face);
+
+// paint the dial, to be kept with ILI9486_capture; the hands are drawn
+// in full by the next FACE_hands
+void FACE_dial(FACE_type *face, const FACE_colours_type *colours);
+
+// move the hands to a time of day, the hour and minute hands step
+// once a minute and the seconds hand to the fraction of a second given
+//
+// seconds:  since midnight
+// priority: of the changed boxes
+// returns the number of pixels marked changed
+size_t FACE_hands(FACE_type *face, const FACE_colours_type *colours,
+                  double seconds, ILI9486_priority_type priority);
+
+#endif
@@ -0,0 +1,936 @@
+// font.c
+
+#include <err.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_BITMAP_H
+#include FT_MODULE_H
+#include FT_OUTLINE_H
+#include FT_SIZES_H
+
+#include "arena.h"
+#include "atlas.h"
+#include "font.h"
+
+#define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof((a)[0]))
+
+// signed distance fields need FreeType 2.11 or later
+#define HAVE_SDF                                                               \
+  (FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11))
+
+// distance fields are rendered at this size and scaled to any other
+#define SDF_HEIGHT 128
+
+// distance in pixels represented by the 0…255 range either side of 128
+#define SDF_SPREAD 8
+
+// a glyph as a distance field at SDF_HEIGHT
+typedef struct {
+  uint32_t codepoint;
+  int left;     // bitmap offset right of the pen position
+  int top;      // bitmap offset up from the baseline
+  long advance; // 26.6 fixed point
+  int width;
+  int rows;
+  uint8_t distance[]; // 128 = edge, larger is inside
+} sdf_glyph_type;
+
+// memory mapped font files
+typedef struct {
+  char *path;
+  void *data;
+  size_t length;
+  int references;
+} mapping_type;
+
+// faces created from the mapped files
+typedef struct {
+  FT_Library library;
+  mapping_type *mapping;
+  FT_Face face;
+  int references;
+  FT_Size sdf_size;       // SDF_HEIGHT, created on first use
+  sdf_glyph_type **sdf;   // hash table of distance fields by codepoint
+  size_t sdf_count;       // entries used
+  size_t sdf_allocated;   // table size, a power of 2
+} face_type;
+
+static mapping_type mappings[8];
+static face_type faces[16];
+
+// maximum faces in a fallback chain
+#define CHAIN_LENGTH 8
+
+// codepoint lookup entries: face number + 1 in the top 8 bits and the
+// glyph index below, zero means not looked up yet
+#define LOOKUP_SHIFT 24
+#define LOOKUP_GLYPH_MASK ((1U << LOOKUP_SHIFT) - 1)
+#define LOOKUP_MISSING 0xffU // in no face of the chain
+
+// codepoints are looked up in pages of 256
+#define PAGE_SHIFT 8
+#define PAGE_SIZE (1U << PAGE_SHIFT)
+#define PAGE_COUNT (0x110000U >> PAGE_SHIFT)
+
+// one face of a fallback chain at the size of the font
+typedef struct {
+  face_type *face;
+  FT_Size size;
+  const ATLAS_strike_type *strike;
+} member_type;
+
+// font information
+struct FONT_struct {
+  member_type chain[CHAIN_LENGTH]; // chain[0] is the main face
+  int chain_length;
+  int width;
+  int height;
+  ATLAS_type *atlas;
+  ARENA_type *arena;   // scratch for rendered glyphs, may be NULL
+  FT_Bitmap converted; // for glyphs not in 8 bit grey
+  uint8_t *rendered;   // outline rendered when the arena is full
+  size_t rendered_length;
+  bool sdf;            // resolve glyphs from distance fields
+  uint8_t *resolved;   // coverage resolved from a distance field
+  size_t resolved_length;
+  int32_t *columns; // source column and weight for each output column
+  size_t columns_length;
+  uint32_t *pages[PAGE_COUNT]; // codepoint → face and glyph index
+};
+
+// FreeType working memory
+// =======================
+//
+// FreeType allocates and frees buffers while loading almost every
+// glyph, the CFF interpreter several, so freed blocks are kept on a
+// list for their power of two size and handed out again; once each
+// size has been used drawing allocates nothing.  A library is only
+// used by one thread, so the lists need no lock.
+
+// blocks from 16 bytes to 16 << (BLOCK_CLASSES - 1), larger ones go
+// straight back to malloc
+#define BLOCK_CLASSES 20
+
+// precedes each block, keeping the block 16 byte aligned
+typedef union {
+  struct {
+    int size_class;
+    void *next; // while on a free list
+  } link;
+  uint8_t padding[16];
+} block_type;
+
+typedef struct recycler_struct {
+  struct FT_MemoryRec_ memory;
+  block_type *free[BLOCK_CLASSES];
+  FT_Library library;
+  struct recycler_struct *next; // list of all libraries
+} recycler_type;
+
+static recycler_type *recyclers;
+
+static int size_class(long size) {
+  int c = 0;
+  while (c < BLOCK_CLASSES && ((size_t)16 << c) < (size_t)size) {
+    ++c;
+  }
+  return c;
+}
+
+static void *block_alloc(FT_Memory memory, long size) {
+  recycler_type *r = memory->user;
+  int c = size_class(size);
+  if (c < BLOCK_CLASSES && r->free[c] != NULL) {
+    block_type *b = r->free[c];
+    r->free[c] = b->link.next;
+    return b + 1;
+  }
+
+  size_t length = c < BLOCK_CLASSES ? (size_t)16 << c : (size_t)size;
+  block_type *b = malloc(sizeof(block_type) + length);
+  if (b == NULL) {
+    return NULL;
+  }
+  b->link.size_class = c;
+  return b + 1;
+}
+
+static void block_free(FT_Memory memory, void *block) {
+  recycler_type *r = memory->user;
+  block_type *b = (block_type *)block - 1;
+  int c = b->link.size_class;
+  if (c < BLOCK_CLASSES) {
+    b->link.next = r->free[c];
+    r->free[c] = b;
+  } else {
+    free(b);
+  }
+}
+
+static void *block_realloc(FT_Memory memory, long cur_size, long new_size,
+                           void *block) {
+  block_type *b = (block_type *)block - 1;
+  if (b->link.size_class < BLOCK_CLASSES &&
+      size_class(new_size) <= b->link.size_class) {
+    return block; // still fits
+  }
+  void *p = block_alloc(memory, new_size);
+  if (p == NULL) {
+    return NULL;
+  }
+  memcpy(p, block, cur_size < new_size ? cur_size : new_size);
+  block_free(memory, block);
+  return p;
+}
+
+// create a FreeType library whose working memory is recycled
+FT_Library FONT_library(void) {
+
+  recycler_type *r = calloc(1, sizeof(recycler_type));
+  if (r == NULL) {
+    warn("failed to allocate FreeType memory");
+    return NULL;
+  }
+  r->memory = (struct FT_MemoryRec_){
+      .user = r,
+      .alloc = block_alloc,
+      .free = block_free,
+      .realloc = block_realloc,
+  };
+
+  FT_Library library;
+  int error = FT_New_Library(&r->memory, &library);
+  if (error != 0) {
+    warnx("FreeType setup failed: error: %d", error);
+    free(r);
+    return NULL;
+  }
+  FT_Add_Default_Modules(library);
+  FT_Set_Default_Properties(library);
+
+  r->library = library;
+  r->next = recyclers;
+  recyclers = r;
+
+  return library;
+}
+
+// release a library and the blocks it recycled
+bool FONT_library_destroy(FT_Library library) {
+
+  recycler_type **p = &recyclers;
+  while (*p != NULL && (*p)->library != library) {
+    p = &(*p)->next;
+  }
+  recycler_type *r = *p;
+  if (r == NULL) {
+    return false;
+  }
+  *p = r->next;
+
+  // the library's own memory goes back on the lists first
+  FT_Done_Library(library);
+  for (int c = 0; c < BLOCK_CLASSES; ++c) {
+    while (r->free[c] != NULL) {
+      block_type *b = r->free[c];
+      r->free[c] = b->link.next;
+      free(b);
+    }
+  }
+  free(r);
+  return true;
+}
+
+// find an existing mapping or map the file
+static mapping_type *map_file(const char *font_path) {
+
+  mapping_type *unused = NULL;
+  for (size_t i = 0; i < SIZE_OF_ARRAY(mappings); ++i) {
+    mapping_type *m = &mappings[i];
+    if (m->references == 0) {
+      if (unused == NULL) {
+        unused = m;
+      }
+    } else if (strcmp(m->path, font_path) == 0) {
+      ++m->references;
+      return m;
+    }
+  }
+  if (unused == NULL) {
+    warnx("too many font files: %s", font_path);
+    return NULL;
+  }
+
+  int fd = open(font_path, O_RDONLY);
+  if (fd < 0) {
+    warn("cannot open font: %s", font_path);
+    return NULL;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) < 0) {
+    warn("cannot stat font: %s", font_path);
+    close(fd);
+    return NULL;
+  }
+
+  void *data = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    warn("cannot map font: %s", font_path);
+    return NULL;
+  }
+
+  unused->path = strdup(font_path);
+  if (unused->path == NULL) {
+    warn("cannot allocate font path: %s", font_path);
+    munmap(data, sb.st_size);
+    return NULL;
+  }
+  unused->data = data;
+  unused->length = sb.st_size;
+  unused->references = 1;
+
+  return unused;
+}
+
+// drop a reference to a mapping, unmapping if no longer used
+static void unmap_file(mapping_type *m) {
+  if (--m->references > 0) {
+    return;
+  }
+  munmap(m->data, m->length);
+  free(m->path);
+  memset(m, 0, sizeof(*m));
+}
+
+// find an existing face for this library and file or create one
+static face_type *open_face(FT_Library library, const char *font_path) {
+
+  face_type *unused = NULL;
+  for (size_t i = 0; i < SIZE_OF_ARRAY(faces); ++i) {
+    face_type *f = &faces[i];
+    if (f->references == 0) {
+      if (unused == NULL) {
+        unused = f;
+      }
+    } else if (f->library == library &&
+               strcmp(f->mapping->path, font_path) == 0) {
+      ++f->references;
+      return f;
+    }
+  }
+  if (unused == NULL) {
+    warnx("too many font faces: %s", font_path);
+    return NULL;
+  }
+
+  mapping_type *m = map_file(font_path);
+  if (m == NULL) {
+    return NULL;
+  }
+
+  FT_Face face;
+  int error = FT_New_Memory_Face(library, (const FT_Byte *)m->data,
+                                 (FT_Long)m->length, 0, &face);
+  if (error == FT_Err_Unknown_File_Format) {
+    warnx("FreeType unknown font format: %s", font_path);
+    unmap_file(m);
+    return NULL;
+  } else if (error != 0) {
+    warnx("FreeType face error: %d: %s", error, font_path);
+    unmap_file(m);
+    return NULL;
+  }
+
+  unused->library = library;
+  unused->mapping = m;
+  unused->face = face;
+  unused->references = 1;
+
+  return unused;
+}
+
+// drop a reference to a face, releasing face and mapping if unused
+static void close_face(face_type *f) {
+  if (--f->references > 0) {
+    return;
+  }
+  for (size_t i = 0; i < f->sdf_allocated; ++i) {
+    free(f->sdf[i]);
+  }
+  free(f->sdf);
+  FT_Done_Face(f->face);
+  unmap_file(f->mapping);
+  memset(f, 0, sizeof(*f));
+}
+
+// open a face of the chain at the size of the font
+static bool add_member(FONT_type *font, FT_Library library,
+                       const char *font_path) {
+
+  if (font->chain_length >= CHAIN_LENGTH) {
+    warnx("too many fallback fonts: %s", font_path);
+    return false;
+  }
+  member_type *m = &font->chain[font->chain_length];
+
+  m->face = open_face(library, font_path);
+  if (m->face == NULL) {
+    return false;
+  }
+
+  int error = FT_New_Size(m->face->face, &m->size);
+  if (error != 0) {
+    warnx("FreeType new size error: %d", error);
+    close_face(m->face);
+    return false;
+  }
+
+  FT_Activate_Size(m->size);
+  error = FT_Set_Pixel_Sizes(m->face->face, font->width, font->height);
+  if (error != 0) {
+    warnx("FreeType pixel sizes error: %d: %s", error, font_path);
+    FT_Done_Size(m->size);
+    close_face(m->face);
+    return false;
+  }
+
+  m->strike =
+      ATLAS_strike(font->atlas, font_path, font->width, font->height);
+
+  ++font->chain_length;
+  return true;
+}
+
+// load a font file at a given pixel size
+FONT_type *FONT_create(FT_Library library, const char *font_path, int width,
+                       int height) {
+
+  FONT_type *font = calloc(1, sizeof(FONT_type));
+  if (font == NULL) {
+    warn("failed to allocate font structure");
+    return NULL;
+  }
+
+  font->width = width;
+  font->height = height;
+  FT_Bitmap_Init(&font->converted);
+
+  if (!add_member(font, library, font_path)) {
+    free(font);
+    return NULL;
+  }
+
+  return font;
+}
+
+// release the size, and the face and mapping when no longer used
+bool FONT_destroy(FONT_type *font) {
+  if (font == NULL) {
+    return false;
+  }
+  FT_Bitmap_Done(font->chain[0].face->library, &font->converted);
+  for (int i = 0; i < font->chain_length; ++i) {
+    FT_Done_Size(font->chain[i].size);
+    close_face(font->chain[i].face);
+  }
+  for (size_t i = 0; i < SIZE_OF_ARRAY(font->pages); ++i) {
+    free(font->pages[i]);
+  }
+  free(font->rendered);
+  free(font->resolved);
+  free(font->columns);
+  free(font);
+  return true;
+}
+
+// add a face to try for codepoints missing from the previous faces
+bool FONT_fallback(FONT_type *font, const char *font_path) {
+  if (!add_member(font, font->chain[0].face->library, font_path)) {
+    return false;
+  }
+
+  // codepoints missing so far might be in the new face
+  for (size_t i = 0; i < SIZE_OF_ARRAY(font->pages); ++i) {
+    uint32_t *page = font->pages[i];
+    for (size_t n = 0; page != NULL && n < PAGE_SIZE; ++n) {
+      if (page[n] >> LOOKUP_SHIFT == LOOKUP_MISSING) {
+        page[n] = 0;
+      }
+    }
+  }
+
+  if (font->sdf && !FONT_sdf(font, true)) {
+    return false;
+  }
+  return true;
+}
+
+// use pre-rendered glyphs from a baked atlas when available
+bool FONT_atlas(FONT_type *font, ATLAS_type *atlas) {
+  font->atlas = atlas;
+  for (int i = 0; i < font->chain_length; ++i) {
+    member_type *m = &font->chain[i];
+    m->strike = ATLAS_strike(atlas, m->face->mapping->path, font->width,
+                             font->height);
+  }
+  return font->chain[0].strike != NULL;
+}
+
+// change the pixel size
+bool FONT_resize(FONT_type *font, int width, int height) {
+  if (width == font->width && height == font->height) {
+    return true;
+  }
+  font->width = width;
+  font->height = height;
+
+  bool ok = true;
+  for (int i = 0; i < font->chain_length; ++i) {
+    member_type *m = &font->chain[i];
+    m->strike =
+        ATLAS_strike(font->atlas, m->face->mapping->path, width, height);
+
+    // distance fields scale at render time, only bitmaps need FreeType
+    if (font->sdf) {
+      continue;
+    }
+    FT_Activate_Size(m->size);
+    int error = FT_Set_Pixel_Sizes(m->face->face, width, height);
+    if (error != 0) {
+      warnx("FreeType pixel sizes error: %d", error);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// resolve glyphs from signed distance fields
+bool FONT_sdf(FONT_type *font, bool enable) {
+#if HAVE_SDF
+  for (int i = 0; enable && i < font->chain_length; ++i) {
+    face_type *f = font->chain[i].face;
+    if (f->sdf_size != NULL) {
+      continue;
+    }
+
+    FT_Int spread = SDF_SPREAD;
+    FT_Property_Set(f->library, "sdf", "spread", &spread);
+
+    int error = FT_New_Size(f->face, &f->sdf_size);
+    if (error != 0) {
+      warnx("FreeType new size error: %d", error);
+      f->sdf_size = NULL;
+      return false;
+    }
+    FT_Activate_Size(f->sdf_size);
+    error = FT_Set_Pixel_Sizes(f->face, 0, SDF_HEIGHT);
+    if (error != 0) {
+      warnx("FreeType pixel sizes error: %d", error);
+      FT_Done_Size(f->sdf_size);
+      f->sdf_size = NULL;
+      return false;
+    }
+  }
+
+  // bitmap sizes may be stale after resizing with distance fields
+  if (font->sdf && !enable) {
+    font->sdf = false;
+    for (int i = 0; i < font->chain_length; ++i) {
+      member_type *m = &font->chain[i];
+      FT_Activate_Size(m->size);
+      FT_Set_Pixel_Sizes(m->face->face, font->width, font->height);
+    }
+  }
+
+  font->sdf = enable;
+  return true;
+#else
+  (void)font;
+  return !enable;
+#endif
+}
+
+// make sure a scratch buffer is large enough
+static bool reserve(void **buffer, size_t *length, size_t needed) {
+  if (needed <= *length) {
+    return true;
+  }
+  void *p = realloc(*buffer, needed);
+  if (p == NULL) {
+    warn("cannot allocate: %zu bytes", needed);
+    return false;
+  }
+  *buffer = p;
+  *length = needed;
+  return true;
+}
+
+// memory for a glyph being rendered, from the scratch arena while it
+// has room, otherwise a buffer of the font that is reused
+static void *scratch(FONT_type *font, void **buffer, size_t *length,
+                     size_t needed) {
+  if (font->arena != NULL) {
+    void *p = ARENA_allocate(font->arena, needed);
+    if (p != NULL) {
+      return p;
+    }
+  }
+  return reserve(buffer, length, needed) ? *buffer : NULL;
+}
+
+#if HAVE_SDF
+// hash for the distance field table
+static size_t sdf_hash(uint32_t codepoint, size_t allocated) {
+  return (codepoint * 2654435761U) & (allocated - 1);
+}
+
+// find or render the distance field of a glyph
+static const sdf_glyph_type *sdf_glyph(face_type *f, uint32_t codepoint,
+                                       FT_UInt glyph_index) {
+
+  if (f->sdf_allocated > 0) {
+    size_t i = sdf_hash(codepoint, f->sdf_allocated);
+    while (f->sdf[i] != NULL) {
+      if (f->sdf[i]->codepoint == codepoint) {
+        return f->sdf[i];
+      }
+      i = (i + 1) & (f->sdf_allocated - 1);
+    }
+  }
+
+  // grow the table to keep it at most half full
+  if (2 * (f->sdf_count + 1) > f->sdf_allocated) {
+    size_t allocated = f->sdf_allocated == 0 ? 64 : 2 * f->sdf_allocated;
+    sdf_glyph_type **table = calloc(allocated, sizeof(sdf_glyph_type *));
+    if (table == NULL) {
+      warn("cannot allocate distance field table");
+      return NULL;
+    }
+    for (size_t n = 0; n < f->sdf_allocated; ++n) {
+      if (f->sdf[n] != NULL) {
+        size_t i = sdf_hash(f->sdf[n]->codepoint, allocated);
+        while (table[i] != NULL) {
+          i = (i + 1) & (allocated - 1);
+        }
+        table[i] = f->sdf[n];
+      }
+    }
+    free(f->sdf);
+    f->sdf = table;
+    f->sdf_allocated = allocated;
+  }
+
+  FT_Activate_Size(f->sdf_size);
+  int error = FT_Load_Glyph(f->face, glyph_index, FT_LOAD_DEFAULT);
+  if (error == 0) {
+    error = FT_Render_Glyph(f->face->glyph, FT_RENDER_MODE_SDF);
+  }
+  if (error != 0) {
+    return NULL;
+  }
+
+  FT_GlyphSlot slot = f->face->glyph; // a small shortcut
+  FT_Bitmap *bitmap = &slot->bitmap;
+
+  sdf_glyph_type *g =
+      malloc(sizeof(sdf_glyph_type) + bitmap->width * bitmap->rows);
+  if (g == NULL) {
+    warn("cannot allocate distance field");
+    return NULL;
+  }
+  g->codepoint = codepoint;
+  g->left = slot->bitmap_left;
+  g->top = slot->bitmap_top;
+  g->advance = slot->advance.x;
+  g->width = bitmap->width;
+  g->rows = bitmap->rows;
+  for (unsigned int r = 0; r < bitmap->rows; ++r) {
+    memcpy(&g->distance[r * bitmap->width], bitmap->buffer + r * bitmap->pitch,
+           bitmap->width);
+  }
+
+  size_t i = sdf_hash(codepoint, f->sdf_allocated);
+  while (f->sdf[i] != NULL) {
+    i = (i + 1) & (f->sdf_allocated - 1);
+  }
+  f->sdf[i] = g;
+  ++f->sdf_count;
+
+  return g;
+}
+
+// scale a distance field to the font size and convert to coverage
+//
+// each output pixel centre is mapped back into the field, the distance
+// is bilinearly interpolated, scaled to output pixels and turned into
+// coverage as a one pixel wide ramp centred on the edge.  Everything
+// is fixed point.
+static bool sdf_resolve(FONT_type *font, const sdf_glyph_type *g,
+                        FONT_glyph_type *glyph) {
+
+  const double k = (double)font->height / SDF_HEIGHT;
+
+  // an empty field, e.g. a space, has no samples to clamp to and
+  // only an advance
+  if (g->width == 0 || g->rows == 0) {
+    *glyph = (FONT_glyph_type){
+        .advance = (int)((g->advance * k + 32) / 64),
+        .coverage = NULL,
+    };
+    return true;
+  }
+
+  // output bitmap position and size covering the scaled field
+  const int left = (int)floor(g->left * k);
+  const int top = (int)ceil(g->top * k);
+  const int width = (int)ceil((g->left + g->width) * k) - left;
+  const int rows = top - (int)floor((g->top - g->rows) * k);
+
+  uint8_t *out = scratch(font, (void **)&font->resolved,
+                         &font->resolved_length, (size_t)width * rows);
+  int32_t *x0 = scratch(font, (void **)&font->columns, &font->columns_length,
+                        3 * sizeof(int32_t) * width);
+  if (out == NULL || x0 == NULL) {
+    return false;
+  }
+  glyph->coverage = out;
+
+  // source columns (x0, x1) and weight of x1 in 1/256 per output column
+  int32_t *x1 = x0 + width;
+  int32_t *fx = x1 + width;
+  for (int o = 0; o < width; ++o) {
+    double sx = (left + o + 0.5) / k - g->left - 0.5;
+    int i = (int)floor(sx);
+    fx[o] = (int32_t)((sx - i) * 256);
+    x0[o] = i < 0 ? 0 : i >= g->width ? g->width - 1 : i;
+    x1[o] = i + 1 < 0 ? 0 : i + 1 >= g->width ? g->width - 1 : i + 1;
+  }
+
+  // field values are 128 + distance × 128 / SDF_SPREAD, so
+  //   coverage = (d - 128) × SDF_SPREAD / 128 × k × 255 + 127.5
+  // with d in 8.8 fixed point and the result in 16.16
+  const int32_t m = (int32_t)(k * SDF_SPREAD * 255 * 2 + 0.5);
+
+  for (int q = 0; q < rows; ++q) {
+    double sy = g->top - (top - q - 0.5) / k - 0.5;
+    int j = (int)floor(sy);
+    const int32_t fy = (int32_t)((sy - j) * 256);
+    const int y0 = j < 0 ? 0 : j >= g->rows ? g->rows - 1 : j;
+    const int y1 = j + 1 < 0 ? 0 : j + 1 >= g->rows ? g->rows - 1 : j + 1;
+    const uint8_t *r0 = &g->distance[y0 * g->width];
+    const uint8_t *r1 = &g->distance[y1 * g->width];
+
+    for (int o = 0; o < width; ++o) {
+      int32_t top_row = r0[x0[o]] * (256 - fx[o]) + r0[x1[o]] * fx[o];
+      int32_t bottom_row = r1[x0[o]] * (256 - fx[o]) + r1[x1[o]] * fx[o];
+      int32_t d = (top_row * (256 - fy) + bottom_row * fy) >> 8;
+      int32_t c = ((d - 128 * 256) * m + 127 * 65536 + 32768) >> 16;
+      c = c < 0 ? 0 : c;
+      c = c > 255 ? 255 : c;
+      out[o] = (uint8_t)c;
+    }
+    out += width;
+  }
+
+  glyph->left = left;
+  glyph->top = top;
+  glyph->advance = (int)((g->advance * k + 32) / 64);
+  glyph->width = width;
+  glyph->rows = rows;
+  glyph->pitch = width;
+
+  return true;
+}
+#endif
+
+// render an outline into scratch memory, FT_LOAD_RENDER would give the
+// glyph slot a newly allocated bitmap for every glyph
+static bool outline_render(FONT_type *font, FT_Library library,
+                           FT_GlyphSlot slot, FONT_glyph_type *glyph) {
+
+  // whole pixels covering the outline, as the smooth renderer does
+  FT_Outline *outline = &slot->outline;
+  FT_BBox box;
+  FT_Outline_Get_CBox(outline, &box);
+  const FT_Pos left = box.xMin & -64;
+  const FT_Pos bottom = box.yMin & -64;
+  const FT_Pos right = (box.xMax + 63) & -64;
+  const FT_Pos top = (box.yMax + 63) & -64;
+  const int width = (int)((right - left) >> 6);
+  const int rows = (int)((top - bottom) >> 6);
+
+  uint8_t *buffer = scratch(font, (void **)&font->rendered,
+                            &font->rendered_length, (size_t)width * rows + 1);
+  if (buffer == NULL) {
+    return false;
+  }
+
+  if (width > 0 && rows > 0) {
+    memset(buffer, 0, (size_t)width * rows);
+    FT_Bitmap bitmap;
+    FT_Bitmap_Init(&bitmap);
+    bitmap.width = width;
+    bitmap.rows = rows;
+    bitmap.pitch = width;
+    bitmap.buffer = buffer;
+    bitmap.num_grays = 256;
+    bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+
+    FT_Outline_Translate(outline, -left, -bottom);
+    int error = FT_Outline_Get_Bitmap(library, outline, &bitmap);
+    if (error != 0) {
+      return false;
+    }
+  }
+
+  glyph->left = (int)(left >> 6);
+  glyph->top = (int)(top >> 6);
+  glyph->advance = slot->advance.x >> 6;
+  glyph->width = width;
+  glyph->rows = rows;
+  glyph->pitch = width;
+  glyph->coverage = buffer;
+
+  return true;
+}
+
+// find the face and glyph index for a codepoint
+//
+// the first time a codepoint is seen each face of the chain is asked
+// in order, after that it is a two level table lookup
+static uint32_t lookup(FONT_type *font, uint32_t codepoint) {
+
+  if (codepoint > 0x10ffff) {
+    return LOOKUP_MISSING << LOOKUP_SHIFT;
+  }
+
+  uint32_t **page = &font->pages[codepoint >> PAGE_SHIFT];
+  if (*page == NULL) {
+    *page = calloc(PAGE_SIZE, sizeof(uint32_t));
+    if (*page == NULL) {
+      warn("cannot allocate codepoint table");
+      return LOOKUP_MISSING << LOOKUP_SHIFT;
+    }
+  }
+
+  uint32_t *entry = &(*page)[codepoint & (PAGE_SIZE - 1)];
+  if (*entry == 0) {
+    *entry = LOOKUP_MISSING << LOOKUP_SHIFT;
+    for (int i = 0; i < font->chain_length; ++i) {
+      FT_UInt glyph_index =
+          FT_Get_Char_Index(font->chain[i].face->face, codepoint);
+      if (glyph_index != 0 && glyph_index <= LOOKUP_GLYPH_MASK) {
+        *entry = ((uint32_t)(i + 1) << LOOKUP_SHIFT) | glyph_index;
+        break;
+      }
+    }
+  }
+  return *entry;
+}
+
+// render a glyph, from the atlas if present otherwise by FreeType
+bool FONT_glyph(FONT_type *font, uint32_t codepoint, FONT_glyph_type *glyph) {
+
+  // codepoints in no face show as the missing glyph of the main face
+  uint32_t entry = lookup(font, codepoint);
+  uint32_t member = entry >> LOOKUP_SHIFT;
+  FT_UInt glyph_index = entry & LOOKUP_GLYPH_MASK;
+  if (member == LOOKUP_MISSING) {
+    member = 0;
+    glyph_index = 0;
+  } else {
+    --member;
+  }
+  member_type *m = &font->chain[member];
+
+  if (m->strike != NULL) {
+    const uint8_t *coverage;
+    const ATLAS_metrics_type *am =
+        ATLAS_glyph(font->atlas, m->strike, codepoint, &coverage);
+    if (am != NULL) {
+      glyph->left = am->left;
+      glyph->top = am->top;
+      glyph->advance = am->advance;
+      glyph->width = am->width;
+      glyph->rows = am->rows;
+      glyph->pitch = am->width;
+      glyph->coverage = coverage;
+      return true;
+    }
+  }
+
+#if HAVE_SDF
+  if (font->sdf) {
+    const sdf_glyph_type *g = sdf_glyph(m->face, codepoint, glyph_index);
+    return g != NULL && sdf_resolve(font, g, glyph);
+  }
+#endif
+
+  FT_Face face = m->face->face;
+  FT_Activate_Size(m->size);
+  int error = FT_Load_Glyph(face, glyph_index, FT_LOAD_DEFAULT);
+  if (error != 0) {
+    return false;
+  }
+
+  FT_GlyphSlot slot = face->glyph; // a small shortcut
+  if (slot->format == FT_GLYPH_FORMAT_OUTLINE) {
+    return outline_render(font, m->face->library, slot, glyph);
+  }
+
+  // embedded bitmaps are allocated by FreeType, render is a no-op
+  error = FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+  if (error != 0) {
+    return false;
+  }
+  FT_Bitmap *bitmap = &slot->bitmap;
+  if (bitmap->pixel_mode != FT_PIXEL_MODE_GRAY || bitmap->num_grays != 256) {
+    error = FT_Bitmap_Convert(m->face->library, bitmap, &font->converted, 1);
+    if (error != 0) {
+      return false;
+    }
+    bitmap = &font->converted;
+
+    // convert gives 0…num_grays-1, scale to 0…255
+    if (bitmap->num_grays > 1 && bitmap->num_grays != 256) {
+      const unsigned int max = bitmap->num_grays - 1;
+      for (unsigned int n = 0; n < bitmap->rows * bitmap->pitch; ++n) {
+        bitmap->buffer[n] = bitmap->buffer[n] * 255 / max;
+      }
+    }
+  }
+
+  glyph->left = slot->bitmap_left;
+  glyph->top = slot->bitmap_top;
+  glyph->advance = slot->advance.x >> 6;
+  glyph->width = bitmap->width;
+  glyph->rows = bitmap->rows;
+  glyph->pitch = bitmap->pitch;
+  glyph->coverage = bitmap->buffer;
+
+  return true;
+}
+
+// render FreeType glyphs into a scratch arena
+void FONT_scratch(FONT_type *font, ARENA_type *arena) {
+  font->arena = arena;
+}
+
+// activate the size of this font and return the face to load glyphs
+FT_Face FONT_face(FONT_type *font) {
+  FT_Activate_Size(font->chain[0].size);
+  return font->chain[0].face->face;
+}
@@ -0,0 +1,84 @@
+// font.h
+
+#if !defined(FONT_H)
+#define FONT_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "arena.h"
+#include "atlas.h"
+
+// type to hold a face at a particular pixel size
+typedef struct FONT_struct FONT_type;
+
+// a rendered glyph, the coverage is only valid until the next glyph
+// is requested from the same font, or with a scratch arena until the
+// arena is reset
+typedef struct {
+  int left;                 // bitmap offset right of the pen position
+  int top;                  // bitmap offset up from the baseline
+  int advance;              // horizontal advance in pixels
+  int width;                // bitmap width in pixels
+  int rows;                 // bitmap height in pixels
+  int pitch;                // bytes per bitmap row
+  const uint8_t *coverage;  // 8 bit grey
+} FONT_glyph_type;
+
+// functions
+// =========
+
+// create a FreeType library whose working memory is recycled, so that
+// once each glyph has been drawn drawing it again never calls malloc
+// returns NULL on failure
+FT_Library FONT_library(void);
+
+// release a library from FONT_library and its recycled memory, once
+// every font created with it has been destroyed
+// returns false if it did not come from FONT_library
+bool FONT_library_destroy(FT_Library library);
+
+// load a font file at a given pixel size
+//
+// each distinct file is memory mapped once and each library has a
+// single face per file, different sizes share the face by using
+// separate FreeType size objects
+FONT_type *FONT_create(FT_Library library, const char *font_path, int width,
+                       int height);
+
+// release the size, and the face and mapping when no longer used
+bool FONT_destroy(FONT_type *font);
+
+// add a font file to the end of the fallback chain, glyphs missing
+// from all earlier files are taken from the first file that has them
+// returns false if the file cannot be loaded
+bool FONT_fallback(FONT_type *font, const char *font_path);
+
+// use pre-rendered glyphs from a baked atlas when available,
+// returns false if the atlas has no strike for this font and size
+bool FONT_atlas(FONT_type *font, ATLAS_type *atlas);
+
+// render a glyph, from the atlas if present otherwise by FreeType
+// returns false if the glyph cannot be loaded
+bool FONT_glyph(FONT_type *font, uint32_t codepoint, FONT_glyph_type *glyph);
+
+// render glyphs that FreeType draws into a scratch arena, falling back
+// to buffers of the font when it is full; NULL stops using it
+void FONT_scratch(FONT_type *font, ARENA_type *arena);
+
+// change the pixel size, this is cheap when using distance fields
+// returns false if FreeType cannot set the size
+bool FONT_resize(FONT_type *font, int width, int height);
+
+// resolve glyphs from signed distance fields, each glyph is rendered
+// once per face at a fixed size and then scaled to the font size
+// returns false if not supported (needs FreeType 2.11 or later)
+bool FONT_sdf(FONT_type *font, bool enable);
+
+// activate the size of this font and return the face to load glyphs
+FT_Face FONT_face(FONT_type *font);
+
+#endif
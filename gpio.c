@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/endian.h>
@@ -20,6 +21,20 @@
 // global handle to access gpio
 int handle = GPIO_INVALID_HANDLE;
 
+// number of GPIO_setup calls without a GPIO_teardown, the handle is
+// shared by all users (e.g. several panels)
+static int users = 0;
+
+// last level written to each output pin, -1 if not known, so writes
+// that would not change the pin skip the ioctl
+//
+// each pin is only written by one thread (a panel and its flush
+// thread own their pins) so per pin entries need no lock
+#define GPIO_PINS 64
+static int8_t shadow[GPIO_PINS];
+static uint64_t writes[GPIO_PINS];
+static uint64_t ioctls[GPIO_PINS];
+
 // set up access to the GPIO
 bool GPIO_setup(const char *gpio_path) {
   if (handle == GPIO_INVALID_HANDLE) {
@@ -28,13 +43,19 @@ bool GPIO_setup(const char *gpio_path) {
       warn("cannot open gpio: %s", gpio_path);
       return false;
     }
+    memset(shadow, -1, sizeof(shadow));
   }
+  ++users;
 
   return true;
 }
 
 // revoke access to GPIO
 bool GPIO_teardown() {
+  if (users > 0 && --users > 0) {
+    return true; // still in use
+  }
+
   if (handle != GPIO_INVALID_HANDLE) {
     close(handle);
   }
@@ -80,9 +101,17 @@ int GPIO_read(GPIO_pin_type pin) {
 }
 
 void GPIO_write(GPIO_pin_type pin, int value) {
-  if ((unsigned)(pin) > 63) {
+  if ((unsigned)(pin) >= GPIO_PINS) {
     return;
   }
+  value = (value != 0) ? GPIO_PIN_HIGH : GPIO_PIN_LOW;
+
+  ++writes[pin];
+  if (shadow[pin] == value) {
+    return;
+  }
+  ++ioctls[pin];
+
   struct gpio_req req;
 
   req.gp_name[0] = '\0';
@@ -91,5 +120,25 @@ void GPIO_write(GPIO_pin_type pin, int value) {
 
   if (ioctl(handle, GPIOWRITE, &req) == -1) {
     warn("GPIO_write error: %d\n", errno);
-  };
+    shadow[pin] = -1; // level unknown
+  } else {
+    shadow[pin] = value;
+  }
+}
+
+void GPIO_write_mask(uint64_t mask, uint64_t values) {
+  for (int pin = 0; mask != 0 && pin < GPIO_PINS; ++pin, mask >>= 1) {
+    if ((mask & 1) != 0) {
+      GPIO_write(pin, (values >> pin) & 1);
+    }
+  }
+}
+
+void GPIO_counters(GPIO_counters_type *counters) {
+  counters->writes = 0;
+  counters->ioctls = 0;
+  for (int pin = 0; pin < GPIO_PINS; ++pin) {
+    counters->writes += writes[pin];
+    counters->ioctls += ioctls[pin];
+  }
 }
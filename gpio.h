@@ -46,6 +46,12 @@ typedef enum {
   GPIO_OUTPUT, // as output
 } GPIO_mode_type;
 
+// write statistics
+typedef struct {
+  uint64_t writes; // GPIO_write requests
+  uint64_t ioctls; // requests that changed a pin, the rest were skipped
+} GPIO_counters_type;
+
 // GPIO device for RaspberryPi
 #define GPIO_DEVICE "/dev/gpio0"
 
@@ -56,7 +62,7 @@ typedef enum {
 // return false if failure
 bool GPIO_setup(const char *gpio_path);
 
-// release mapped device registers
+// release mapped device registers, once every setup has a teardown
 bool GPIO_teardown();
 
 // set a mode for a given GPIO pin
@@ -65,7 +71,16 @@ void GPIO_mode(GPIO_pin_type pin, GPIO_mode_type mode);
 // return a value (0/1) for a given input pin
 int GPIO_read(GPIO_pin_type pin);
 
-// set or clear a given output pin
+// set or clear a given output pin, nothing is sent to the device if
+// the pin is already at that level
 void GPIO_write(GPIO_pin_type pin, int value);
 
+// set several output pins at once, pin n is set to bit n of values if
+// bit n of mask is set; only the pins that change are written
+void GPIO_write_mask(uint64_t mask, uint64_t values);
+
+// totals of writes requested and written since start
+// (totals are only approximate while other threads are writing)
+void GPIO_counters(GPIO_counters_type *counters);
+
 #endif
@@ -1,289 +1,1688 @@
 // ili9486.c
 
 #include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "gpio.h"
 #include "ili9486.h"
 #include "spi.h"
 
-// preset for WAVESHARE 3.5inch RPI LCD (C)
-#define DISPLAY_18BIT 1
-#define DISPLAY_INVERTED 0
-#define DISPLAY_BGR 1
-#define DISPLAY_SWAP_XY 1
-#define DISPLAY_SPI_16BIT 1
+// Memory Access Control register bits
+#define MAC_HORIZONTAL_REFRESH_ORDER (1 << 2)
+#define MAC_BGR_ORDER (1 << 3)
+#define MAC_VERTICAL_REFRESH_ORDER (1 << 4)
+#define MAC_ROW_COLUMN_EXCHANGE (1 << 5)
+#define MAC_COLUMN_ADDRESS_ORDER (1 << 6)
+#define MAC_ROW_ADDRESS_ORDER (1 << 7)
+
+#define MAC_ROTATE_180 (MAC_COLUMN_ADDRESS_ORDER | MAC_ROW_ADDRESS_ORDER)
+
+// Interface Pixel Format register values
+#define PIXEL_FORMAT_18BIT 0x66
+#define PIXEL_FORMAT_16BIT 0x55
+
+// SPI clock frequency until calibrated
+static const uint32_t spi_bps = 30000000;
+
+// SPI clock for reading back, reads need a much slower cycle
+static const uint32_t read_bps = 4000000;
+
+// pixel kernels
+// =============
+//
+// the framebuffer holds pixels in the format sent to the panel, so a
+// flush is a straight copy.  The per-row loops are generated for each
+// pixel format by DEFINE_KERNELS so that the inner loops have no test
+// of the format; a panel selects its set once when created.
+
+// a row of pixel operations for one framebuffer format
+typedef struct {
+  ILI9486_format_type format;
+  size_t bytes; // per pixel
+  void (*fill)(uint8_t *p, size_t count, ILI9486_colour_type colour);
+  void (*alpha)(uint8_t *p, const uint8_t *coverage, size_t count,
+                ILI9486_colour_type foreground,
+                ILI9486_colour_type background);
+  void (*over)(uint8_t *p, const uint8_t *coverage, size_t count,
+               ILI9486_colour_type foreground);
+  void (*rgba)(uint8_t *p, const uint8_t *s, size_t count);
+  void (*sprite)(uint8_t *p, const uint8_t *s, const uint8_t *alpha,
+                 size_t count);
+  void (*load)(const uint8_t *p, uint8_t *rgb); // pixel to 8 bit R, G, B
+  uint8_t precision[3];                         // significant R, G, B bits
+} kernels_type;
+
+// blend a single colour component
+static inline uint8_t blend(uint8_t fg, uint8_t bg, unsigned int alpha) {
+  // bg + (fg - bg) × α / 255 with rounding, avoiding a division
+  unsigned int t = fg * alpha + bg * (255 - alpha) + 128;
+  return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+// blend two components at once, one in the low byte of each 16 bit
+// half, giving the same as blend() on each; every sum is below 65536
+// so nothing carries from one half into the other
+static inline uint32_t blend_pair(uint32_t fg, uint32_t bg,
+                                  unsigned int alpha) {
+  uint32_t t = fg * alpha + bg * (255 - alpha) + 0x00800080;
+  return ((t + ((t >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+}
+
+// 18 bit: a byte per component, the low two bits are ignored
+#define RGB666_BYTES 3
+#define RGB666_STORE(p, r, g, b)                                               \
+  do {                                                                         \
+    (p)[0] = (r);                                                              \
+    (p)[1] = (g);                                                              \
+    (p)[2] = (b);                                                              \
+  } while (0)
+#define RGB666_LOAD(p, rgb)                                                    \
+  do {                                                                         \
+    (rgb)[0] = (p)[0];                                                         \
+    (rgb)[1] = (p)[1];                                                         \
+    (rgb)[2] = (p)[2];                                                         \
+  } while (0)
+#define RGB666_PRECISION {0xfc, 0xfc, 0xfc}
+
+// 16 bit: 5-6-5 bits, most significant byte first
+#define RGB565_BYTES 2
+#define RGB565_STORE(p, r, g, b)                                               \
+  do {                                                                         \
+    (p)[0] = ((r)&0xf8) | ((g) >> 5);                                          \
+    (p)[1] = (((g) << 3) & 0xe0) | ((b) >> 3);                                 \
+  } while (0)
+#define RGB565_LOAD(p, rgb)                                                    \
+  do {                                                                         \
+    (rgb)[0] = (p)[0] & 0xf8;                                                  \
+    (rgb)[1] = ((p)[0] << 5 | (p)[1] >> 3) & 0xfc;                             \
+    (rgb)[2] = ((p)[1] << 3) & 0xf8;                                           \
+  } while (0)
+#define RGB565_PRECISION {0xf8, 0xfc, 0xf8}
+
+#define DEFINE_KERNELS(name, FORMAT, BYTES, STORE, LOAD, PRECISION)            \
+  static void name##_fill(uint8_t *p, size_t count,                           \
+                          ILI9486_colour_type colour) {                        \
+    if (count == 0) {                                                          \
+      return;                                                                  \
+    }                                                                          \
+    /* one pixel, then copy what is filled so far until the end */             \
+    STORE(p, colour.red, colour.green, colour.blue);                           \
+    const size_t total = count * BYTES;                                        \
+    for (size_t done = BYTES; done < total; done *= 2) {                       \
+      memcpy(p + done, p, done < total - done ? done : total - done);          \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void name##_alpha(uint8_t *p, const uint8_t *coverage, size_t count, \
+                           ILI9486_colour_type foreground,                     \
+                           ILI9486_colour_type background) {                   \
+    for (size_t n = 0; n < count; ++n) {                                       \
+      unsigned int alpha = coverage[n];                                        \
+      STORE(p, blend(foreground.red, background.red, alpha),                   \
+            blend(foreground.green, background.green, alpha),                  \
+            blend(foreground.blue, background.blue, alpha));                   \
+      p += BYTES;                                                              \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  /* red and blue are blended as a pair, green on its own */                 \
+  static void name##_over(uint8_t *p, const uint8_t *coverage, size_t count,  \
+                          ILI9486_colour_type foreground) {                    \
+    const uint32_t fg_rb = foreground.red | (uint32_t)foreground.blue << 16;   \
+    for (size_t n = 0; n < count; ++n) {                                       \
+      uint8_t *q = p + n * BYTES;                                              \
+      uint8_t rgb[3];                                                          \
+      LOAD(q, rgb);                                                            \
+      unsigned int alpha = coverage[n];                                        \
+      uint32_t rb = blend_pair(fg_rb, rgb[0] | (uint32_t)rgb[2] << 16, alpha); \
+      STORE(q, (uint8_t)rb, blend(foreground.green, rgb[1], alpha),            \
+            (uint8_t)(rb >> 16));                                              \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void name##_rgba(uint8_t *p, const uint8_t *s, size_t count) {       \
+    for (size_t n = 0; n < count; ++n) {                                       \
+      STORE(p, s[2], s[1], s[0]); /* ignore alpha */                           \
+      s += 4;                                                                  \
+      p += BYTES;                                                              \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  /* s is already in this format */                                          \
+  static void name##_sprite(uint8_t *p, const uint8_t *s,                      \
+                            const uint8_t *alpha, size_t count) {              \
+    for (size_t n = 0; n < count; ++n) {                                       \
+      uint8_t *q = p + n * BYTES;                                              \
+      uint8_t fg[3];                                                           \
+      uint8_t bg[3];                                                           \
+      LOAD(s + n * BYTES, fg);                                                 \
+      LOAD(q, bg);                                                             \
+      STORE(q, blend(fg[0], bg[0], alpha[n]), blend(fg[1], bg[1], alpha[n]),   \
+            blend(fg[2], bg[2], alpha[n]));                                    \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  static void name##_load(const uint8_t *p, uint8_t *rgb) {                    \
+    LOAD(p, rgb);                                                              \
+  }                                                                            \
+                                                                               \
+  static const kernels_type name##_kernels = {                                 \
+      .format = FORMAT,                                                        \
+      .bytes = BYTES,                                                          \
+      .fill = name##_fill,                                                     \
+      .alpha = name##_alpha,                                                   \
+      .over = name##_over,                                                     \
+      .rgba = name##_rgba,                                                     \
+      .sprite = name##_sprite,                                                 \
+      .load = name##_load,                                                     \
+      .precision = PRECISION,                                                  \
+  }
+
+DEFINE_KERNELS(rgb666, ILI9486_FORMAT_RGB666, RGB666_BYTES, RGB666_STORE,
+               RGB666_LOAD, RGB666_PRECISION);
+DEFINE_KERNELS(rgb565, ILI9486_FORMAT_RGB565, RGB565_BYTES, RGB565_STORE,
+               RGB565_LOAD, RGB565_PRECISION);
+
+// panel profiles
+// ==============
+
+// one command of an initialisation sequence
+typedef struct {
+  uint8_t cmd;
+  uint8_t delay_ms; // after the command
+  uint8_t length;
+  uint8_t data[15];
+} command_type;
+
+#define COMMAND(c, d, ...)                                                     \
+  {                                                                            \
+    .cmd = (c), .delay_ms = (d),                                               \
+    .length = sizeof((uint8_t[]){0, __VA_ARGS__}) - 1, .data = {__VA_ARGS__},  \
+  }
+
+// a panel model
+typedef struct {
+  const char *name;
+  int width;     // pixels after any row/column exchange
+  int height;    // ..
+  bool bus16;    // 16 bit shift register interface, commands are padded
+  bool rgb565;   // 16 bit pixels, otherwise 18 bit
+  bool bgr;      // panel colour order
+  bool swap_xy;  // row/column exchange for landscape
+  bool invert;   // display inversion on
+  bool readable; // MISO is wired so registers can be read back
+  const command_type *init;
+  size_t init_length;
+} panel_type;
+
+// panel specific commands, the driver adds the pixel format, memory
+// access control, inversion, sleep out and display on afterwards
+static const command_type ili9486_init[] = {
+    COMMAND(0xb0, 0, 0x00),             // Interface Mode Control
+    COMMAND(0x11, 120),                 // Sleep OUT
+    COMMAND(0xb4, 0, 0x00),             // Display Inversion Control
+    COMMAND(0xc0, 0, 0x09, 0x09),       // Power Control 1
+    COMMAND(0xc1, 0, 0x41, 0x00),       // Power Control 2
+    COMMAND(0xc2, 0, 0x33),             // Power Control 3
+    COMMAND(0xc5, 0, 0x00, 0x36),       // VCOM Control 1
+    COMMAND(0xe0, 0, 0x00, 0x2c, 0x2c,  // Positive Gamma Control
+            0x0b, 0x0c, 0x04, 0x4c, 0x64, 0x36, 0x03, 0x0e, 0x01, 0x10,
+            0x01, 0x00),
+    COMMAND(0xe1, 0, 0x0f, 0x37, 0x37,  // Negative Gamma Control
+            0x0c, 0x0f, 0x05, 0x50, 0x32, 0x36, 0x04, 0x0b, 0x00, 0x19,
+            0x14, 0x0f),
+    COMMAND(0xb6, 0, 0x00, 0x02, 0x3b), // Display Function Control
+};
+
+static const command_type st7796_init[] = {
+    COMMAND(0x01, 120),                 // Software Reset
+    COMMAND(0x11, 120),                 // Sleep OUT
+    COMMAND(0xf0, 0, 0xc3),             // Command Set Control: enable
+    COMMAND(0xf0, 0, 0x96),             // ..
+    COMMAND(0xb4, 0, 0x01),             // Display Inversion Control
+    COMMAND(0xb7, 0, 0xc6),             // Entry Mode Set
+    COMMAND(0xc0, 0, 0x80, 0x45),       // Power Control 1
+    COMMAND(0xc1, 0, 0x13),             // Power Control 2
+    COMMAND(0xc2, 0, 0xa7),             // Power Control 3
+    COMMAND(0xc5, 0, 0x0a),             // VCOM Control
+    COMMAND(0xe8, 0, 0x40, 0x8a, 0x00,  // Display Output Ctrl Adjust
+            0x00, 0x29, 0x19, 0xa5, 0x33),
+    COMMAND(0xe0, 0, 0xd0, 0x08, 0x0f,  // Positive Gamma Control
+            0x06, 0x06, 0x33, 0x30, 0x33, 0x47, 0x17, 0x13, 0x13, 0x2b,
+            0x31),
+    COMMAND(0xe1, 0, 0xd0, 0x0a, 0x11,  // Negative Gamma Control
+            0x0b, 0x09, 0x07, 0x2f, 0x33, 0x47, 0x38, 0x15, 0x16, 0x2c,
+            0x32),
+    COMMAND(0xf0, 0, 0x3c),             // Command Set Control: disable
+    COMMAND(0xf0, 0, 0x69),             // ..
+};
+
+static const panel_type panels[] = {
+    {
+        // WAVESHARE 3.5inch RPI LCD (C), 125 MHz capable
+        .name = "waveshare-c",
+        .width = 480,
+        .height = 320,
+        .bus16 = true,
+        .rgb565 = false,
+        .bgr = true,
+        .swap_xy = true,
+        .invert = false,
+        .readable = false,
+        .init = ili9486_init,
+        .init_length = sizeof(ili9486_init) / sizeof(ili9486_init[0]),
+    },
+    {
+        // WAVESHARE 3.5inch RPI LCD (B), IPS panel that needs inversion
+        .name = "waveshare-b",
+        .width = 480,
+        .height = 320,
+        .bus16 = true,
+        .rgb565 = true,
+        .bgr = true,
+        .swap_xy = true,
+        .invert = true,
+        .readable = false,
+        .init = ili9486_init,
+        .init_length = sizeof(ili9486_init) / sizeof(ili9486_init[0]),
+    },
+    {
+        // 3.5/4 inch ST7796S modules with a native 4-wire SPI interface
+        .name = "st7796",
+        .width = 480,
+        .height = 320,
+        .bus16 = false,
+        .rgb565 = true,
+        .bgr = true,
+        .swap_xy = true,
+        .invert = true,
+        .readable = true,
+        .init = st7796_init,
+        .init_length = sizeof(st7796_init) / sizeof(st7796_init[0]),
+    },
+};
+
+// most changed rectangles kept for each priority, more are merged
+#define DAMAGE_RECTS 4
+
+// a rectangle in pixels
+typedef struct {
+  int x;
+  int y;
+  int width;
+  int height;
+} rect_type;
+
+// a panel, or a canvas of tiled panels
+//
+// the framebuffer of a panel in a canvas is its part of the canvas
+// framebuffer, rows are stride pixels apart
+struct ILI9486_struct {
+  uint8_t *framebuffer;        // first pixel
+  bool owner;                  // framebuffer was allocated for this handle
+  int width;                   // pixels
+  int height;                  // ..
+  int stride;                  // pixels from one row to the next
+  const kernels_type *kernels; // for the framebuffer format
+  uint8_t *layer;              // background, laid out as the framebuffer
+
+  // a single panel
+  const panel_type *panel;
+  ILI9486_transport_type bus; // SPI and GPIO unless configured
+  bool gpio;                  // GPIO is set up
+  SPI_type *spi;
+  uint64_t bytes;     // sent over the bus
+  uint64_t transfers; // ..
+  int rs;
+  int reset;
+  uint8_t mac;
+  uint32_t bps;             // SPI clock
+  size_t chunk;             // largest pixel transfer, 0 for one per row
+  char spi_device[64];      // to find the panel in the state file
+  int spi_address;          // ..
+  const char *state_file;   // tuned settings, may be NULL
+
+  // a canvas
+  ILI9486_type *tile[ILI9486_MAX_TILES];
+  rect_type tile_area[ILI9486_MAX_TILES]; // of each panel on the canvas
+  size_t tile_count;
+
+  // changes not yet sent, by priority
+  rect_type damage[ILI9486_PRIORITIES][DAMAGE_RECTS];
+  size_t damage_count[ILI9486_PRIORITIES];
+
+  // rectangles being sent by a flush, high priority first
+  rect_type job[ILI9486_PRIORITIES * DAMAGE_RECTS];
+  size_t job_count;
+  size_t job_high;
+
+  // when the high priority part of the last job was sent
+  bool timed;
+  struct timespec sent_first;
+  struct timespec sent_last;
+
+  // flush thread
+  bool threaded;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  bool pending; // a flush has been requested or is in progress
+  bool stop;    // thread should exit
+};
+
+// address of a pixel
+static inline uint8_t *pixel(ILI9486_type *lcd, int x, int y) {
+  return lcd->framebuffer + ((size_t)y * lcd->stride + x) * lcd->kernels->bytes;
+}
+
+// the panel bus
+// =============
+//
+// SPI with RS on a GPIO pin, unless the configuration gives another
+// transport
+
+static void hardware_select(void *context, bool data) {
+  ILI9486_type *lcd = context;
+  GPIO_write(lcd->rs, data);
+}
+
+static void hardware_send(void *context, const void *buffer,
+                          size_t length) {
+  ILI9486_type *lcd = context;
+  SPI_send(lcd->spi, buffer, length);
+}
+
+static void hardware_read(void *context, const void *buffer, void *received,
+                          size_t length) {
+  ILI9486_type *lcd = context;
+  SPI_read(lcd->spi, buffer, received, length);
+}
+
+static bool hardware_speed(void *context, uint32_t bps) {
+  ILI9486_type *lcd = context;
+  return SPI_speed(lcd->spi, bps);
+}
+
+static inline void bus_select(ILI9486_type *lcd, bool data) {
+  lcd->bus.select(lcd->bus.context, data);
+}
+
+static inline void bus_send(ILI9486_type *lcd, const void *buffer,
+                            size_t length) {
+  lcd->bus.send(lcd->bus.context, buffer, length);
+  lcd->bytes += length;
+  ++lcd->transfers;
+}
+
+static inline void bus_read(ILI9486_type *lcd, const void *buffer,
+                            void *received, size_t length) {
+  lcd->bus.read(lcd->bus.context, buffer, received, length);
+  lcd->bytes += length;
+  ++lcd->transfers;
+}
+
+static inline bool bus_speed(ILI9486_type *lcd, uint32_t bps) {
+  return lcd->bus.speed(lcd->bus.context, bps);
+}
+
+static void delay_ms(int ms) {
+  if (ms > 0) {
+    usleep(1000 * ms);
+  }
+}
+
+// send a command and its parameters, padding each byte to a word on a
+// 16 bit bus
+//
+// RS is only raised for parameters, so a run of commands without
+// parameters keeps it low and GPIO_write skips the repeated writes
+static void command(ILI9486_type *lcd, uint8_t cmd, const uint8_t *data,
+                    size_t length) {
+  uint8_t buffer[2 * 16];
+  size_t n = 0;
+  bool bus16 = lcd->panel->bus16;
+
+  if (bus16) {
+    buffer[n++] = 0x00;
+  }
+  buffer[n++] = cmd;
+  bus_select(lcd, false);
+  bus_send(lcd, buffer, n);
+
+  n = 0;
+  for (size_t i = 0; i < length && i < 16; ++i) {
+    if (bus16) {
+      buffer[n++] = 0x00;
+    }
+    buffer[n++] = data[i];
+  }
+  if (n > 0) {
+    bus_select(lcd, true);
+    bus_send(lcd, buffer, n);
+  }
+}
+
+// send setup commands over SPI
+#define SEND(lcd, cmd, ...)                                                    \
+  do {                                                                         \
+    const uint8_t _data[] = {0, __VA_ARGS__};                                  \
+    command((lcd), (cmd), &_data[1], sizeof(_data) - 1);                       \
+  } while (0)
+
+// read parameters of a register, up to four
+//
+// the command and the read are a single transfer, chip select going
+// high between them would end the read; RS stays low throughout as
+// the panel only looks at it for the command word.  The first
+// parameter returned by the read commands is a dummy and is skipped;
+// on a 16 bit bus only the low byte of each word is kept
+static void read_register(ILI9486_type *lcd, uint8_t cmd, uint8_t *data,
+                          size_t count) {
+  size_t spx = lcd->panel->bus16 ? 2 : 1;
+  uint8_t send[(2 + 4) * 2];
+  uint8_t received[sizeof(send)];
+
+  if (count > 4) {
+    count = 4;
+  }
+  size_t length = (2 + count) * spx;
+  memset(send, 0, sizeof(send));
+  send[spx - 1] = cmd;
+
+  bus_speed(lcd, read_bps);
+  bus_select(lcd, false);
+  bus_read(lcd, send, received, length);
+  bus_speed(lcd, lcd->bps);
+
+  for (size_t i = 0; i < count; ++i) {
+    data[i] = received[(3 + i) * spx - 1];
+  }
+}
+
+// Interface Pixel Format register value
+static uint8_t pixel_format(const panel_type *panel) {
+  return panel->rgb565 ? PIXEL_FORMAT_16BIT : PIXEL_FORMAT_18BIT;
+}
+
+// check if the panel is already running with the wanted settings
+//
+// uses Read Display ID (0x04) to see if the panel responds at all
+// then Read Display Status (0x09) to compare Memory Access Control
+// and pixel format and that the panel is awake with display on
+static bool panel_configured(ILI9486_type *lcd) {
+
+  uint8_t id[3];
+  read_register(lcd, 0x04, id, sizeof(id));
+  if ((id[0] == 0x00 && id[1] == 0x00 && id[2] == 0x00) ||
+      (id[0] == 0xff && id[1] == 0xff && id[2] == 0xff)) {
+    return false; // no read back from the panel
+  }
+
+  // status bits D31…D0 as four bytes
+  uint8_t status[4];
+  read_register(lcd, 0x09, status, sizeof(status));
+
+  // D30…D25 = MY MX MV ML BGR MH, same order as mac bits 7…2
+  if (((status[0] << 1) & 0xfc) != (lcd->mac & 0xfc)) {
+    return false;
+  }
+
+  // D22…D20 = interface pixel format
+  if (((status[1] >> 4) & 0x07) != (pixel_format(lcd->panel) & 0x07)) {
+    return false;
+  }
+
+  // D17 = sleep out, D10 = display on
+  return (status[1] & 0x02) != 0 && (status[2] & 0x04) != 0;
+}
+
+// send a rectangle of the framebuffer of a single panel
+//
+// the column range is the same for every row so it is only set once,
+// each row then needs a page address, a memory write and its pixels
+//
+// with a tuned chunk size, rows that follow each other in the
+// framebuffer are sent as one memory write in transfers of up to chunk
+// bytes, otherwise each row is a memory write and a transfer
+static void send_rect(ILI9486_type *lcd, const rect_type *r) {
+  size_t row = r->width * lcd->kernels->bytes;
+  int right = r->x + r->width - 1;
+  int rows = (lcd->chunk > 0 && r->width == lcd->stride) ? r->height : 1;
+  size_t chunk = (lcd->chunk > 0) ? lcd->chunk : row;
+
+  SEND(lcd, 0x2a, r->x >> 8, r->x & 0xff, right >> 8, right & 0xff);
+  for (int y = r->y; y < r->y + r->height; y += rows) {
+    SEND(lcd, 0x2b, (uint8_t)(y >> 8), (uint8_t)(y & 0xff),
+         (lcd->height - 1) >> 8, (lcd->height - 1) & 0xff);
+    command(lcd, 0x2c, NULL, 0);
+    bus_select(lcd, true);
+
+    const uint8_t *p = pixel(lcd, r->x, y);
+    for (size_t left = row * rows; left > 0;) {
+      size_t n = (left < chunk) ? left : chunk;
+      bus_send(lcd, p, n);
+      p += n;
+      left -= n;
+    }
+  }
+}
+
+// send the rectangles of the current job, timing the high priority
+// ones from the start of their first transfer to their last byte
+static void refresh_panel(ILI9486_type *lcd) {
+  lcd->timed = lcd->job_high > 0;
+  if (lcd->timed) {
+    clock_gettime(CLOCK_REALTIME, &lcd->sent_first);
+  }
+  for (size_t i = 0; i < lcd->job_count; ++i) {
+    send_rect(lcd, &lcd->job[i]);
+    if (i + 1 == lcd->job_high) {
+      clock_gettime(CLOCK_REALTIME, &lcd->sent_last);
+    }
+  }
+}
+
+// bus bytes to send the column range of a rectangle, and for each of
+// its rows
+static size_t rect_cost(const ILI9486_type *lcd) {
+  return lcd->panel->bus16 ? 2 + 8 : 1 + 4;
+}
+
+static size_t row_cost(const ILI9486_type *lcd, const rect_type *r) {
+  size_t commands = lcd->panel->bus16 ? 2 + 8 + 2 : 1 + 4 + 1;
+  return commands + r->width * lcd->kernels->bytes;
+}
+
+// clip a rectangle to an area
+// returns false if nothing is left
+static bool clip_rect(rect_type *r, const rect_type *area) {
+  int left = r->x > area->x ? r->x : area->x;
+  int top = r->y > area->y ? r->y : area->y;
+  int right = r->x + r->width;
+  int bottom = r->y + r->height;
+  if (right > area->x + area->width) {
+    right = area->x + area->width;
+  }
+  if (bottom > area->y + area->height) {
+    bottom = area->y + area->height;
+  }
+  if (left >= right || top >= bottom) {
+    return false;
+  }
+  *r = (rect_type){.x = left, .y = top, .width = right - left,
+                   .height = bottom - top};
+  return true;
+}
+
+// smallest rectangle covering two others
+static rect_type union_rect(const rect_type *a, const rect_type *b) {
+  int left = a->x < b->x ? a->x : b->x;
+  int top = a->y < b->y ? a->y : b->y;
+  int right = a->x + a->width > b->x + b->width ? a->x + a->width
+                                                 : b->x + b->width;
+  int bottom = a->y + a->height > b->y + b->height ? a->y + a->height
+                                                    : b->y + b->height;
+  return (rect_type){.x = left, .y = top, .width = right - left,
+                     .height = bottom - top};
+}
+
+static long area(const rect_type *r) {
+  return (long)r->width * r->height;
+}
+
+// add a rectangle to the damage of a single panel, rectangles that
+// overlap are merged and once the list is full the new one is merged
+// with whichever grows least
+static void add_damage(ILI9486_type *lcd, rect_type r, int priority) {
+  rect_type *list = lcd->damage[priority];
+  size_t *count = &lcd->damage_count[priority];
+
+  // growth is negative for rectangles that overlap
+  size_t best = 0;
+  long growth = 0;
+  for (size_t i = 0; i < *count; ++i) {
+    rect_type u = union_rect(&list[i], &r);
+    long g = area(&u) - area(&list[i]) - area(&r);
+    if (i == 0 || g < growth) {
+      best = i;
+      growth = g;
+    }
+  }
+  if (*count == 0 || (growth > 0 && *count < DAMAGE_RECTS)) {
+    list[(*count)++] = r;
+  } else {
+    list[best] = union_rect(&list[best], &r);
+  }
+}
+
+// move damage into the job, high priority in full then the rest while
+// the budget lasts; a rectangle that does not fit is sent from the
+// top and the remaining rows stay damaged
+// returns true if no damage is left
+static bool schedule(ILI9486_type *lcd, size_t budget) {
+  lcd->job_count = 0;
+  lcd->job_high = 0;
+
+  size_t spent = 0;
+  for (int p = 0; p < ILI9486_PRIORITIES; ++p) {
+    rect_type *list = lcd->damage[p];
+    size_t count = lcd->damage_count[p];
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+      rect_type r = list[i];
+      int rows = r.height;
+      if (p != ILI9486_PRIORITY_HIGH && budget > 0) {
+        size_t left = budget > spent ? budget - spent : 0;
+        size_t cost = rect_cost(lcd);
+        rows = left > cost ? (left - cost) / row_cost(lcd, &r) : 0;
+        if (rows > r.height) {
+          rows = r.height;
+        }
+      }
+      if (rows > 0) {
+        lcd->job[lcd->job_count] = r;
+        lcd->job[lcd->job_count++].height = rows;
+        spent += rect_cost(lcd) + rows * row_cost(lcd, &r);
+      }
+      if (rows < r.height) {
+        r.y += rows;
+        r.height -= rows;
+        list[kept++] = r;
+      }
+    }
+    lcd->damage_count[p] = kept;
+    if (p == ILI9486_PRIORITY_HIGH) {
+      lcd->job_high = lcd->job_count;
+    }
+  }
+  for (int p = 0; p < ILI9486_PRIORITIES; ++p) {
+    if (lcd->damage_count[p] > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// send the job of a single panel, threaded panels return at once
+static void start(ILI9486_type *lcd) {
+  if (!lcd->threaded) {
+    refresh_panel(lcd);
+    return;
+  }
+  pthread_mutex_lock(&lcd->lock);
+  lcd->pending = true;
+  pthread_cond_broadcast(&lcd->changed);
+  pthread_mutex_unlock(&lcd->lock);
+}
+
+// flush thread of a panel, sends the framebuffer each time a flush is
+// requested
+static void *flush_thread(void *arg) {
+  ILI9486_type *lcd = arg;
+
+  pthread_mutex_lock(&lcd->lock);
+  for (;;) {
+    while (!lcd->pending && !lcd->stop) {
+      pthread_cond_wait(&lcd->changed, &lcd->lock);
+    }
+    if (lcd->stop) {
+      break;
+    }
+    pthread_mutex_unlock(&lcd->lock);
+
+    refresh_panel(lcd);
+
+    pthread_mutex_lock(&lcd->lock);
+    lcd->pending = false;
+    pthread_cond_broadcast(&lcd->changed);
+  }
+  pthread_mutex_unlock(&lcd->lock);
+  return NULL;
+}
+
+// tuning state
+// ============
+//
+// the state file has a line for each tuned panel:
+//
+//   /dev/spi0 0 41666666 16384
+//
+// giving the SPI device, address, clock and chunk size
+
+// load the tuned settings of a panel, if any
+static void load_state(ILI9486_type *lcd) {
+  if (lcd->state_file == NULL) {
+    return;
+  }
+  FILE *f = fopen(lcd->state_file, "r");
+  if (f == NULL) {
+    return; // not calibrated
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), f) != NULL) {
+    char device[64];
+    int address = 0;
+    unsigned long bps = 0;
+    unsigned long chunk = 0;
+    if (sscanf(line, "%63s %d %lu %lu", device, &address, &bps, &chunk) ==
+            4 &&
+        strcmp(device, lcd->spi_device) == 0 && address == lcd->spi_address &&
+        bps > 0) {
+      lcd->bps = bps;
+      lcd->chunk = chunk;
+    }
+  }
+  fclose(f);
+}
+
+// replace or add the settings of a panel in the state file
+static bool save_state(ILI9486_type *lcd) {
+  if (lcd->state_file == NULL) {
+    return true;
+  }
+
+  char temporary[1024];
+  snprintf(temporary, sizeof(temporary), "%s.new", lcd->state_file);
+  FILE *out = fopen(temporary, "w");
+  if (out == NULL) {
+    warn("cannot create state file: %s", temporary);
+    return false;
+  }
+
+  // other panels are kept
+  FILE *in = fopen(lcd->state_file, "r");
+  char line[256];
+  while (in != NULL && fgets(line, sizeof(line), in) != NULL) {
+    char device[64];
+    int address = 0;
+    if (sscanf(line, "%63s %d", device, &address) == 2 &&
+        strcmp(device, lcd->spi_device) == 0 && address == lcd->spi_address) {
+      continue;
+    }
+    fputs(line, out);
+  }
+  if (in != NULL) {
+    fclose(in);
+  }
+
+  fprintf(out, "%s %d %lu %lu\n", lcd->spi_device, lcd->spi_address,
+          (unsigned long)lcd->bps, (unsigned long)lcd->chunk);
+  if (fclose(out) != 0 || rename(temporary, lcd->state_file) != 0) {
+    warn("cannot write state file: %s", lcd->state_file);
+    unlink(temporary);
+    return false;
+  }
+  return true;
+}
+
+// name of a panel model, NULL after the last
+const char *ILI9486_model(size_t index) {
+  if (index >= sizeof(panels) / sizeof(panels[0])) {
+    return NULL;
+  }
+  return panels[index].name;
+}
+
+// create connection to LCD
+ILI9486_type *ILI9486_create(const ILI9486_config_type *config, bool warm) {
+
+  const panel_type *panel = &panels[0];
+  if (config->model != NULL) {
+    panel = NULL;
+    for (size_t i = 0; i < sizeof(panels) / sizeof(panels[0]); ++i) {
+      if (strcmp(config->model, panels[i].name) == 0) {
+        panel = &panels[i];
+      }
+    }
+    if (panel == NULL) {
+      warnx("unknown panel model: %s", config->model);
+      return NULL;
+    }
+  }
+
+  // without MISO the panel state cannot be checked, so reset it
+  if (warm && !panel->readable) {
+    warnx("panel model: %s cannot be read back, warm start ignored",
+          panel->name);
+    warm = false;
+  }
+
+  if ((unsigned)config->rs_pin >= 64 || (unsigned)config->reset_pin >= 64) {
+    warnx("invalid panel pins: rs: %d  reset: %d", config->rs_pin,
+          config->reset_pin);
+    return NULL;
+  }
+
+  ILI9486_type *lcd = calloc(1, sizeof(ILI9486_type));
+  if (lcd == NULL) {
+    warn("failed to allocate panel structure");
+    return NULL;
+  }
+  lcd->panel = panel;
+  lcd->kernels = panel->rgb565 ? &rgb565_kernels : &rgb666_kernels;
+  lcd->width = panel->width;
+  lcd->height = panel->height;
+  lcd->stride = panel->width;
+  lcd->rs = config->rs_pin;
+  lcd->reset = config->reset_pin;
+  lcd->bps = spi_bps;
+  strlcpy(lcd->spi_device, config->spi_device, sizeof(lcd->spi_device));
+  lcd->spi_address = config->spi_address;
+  lcd->state_file = config->state_file;
+  load_state(lcd);
+
+  // Memory Access Control value
+  lcd->mac = (panel->bgr ? MAC_BGR_ORDER : 0) |
+             (panel->swap_xy ? MAC_ROW_COLUMN_EXCHANGE : 0);
+  switch (config->rotate) {
+  case ILI9486_ROTATION_0:
+    lcd->mac |= MAC_ROTATE_180;
+    break;
+
+  case ILI9486_ROTATION_180:
+  default:
+    break;
+  }
+
+  // allocate and clear the framebuffer
+  lcd->framebuffer =
+      calloc((size_t)lcd->width * lcd->height, lcd->kernels->bytes);
+  if (lcd->framebuffer == NULL) {
+    warn("allocate framebuffer failed");
+    free(lcd);
+    return NULL;
+  }
+  lcd->owner = true;
+
+  if (config->transport != NULL) {
+    lcd->bus = *config->transport;
+    bus_speed(lcd, lcd->bps);
+  } else {
+    lcd->bus = (ILI9486_transport_type){
+        .context = lcd,
+        .select = hardware_select,
+        .send = hardware_send,
+        .read = hardware_read,
+        .speed = hardware_speed,
+    };
+
+    // GPIO
+    if (!GPIO_setup(config->gpio_device)) {
+      warnx("gpio setup failed");
+      free(lcd->framebuffer);
+      free(lcd);
+      return NULL;
+    }
+    lcd->gpio = true;
+
+    // SPI
+    lcd->spi = SPI_create(config->spi_device, config->spi_address, lcd->bps,
+                          SPI_MODE_0);
+    if (NULL == lcd->spi) {
+      warnx("spi create failed");
+      ILI9486_destroy(lcd);
+      return NULL;
+    }
+
+    // GPIO configuration
+    GPIO_mode(lcd->rs, GPIO_OUTPUT);
+    GPIO_mode(lcd->reset, GPIO_OUTPUT);
+  }
+
+  // flush in the background
+  if (config->threaded) {
+    if (pthread_mutex_init(&lcd->lock, NULL) != 0 ||
+        pthread_cond_init(&lcd->changed, NULL) != 0 ||
+        pthread_create(&lcd->thread, NULL, flush_thread, lcd) != 0) {
+      warnx("cannot start flush thread");
+      ILI9486_destroy(lcd);
+      return NULL;
+    }
+    lcd->threaded = true;
+  }
+
+  if (warm) {
+    if (lcd->gpio) {
+      GPIO_write(lcd->reset, 1); // reset = inactive
+    }
+    if (panel_configured(lcd)) {
+      return lcd;
+    }
+  }
+
+  // reset the chip
+  if (lcd->gpio) {
+    uint64_t reset = (uint64_t)1 << lcd->reset;
+    uint64_t rs = (uint64_t)1 << lcd->rs;
+    GPIO_write_mask(reset | rs, reset); // reset = inactive, RS = command
+    delay_ms(1);                        // minimum delay
+    GPIO_write(lcd->reset, 0); // reset = active
+    delay_ms(10);              // reset pulse width = 10ms
+    GPIO_write(lcd->reset, 1); // reset = inactive
+    delay_ms(120);             // need 120 ms delay for chip to reset
+  }
+
+  for (size_t i = 0; i < panel->init_length; ++i) {
+    const command_type *c = &panel->init[i];
+    command(lcd, c->cmd, c->data, c->length);
+    delay_ms(c->delay_ms);
+  }
+
+  SEND(lcd, 0x3a, pixel_format(panel)); // Interface Pixel Format
+  SEND(lcd, 0x36, lcd->mac);            // Memory Access Control
+
+  if (panel->invert) {
+    SEND(lcd, 0x21); // Display Inversion ON
+  } else {
+    SEND(lcd, 0x20); // Display Inversion OFF
+  }
+
+  SEND(lcd, 0x11); // Sleep OUT
+  delay_ms(120);
+  SEND(lcd, 0x29); // Display ON
+  SEND(lcd, 0x38); // Idle Mode OFF
+  SEND(lcd, 0x13); // Normal Display Mode ON
+
+  return lcd;
+}
+
+// combine panels into one canvas
+ILI9486_type *ILI9486_tile(ILI9486_type **panels, size_t count,
+                           int columns) {
+
+  if (count == 0 || count > ILI9486_MAX_TILES || columns <= 0) {
+    warnx("invalid tiling: %zu panels in %d columns", count, columns);
+    return NULL;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (panels[i]->tile_count != 0 || panels[i]->width != panels[0]->width ||
+        panels[i]->height != panels[0]->height ||
+        panels[i]->kernels != panels[0]->kernels) {
+      warnx("tiled panels must be single panels of the same size and format");
+      return NULL;
+    }
+  }
+
+  ILI9486_type *canvas = calloc(1, sizeof(ILI9486_type));
+  if (canvas == NULL) {
+    warn("failed to allocate canvas structure");
+    return NULL;
+  }
+
+  int rows = (count + columns - 1) / columns;
+  canvas->kernels = panels[0]->kernels;
+  canvas->width = columns * panels[0]->width;
+  canvas->height = rows * panels[0]->height;
+  canvas->stride = canvas->width;
+  canvas->framebuffer =
+      calloc((size_t)canvas->width * canvas->height, canvas->kernels->bytes);
+  if (canvas->framebuffer == NULL) {
+    warn("allocate canvas framebuffer failed");
+    free(canvas);
+    return NULL;
+  }
+  canvas->owner = true;
+
+  // each panel shows its part of the canvas, left to right then down
+  for (size_t i = 0; i < count; ++i) {
+    ILI9486_type *lcd = panels[i];
+    int x = (i % columns) * lcd->width;
+    int y = (i / columns) * lcd->height;
+
+    // stop the flush thread using the old framebuffer
+    ILI9486_wait(lcd);
+    if (lcd->owner) {
+      free(lcd->framebuffer);
+    }
+    lcd->framebuffer = pixel(canvas, x, y);
+    lcd->owner = false;
+    lcd->stride = canvas->stride;
+
+    canvas->tile[i] = lcd;
+    canvas->tile_area[i] = (rect_type){
+        .x = x, .y = y, .width = lcd->width, .height = lcd->height};
+  }
+  canvas->tile_count = count;
+
+  return canvas;
+}
+
+// fix the priority and CPU of a flush thread
+static bool realtime_thread(pthread_t thread, int priority, int cpu) {
+
+  bool ok = true;
+
+  if (priority >= 0) {
+    struct sched_param param = {.sched_priority = priority};
+    int rc = pthread_setschedparam(thread, SCHED_FIFO, &param);
+    if (rc != 0) {
+      warnx("cannot set real-time priority %d: %s", priority, strerror(rc));
+      ok = false;
+    }
+  }
+
+  if (cpu >= 0) {
+    cpuset_t *set = cpuset_create();
+    if (set == NULL) {
+      warn("cannot create cpu set");
+      return false;
+    }
+    cpuset_zero(set);
+    int rc = EINVAL;
+    if (cpuset_set((cpuid_t)cpu, set) == 0) {
+      rc = pthread_setaffinity_np(thread, cpuset_size(set), set);
+    }
+    cpuset_destroy(set);
+    if (rc != 0) {
+      warnx("cannot pin flush thread to cpu %d: %s", cpu, strerror(rc));
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+// run the flush threads at a real-time priority on one CPU
+bool ILI9486_realtime(ILI9486_type *lcd, int priority, int cpu) {
+
+  bool ok = true;
+
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    if (!ILI9486_realtime(lcd->tile[i], priority, cpu)) {
+      ok = false;
+    }
+  }
+
+  if (lcd->threaded && !realtime_thread(lcd->thread, priority, cpu)) {
+    ok = false;
+  }
+
+  return ok;
+}
+
+// bus traffic of a panel, or of all panels of a canvas
+void ILI9486_counters(ILI9486_type *lcd, ILI9486_counters_type *counters) {
+  ILI9486_wait(lcd);
+  *counters = (ILI9486_counters_type){
+      .bytes = lcd->bytes,
+      .transfers = lcd->transfers,
+  };
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    ILI9486_counters_type c;
+    ILI9486_counters(lcd->tile[i], &c);
+    counters->bytes += c.bytes;
+    counters->transfers += c.transfers;
+  }
+}
+
+// SPI clock, the panels of a canvas share the bus
+uint32_t ILI9486_bps(ILI9486_type *lcd) {
+  return (lcd->tile_count > 0) ? lcd->tile[0]->bps : lcd->bps;
+}
+
+// disconnect LCD and release resources
+bool ILI9486_destroy(ILI9486_type *lcd) {
+
+  if (lcd == NULL) {
+    return false;
+  }
+
+  bool ok = true;
+
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    if (!ILI9486_destroy(lcd->tile[i])) {
+      ok = false;
+    }
+  }
+
+  if (lcd->threaded) {
+    pthread_mutex_lock(&lcd->lock);
+    lcd->stop = true;
+    pthread_cond_broadcast(&lcd->changed);
+    pthread_mutex_unlock(&lcd->lock);
+    pthread_join(lcd->thread, NULL);
+    pthread_cond_destroy(&lcd->changed);
+    pthread_mutex_destroy(&lcd->lock);
+  }
+
+  if (lcd->gpio) {
+    GPIO_write(lcd->reset, 0); // reset = active
+  }
+
+  if (lcd->spi != NULL && !SPI_destroy(lcd->spi)) {
+    warn("spi destroy failed");
+    ok = false;
+  }
+
+  if (lcd->gpio && !GPIO_teardown()) {
+    warn("gpio teardown failed");
+    ok = false;
+  }
+
+  if (lcd->owner) {
+    free(lcd->framebuffer);
+  }
+  free(lcd->layer);
+  free(lcd);
+
+  return ok;
+}
+
+// display size in pixels
+int ILI9486_width(ILI9486_type *lcd) {
+  return lcd->width;
+}
+
+int ILI9486_height(ILI9486_type *lcd) {
+  return lcd->height;
+}
+
+// pixel format of the internal buffer
+ILI9486_format_type ILI9486_format(ILI9486_type *lcd) {
+  return lcd->kernels->format;
+}
+
+// mark a rectangle of the internal buffer as changed
+void ILI9486_damage(ILI9486_type *lcd, int x, int y, int width, int height,
+                    ILI9486_priority_type priority) {
+
+  if ((unsigned)priority >= ILI9486_PRIORITIES) {
+    priority = ILI9486_PRIORITY_LOW;
+  }
 
-// Memory Access Control register bits
-#define MAC_HORIZONTAL_REFRESH_ORDER (1 << 2)
-#define MAC_BGR_ORDER (1 << 3)
-#define MAC_VERTICAL_REFRESH_ORDER (1 << 4)
-#define MAC_ROW_COLUMN_EXCHANGE (1 << 5)
-#define MAC_COLUMN_ADDRESS_ORDER (1 << 6)
-#define MAC_ROW_ADDRESS_ORDER (1 << 7)
+  // each panel of a canvas keeps its own part
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    const rect_type *t = &lcd->tile_area[i];
+    rect_type r = {.x = x, .y = y, .width = width, .height = height};
+    if (clip_rect(&r, t)) {
+      ILI9486_damage(lcd->tile[i], r.x - t->x, r.y - t->y, r.width, r.height,
+                     priority);
+    }
+  }
+  if (lcd->panel == NULL) {
+    return; // canvas
+  }
 
-#define MAC_ROTATE_180 (MAC_COLUMN_ADDRESS_ORDER | MAC_ROW_ADDRESS_ORDER)
+  rect_type screen = {.width = lcd->width, .height = lcd->height};
+  rect_type r = {.x = x, .y = y, .width = width, .height = height};
+  if (clip_rect(&r, &screen)) {
+    add_damage(lcd, r, priority);
+  }
+}
 
-// if 16 bit SPI format, add a padding zero byte
-#if DISPLAY_SPI_16BIT
-#define SPX(b) 0x00, (b)
-#else
-#define SPX(b) (b)
-#endif
+// send the changed areas to the LCD, highest priority first
+bool ILI9486_sync(ILI9486_type *lcd, unsigned int deadline) {
 
-// SPI clock frequency
-static const int spi_bps = 30000000;
+  // bytes the bus moves by the deadline, panels of a canvas share the
+  // bus so each gets an equal part
+  uint32_t bps = ILI9486_bps(lcd);
+  size_t budget = (uint64_t)deadline * (bps / 8) / 1000000;
+  if (deadline > 0 && budget == 0) {
+    budget = 1; // nothing but high priority fits
+  }
+  if (lcd->tile_count > 0) {
+    budget = (budget + lcd->tile_count - 1) / lcd->tile_count;
+  }
 
-// GPIO settings
-static const int tp_intr = 17;
-static const int lcd_rs = 24;
-static const int rst = 25;
+  bool done = true;
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    ILI9486_wait(lcd->tile[i]);
+    done = schedule(lcd->tile[i], budget) && done;
+    start(lcd->tile[i]);
+  }
+  if (lcd->panel != NULL) {
+    ILI9486_wait(lcd);
+    done = schedule(lcd, budget);
+    start(lcd);
+  }
 
-static const int lcd_pixel_width = 480;
-static const int lcd_pixel_height = 320;
-static const int nl =
-    lcd_pixel_width / 8 - 1; // pixels → bytes (number of lines)
+  ILI9486_wait(lcd);
+  return done;
+}
 
-// framebuffer byte layout must match the ili9486 mapping order
-typedef struct __attribute__((packed, aligned(1))) {
-  uint8_t red;
-  uint8_t green;
-  uint8_t blue;
-} rgb_type;
+static bool earlier(const struct timespec *a, const struct timespec *b) {
+  return a->tv_sec < b->tv_sec ||
+         (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
 
-static rgb_type *framebuffer = NULL;
-static const size_t framebuffer_pixels = lcd_pixel_width * lcd_pixel_height;
+// when the high priority areas of the last sync were sent
+bool ILI9486_timing(ILI9486_type *lcd, ILI9486_timing_type *timing) {
 
-static SPI_type *spi = NULL;
+  bool timed = false;
 
-// send setup commands over SPI
-#define SEND(spi, cmd, ...)                                                    \
-  do {                                                                         \
-    const uint8_t _cmd[] = {0x00, cmd};                                        \
-    const uint8_t _data[] = {__VA_ARGS__};                                     \
-    GPIO_write(lcd_rs, 0);                                                     \
-    SPI_send((spi), _cmd, sizeof(_cmd));                                       \
-    GPIO_write(lcd_rs, 1);                                                     \
-    if (sizeof(_data) > 0) {                                                   \
-      SPI_send((spi), _data, sizeof(_data));                                   \
-    }                                                                          \
-  } while (0)
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    ILI9486_timing_type t;
+    if (!ILI9486_timing(lcd->tile[i], &t)) {
+      continue;
+    }
+    if (!timed || earlier(&t.first, &timing->first)) {
+      timing->first = t.first;
+    }
+    if (!timed || earlier(&timing->last, &t.last)) {
+      timing->last = t.last;
+    }
+    timed = true;
+  }
 
-// send data commands over SPI
-#define DATA(spi, cmd, data)                                                   \
-  do {                                                                         \
-    const uint8_t _cmd[] = {0x00, cmd};                                        \
-    GPIO_write(lcd_rs, 0);                                                     \
-    SPI_send((spi), _cmd, sizeof(_cmd));                                       \
-    GPIO_write(lcd_rs, 1);                                                     \
-    SPI_send((spi), data, sizeof(data));                                       \
-  } while (0)
+  if (lcd->panel != NULL && lcd->timed) {
+    timing->first = lcd->sent_first;
+    timing->last = lcd->sent_last;
+    timed = true;
+  }
 
-#define DATA_S(spi, cmd, data, size)                                           \
-  do {                                                                         \
-    const uint8_t _cmd[] = {0x00, cmd};                                        \
-    GPIO_write(lcd_rs, 0);                                                     \
-    SPI_send((spi), _cmd, sizeof(_cmd));                                       \
-    GPIO_write(lcd_rs, 1);                                                     \
-    SPI_send((spi), data, size);                                               \
-  } while (0)
+  return timed;
+}
 
-// if bus is 16 bit need to prefix with a zero byte
-#if DISPLAY_SPI_16BIT
-#define CVT(b) 0x00, (b)
-#else
-#define CVT(b) (b)
-#endif
+// start sending the whole internal buffer to the LCD
+void ILI9486_flush(ILI9486_type *lcd) {
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    ILI9486_flush(lcd->tile[i]);
+  }
+  if (lcd->panel == NULL) {
+    return; // canvas
+  }
 
-static void delay_ms(int ms) {
-  if (ms > 0) {
-    usleep(1000 * ms);
+  // everything is sent so no damage is left
+  ILI9486_wait(lcd);
+  memset(lcd->damage_count, 0, sizeof(lcd->damage_count));
+  lcd->job[0] = (rect_type){.width = lcd->width, .height = lcd->height};
+  lcd->job_count = 1;
+  lcd->job_high = 0;
+  start(lcd);
+}
+
+// wait for any flush to finish
+void ILI9486_wait(ILI9486_type *lcd) {
+  for (size_t i = 0; i < lcd->tile_count; ++i) {
+    ILI9486_wait(lcd->tile[i]);
+  }
+  if (!lcd->threaded) {
+    return;
   }
+  pthread_mutex_lock(&lcd->lock);
+  while (lcd->pending) {
+    pthread_cond_wait(&lcd->changed, &lcd->lock);
+  }
+  pthread_mutex_unlock(&lcd->lock);
 }
 
-// create connection to LCD
-bool ILI9486_create(ILI9486_rotation_type rotate) {
+// sync whole internal buffer to the LCD
+void ILI9486_refresh(ILI9486_type *lcd) {
+  ILI9486_flush(lcd);
+  ILI9486_wait(lcd);
+}
 
-  // Memory Access Control value
-  static uint8_t mac = (0
-#if DISPLAY_BGR
-                        | MAC_BGR_ORDER
-#endif
-#if DISPLAY_SWAP_XY
-                        | MAC_ROW_COLUMN_EXCHANGE
-#endif
-  );
-  switch (rotate) {
-  case ILI9486_ROTATION_0:
-    mac |= MAC_ROTATE_180;
-    break;
+// calibration
+// ===========
 
-  case ILI9486_ROTATION_180:
-  default:
-    break;
+// SPI clocks to try, the Pi divides a 250 MHz core clock by an even
+// number so only these are distinct
+static const uint32_t calibration_bps[] = {
+    15625000, 20833333, 25000000, 31250000, 41666666, 62500000, 125000000,
+};
+
+// transfer sizes to try at the fastest clock, 0 is one per row
+static const size_t calibration_chunk[] = {0, 4096, 16384, 65536};
+
+// fill the framebuffer with a test pattern: a gradient, alternating
+// black and white pixels for the most bit changes, and noise
+static void pattern(ILI9486_type *lcd, int kind) {
+  uint32_t random = 2463534242;
+  for (int y = 0; y < lcd->height; ++y) {
+    uint8_t *p = pixel(lcd, 0, y);
+    for (int x = 0; x < lcd->width; ++x) {
+      ILI9486_colour_type c;
+      switch (kind) {
+      case 0:
+        c = (ILI9486_colour_type){.red = x, .green = y, .blue = x ^ y};
+        break;
+      case 1: {
+        uint8_t v = ((x + y) & 1) ? 0xff : 0x00;
+        c = (ILI9486_colour_type){.red = v, .green = ~v, .blue = v};
+        break;
+      }
+      default:
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        c = (ILI9486_colour_type){
+            .red = random, .green = random >> 8, .blue = random >> 16};
+        break;
+      }
+      lcd->kernels->fill(p, 1, c);
+      p += lcd->kernels->bytes;
+    }
   }
+}
 
-  // allocate and clear the framebuffer
-  if (framebuffer == NULL) {
-    framebuffer = (rgb_type *)calloc(framebuffer_pixels, sizeof(rgb_type));
-    if (framebuffer == NULL) {
-      err(EXIT_FAILURE, "allocate framebuffer failed");
-      goto fail;
+// read a row back from the panel memory and compare it with the
+// framebuffer, the panel returns 3 bytes per pixel after a dummy; as
+// with read_register the command is part of the read transfer
+static bool verify_row(ILI9486_type *lcd, int y, uint8_t *buffer,
+                       size_t length) {
+  size_t spx = lcd->panel->bus16 ? 2 : 1;
+  uint8_t *received = buffer + length;
+
+  SEND(lcd, 0x2a, 0, 0, (lcd->width - 1) >> 8, (lcd->width - 1) & 0xff);
+  SEND(lcd, 0x2b, (uint8_t)(y >> 8), (uint8_t)(y & 0xff), y >> 8, y & 0xff);
+  memset(buffer, 0, length);
+  buffer[spx - 1] = 0x2e; // Memory Read
+  bus_select(lcd, false);
+  bus_read(lcd, buffer, received, length);
+
+  const uint8_t *mask = lcd->kernels->precision;
+  for (int x = 0; x < lcd->width; ++x) {
+    uint8_t expected[3];
+    lcd->kernels->load(pixel(lcd, x, y), expected);
+    for (int i = 0; i < 3; ++i) {
+      uint8_t actual = received[(3 + 3 * x + i) * spx - 1];
+      if (((actual ^ expected[i]) & mask[i]) != 0) {
+        return false;
+      }
     }
   }
+  return true;
+}
 
-  // GPIO
-  if (!GPIO_setup(GPIO_DEVICE)) {
-    err(EXIT_FAILURE, "gpio setup failed");
-    goto fail;
+// send every pattern with the current settings and read them back
+static bool verify(ILI9486_type *lcd) {
+  size_t spx = lcd->panel->bus16 ? 2 : 1;
+  size_t length = (2 + 3 * (size_t)lcd->width) * spx;
+  uint8_t *buffer = malloc(2 * length);
+  if (buffer == NULL) {
+    warn("cannot allocate calibration buffer");
+    return false;
   }
 
-  // SPI
-  spi = SPI_create(SPI_DEVICE, SPI_ADDR_0, spi_bps, SPI_MODE_0);
-  if (NULL == spi) {
-    err(EXIT_FAILURE, "spi create failed");
-    goto fail;
+  bool ok = true;
+  for (int kind = 0; ok && kind < 3; ++kind) {
+    pattern(lcd, kind);
+    if (!bus_speed(lcd, lcd->bps)) {
+      ok = false;
+      break;
+    }
+    ILI9486_refresh(lcd);
+
+    // every row, an error at a chunk boundary can be anywhere; about
+    // two seconds a pattern at the read clock
+    bus_speed(lcd, read_bps);
+    for (int y = 0; ok && y < lcd->height; ++y) {
+      ok = verify_row(lcd, y, buffer, length);
+    }
   }
 
-  // GPIO configuration
-  GPIO_mode(tp_intr, GPIO_INPUT);
-  GPIO_mode(lcd_rs, GPIO_OUTPUT);
-  GPIO_mode(rst, GPIO_OUTPUT);
+  free(buffer);
+  bus_speed(lcd, lcd->bps);
+  return ok;
+}
 
-  // return a value (0/1) for a given input pin
-  // int GPIO_read(tp_intr);
+// find the fastest settings that the panel reliably accepts
+bool ILI9486_calibrate(ILI9486_type *lcd, ILI9486_tuning_type *tuning) {
 
-  // reset the ili9486 chip
-  GPIO_write(rst, 1); // reset = inactive
-  delay_ms(1);        // minimum delay
-  GPIO_write(rst, 0); // reset = active
-  delay_ms(10);       // reset pulse width = 10ms
-  GPIO_write(rst, 1); // reset = inactive
-  delay_ms(120);      // need 120 ms delay for chip to reset
+  if (lcd->panel == NULL) {
+    warnx("only single panels can be calibrated");
+    return false;
+  }
 
-  GPIO_write(lcd_rs, 0);
+  if (!lcd->panel->readable) {
+    warnx("panel model: %s cannot be read back, calibration needs MISO",
+          lcd->panel->name);
+    return false;
+  }
 
-  SEND(spi, 0xb0, 0x00, 0x00); // SPI should be set by hardware reset
+  // the panel must answer reads at all
+  uint8_t id[3];
+  read_register(lcd, 0x04, id, sizeof(id));
+  if ((id[0] == 0x00 && id[1] == 0x00 && id[2] == 0x00) ||
+      (id[0] == 0xff && id[1] == 0xff && id[2] == 0xff)) {
+    warnx("panel cannot be read back, calibration needs MISO connected");
+    return false;
+  }
 
-  SEND(spi, 0x11); // Sleep OUT
-  delay_ms(120);
+  // the clock first, with a transfer per row as before tuning
+  uint32_t best_bps = 0;
+  lcd->chunk = 0;
+  for (size_t i = 0; i < sizeof(calibration_bps) / sizeof(uint32_t); ++i) {
+    lcd->bps = calibration_bps[i];
+    if (!verify(lcd)) {
+      break;
+    }
+    best_bps = lcd->bps;
+  }
+  if (best_bps == 0) {
+    warnx("panel fails at the slowest clock: %u Hz",
+          (unsigned int)calibration_bps[0]);
+    lcd->bps = spi_bps;
+    bus_speed(lcd, lcd->bps);
+    return false;
+  }
 
-#if DISPLAY_18BIT
-  SEND(spi, 0x3a, SPX(0x66)); // 18 bit pixel
-#else
-  SEND(spi, 0x3a, SPX(0x55)); // 16 bit pixel
-#endif
+  // then the largest transfer at that clock
+  lcd->bps = best_bps;
+  size_t best_chunk = 0;
+  for (size_t i = 1; i < sizeof(calibration_chunk) / sizeof(size_t); ++i) {
+    lcd->chunk = calibration_chunk[i];
+    if (!verify(lcd)) {
+      break;
+    }
+    best_chunk = lcd->chunk;
+  }
+  lcd->chunk = best_chunk;
+  bus_speed(lcd, lcd->bps);
 
-  SEND(spi, 0xb4, SPX(0x00)); // Display Inversion Control
+  tuning->bps = lcd->bps;
+  tuning->chunk = lcd->chunk;
+  return save_state(lcd);
+}
 
-#if DISPLAY_INVERTED
-  SEND(spi, 0x21); // Display Inversion ON
-#else
-  SEND(spi, 0x20);            // Display Inversion OFF
-#endif
+// fill an area already clipped to the screen, the first row by the
+// kernel and the rest as copies of it
+static void fill_area(ILI9486_type *lcd, const rect_type *r,
+                      ILI9486_colour_type colour) {
+  uint8_t *first = pixel(lcd, r->x, r->y);
+  size_t bytes = (size_t)r->width * lcd->kernels->bytes;
+  lcd->kernels->fill(first, r->width, colour);
+  for (int h = 1; h < r->height; ++h) {
+    memcpy(pixel(lcd, r->x, r->y + h), first, bytes);
+  }
+}
 
-  SEND(spi, 0xc0, SPX(0x09), SPX(0x09)); // Power Control 1
-  SEND(spi, 0xc1, SPX(0x41), SPX(0x00)); // Power Control 2
-  SEND(spi, 0xc2, SPX(0x33));            // Power Control 3
-  SEND(spi, 0xc5, SPX(0x00), SPX(0x36)); // VCOM Control 1
-  SEND(spi, 0x36, SPX(mac));             // Memory Access Control
+// clip a rectangle to the screen
+// returns false if nothing is left, truncated if anything was removed
+static bool clip_screen(const ILI9486_type *lcd, rect_type *r,
+                        bool *truncated) {
+  rect_type screen = {.width = lcd->width, .height = lcd->height};
+  int width = r->width;
+  int height = r->height;
+  if (width <= 0 || height <= 0 || !clip_rect(r, &screen)) {
+    *truncated = true;
+    return false;
+  }
+  *truncated = r->width != width || r->height != height;
+  return true;
+}
 
-  // Positive Gamma Control
-  SEND(spi, 0xe0, SPX(0x00), SPX(0x2c), SPX(0x2c), SPX(0x0b), SPX(0x0c),
-       SPX(0x04), SPX(0x4C), SPX(0x64), SPX(0x36), SPX(0x03), SPX(0x0e),
-       SPX(0x01), SPX(0x10), SPX(0x01), SPX(0x00));
+// clear the internal buffer to a colour
+void ILI9486_clear(ILI9486_type *lcd, uint8_t red, uint8_t green,
+                   uint8_t blue) {
+  ILI9486_colour_type colour = {.red = red, .green = green, .blue = blue};
+  rect_type r = {.width = lcd->width, .height = lcd->height};
+  fill_area(lcd, &r, colour);
+}
 
-  // Negative Gamma Control
-  SEND(spi, 0xe1, SPX(0x0f), SPX(0x37), SPX(0x37), SPX(0x0c), SPX(0x0f),
-       SPX(0x05), SPX(0x50), SPX(0x32), SPX(0x36), SPX(0x04), SPX(0x0b),
-       SPX(0x00), SPX(0x19), SPX(0x14), SPX(0x0f));
+// fill a rectangle of the internal buffer with a colour
+//
+// returns truncation occurred
+bool ILI9486_fill(ILI9486_type *lcd, int x, int y, int width, int height,
+                  ILI9486_colour_type colour) {
 
-  // Display Function Control
-  SEND(spi, 0xb6, SPX(0x00), SPX(0x02), SPX((uint8_t)(nl)));
+  bool truncated = false;
 
-  SEND(spi, 0x11); // Sleep OUT
-  delay_ms(120);
-  SEND(spi, 0x29); // Display ON
-  SEND(spi, 0x38); // Idle Mode OFF
-  SEND(spi, 0x13); // Normal Display Mode ON
+  if (x < 0) {
+    width += x;
+    x = 0;
+    truncated = true;
+  }
+  if (y < 0) {
+    height += y;
+    y = 0;
+    truncated = true;
+  }
+  if (x + width > lcd->width) {
+    width = lcd->width - x;
+    truncated = true;
+  }
+  if (y + height > lcd->height) {
+    height = lcd->height - y;
+    truncated = true;
+  }
 
-  return true;
+  if (width > 0 && height > 0) {
+    rect_type r = {.x = x, .y = y, .width = width, .height = height};
+    fill_area(lcd, &r, colour);
+  }
 
-fail:
-  ILI9486_destroy();
-  return false;
+  return truncated;
 }
 
-// disconnect LCD and release resources
-bool ILI9486_destroy(void) {
+// background layer
+// ================
+//
+// a copy of the framebuffer taken once a background has been drawn,
+// parts of it are copied back before drawing over them so a gradient or
+// picture costs no more per frame than a flat colour
 
-  bool ok = true;
+// keep the internal buffer as the background layer
+bool ILI9486_capture(ILI9486_type *lcd) {
+  size_t bytes = (size_t)lcd->width * lcd->kernels->bytes;
+  if (lcd->layer == NULL) {
+    lcd->layer =
+        malloc(((size_t)lcd->stride * (lcd->height - 1) + lcd->width) *
+               lcd->kernels->bytes);
+    if (lcd->layer == NULL) {
+      warn("cannot allocate background layer");
+      return false;
+    }
+  }
+  for (int y = 0; y < lcd->height; ++y) {
+    size_t offset = pixel(lcd, 0, y) - lcd->framebuffer;
+    memcpy(lcd->layer + offset, lcd->framebuffer + offset, bytes);
+  }
+  return true;
+}
 
-  GPIO_write(rst, 0); // reset = active
+// copy a rectangle of the background layer to the internal buffer
+bool ILI9486_restore(ILI9486_type *lcd, int x, int y, int width,
+                     int height) {
 
-  if (framebuffer != NULL) {
-    free(framebuffer);
-    framebuffer = NULL;
+  bool truncated;
+  rect_type r = {.x = x, .y = y, .width = width, .height = height};
+  if (lcd->layer == NULL || !clip_screen(lcd, &r, &truncated)) {
+    return true;
   }
 
-  if (!SPI_destroy(spi)) {
-    warn("spi destroy failed");
-    ok = false;
+  size_t bytes = (size_t)r.width * lcd->kernels->bytes;
+  for (int h = 0; h < r.height; ++h) {
+    size_t offset = pixel(lcd, r.x, r.y + h) - lcd->framebuffer;
+    memcpy(lcd->framebuffer + offset, lcd->layer + offset, bytes);
   }
-  spi = NULL;
+  return truncated;
+}
 
-  if (!GPIO_teardown()) {
-    warn("gpio teardown failed");
-    ok = false;
+// fill a rectangle with a colour and mark it changed
+bool ILI9486_fill_rect(ILI9486_type *lcd, int x, int y, int width,
+                       int height, ILI9486_colour_type colour,
+                       ILI9486_priority_type priority) {
+
+  bool truncated;
+  rect_type r = {.x = x, .y = y, .width = width, .height = height};
+  if (!clip_screen(lcd, &r, &truncated)) {
+    return truncated;
   }
-  return ok;
-}
 
-// sync any changes in the internal buffer to the LCD
-// updated largest marked area and zeros the mark
-void ILI9486_sync(void) {
-  // TO DO: just do a full refresh for now
-  ILI9486_refresh();
+  fill_area(lcd, &r, colour);
+  ILI9486_damage(lcd, r.x, r.y, r.width, r.height, priority);
+  return truncated;
 }
 
-// sync whole internal buffer to the LCD
-void ILI9486_refresh(void) {
-  if (framebuffer == NULL) {
-    return;
+// copy a rectangle to to_x, to_y, setting the destination it covered
+// returns truncation occurred
+static bool copy_area(ILI9486_type *lcd, int x, int y, int width,
+                      int height, int to_x, int to_y, rect_type *to) {
+
+  // clip the source, then the destination, keeping them the same size
+  bool source_truncated;
+  bool truncated;
+  rect_type r = {.x = x, .y = y, .width = width, .height = height};
+  *to = (rect_type){0};
+  if (!clip_screen(lcd, &r, &source_truncated)) {
+    return true;
+  }
+  const int dx = to_x - x;
+  const int dy = to_y - y;
+  r.x += dx;
+  r.y += dy;
+  if (!clip_screen(lcd, &r, &truncated)) {
+    return true;
   }
-  for (int y = 0; y < lcd_pixel_height; ++y) {
-    SEND(spi, 0x2a, 0, 0, 0, 0, 0, (lcd_pixel_width - 1) >> 8, 0,
-         (lcd_pixel_width - 1) & 0xff);
-    SEND(spi, 0x2b, 0, (uint8_t)(y >> 8), 0, (uint8_t)(y & 0xff), 0,
-         (lcd_pixel_height - 1) >> 8, 0, (lcd_pixel_height - 1) & 0xff);
-    rgb_type *p = &framebuffer[y * lcd_pixel_width];
-    DATA_S(spi, 0x2c, (uint8_t *)p, lcd_pixel_width * sizeof(rgb_type));
+
+  // a row moved down must be copied before the row above overwrites
+  // it, memmove handles rows that overlap themselves
+  const size_t bytes = (size_t)r.width * lcd->kernels->bytes;
+  for (int n = 0; n < r.height; ++n) {
+    int h = dy > 0 ? r.height - 1 - n : n;
+    memmove(pixel(lcd, r.x, r.y + h), pixel(lcd, r.x - dx, r.y + h - dy),
+            bytes);
   }
+
+  *to = r;
+  return source_truncated || truncated;
 }
 
-// clear the internal buffer to a colour
-// marks whole buffer as changed so either sync or refresh can be used
-void ILI9486_clear(uint8_t red, uint8_t green, uint8_t blue) {
-  if (framebuffer == NULL) {
-    return;
+// copy a rectangle of the internal buffer, the source and destination
+// may overlap, and mark the destination changed
+bool ILI9486_copy_rect(ILI9486_type *lcd, int x, int y, int width,
+                       int height, int to_x, int to_y,
+                       ILI9486_priority_type priority) {
+  rect_type to;
+  bool truncated = copy_area(lcd, x, y, width, height, to_x, to_y, &to);
+  if (to.width > 0) {
+    ILI9486_damage(lcd, to.x, to.y, to.width, to.height, priority);
   }
-  for (size_t n = 0; n < framebuffer_pixels; ++n) {
-    framebuffer[n].red = red;
-    framebuffer[n].green = green;
-    framebuffer[n].blue = blue;
+  return truncated;
+}
+
+// move the pixels of a rectangle sideways and mark it changed
+bool ILI9486_scroll(ILI9486_type *lcd, int x, int y, int width, int height,
+                    int dx, ILI9486_priority_type priority) {
+
+  if (dx <= -width || dx >= width) {
+    ILI9486_damage(lcd, x, y, width, height, priority);
+    return false; // nothing stays, all of it is exposed
   }
+
+  rect_type to;
+  bool truncated =
+      dx < 0 ? copy_area(lcd, x - dx, y, width + dx, height, x, y, &to)
+             : copy_area(lcd, x, y, width - dx, height, x + dx, y, &to);
+  ILI9486_damage(lcd, x, y, width, height, priority);
+  return truncated;
 }
 
 // send a rectangular bitmap to the internal buffer
-// and mark changed area
 //
 // returns truncation occurred
 bool ILI9486_rect_rgba(
+    ILI9486_type *lcd, // panel or canvas
     int x,             // X coordinate on LCD
     int y,             // Y coordinate on LCD
     int offset_x,      // X offset in bitmap
@@ -297,33 +1696,401 @@ bool ILI9486_rect_rgba(
 
   bool truncated = false;
 
-  if (x >= lcd_pixel_width || y >= lcd_pixel_height) {
+  if (x >= lcd->width || y >= lcd->height) {
     return true; // off the screen
   }
 
-  if (y + height > lcd_pixel_height) {
-    height = lcd_pixel_height - y;
+  if (y + height > lcd->height) {
+    height = lcd->height - y;
     truncated = true;
   }
 
-  if (x + width > lcd_pixel_width) {
-    width = lcd_pixel_width - x;
+  if (x + width > lcd->width) {
+    width = lcd->width - x;
     truncated = true;
   }
 
   // 4 byte pixels R/G/B/A
-  for (int h = offset_y; h < height; ++h) {
-    rgb_type *p = &framebuffer[y * lcd_pixel_width + x];
-    uint8_t *s = (uint8_t *)(buffer) + h * stride + (4 * offset_x);
-    for (int w = offset_x; w < width; ++w) {
-      p->blue = *s++;
-      p->green = *s++;
-      p->red = *s++;
-      ++s; // ignore alpha
-      ++p;
-    }
+  for (int h = offset_y; h < height && offset_x < width; ++h) {
+    const uint8_t *s = (const uint8_t *)(buffer) + h * stride + (4 * offset_x);
+    lcd->kernels->rgba(pixel(lcd, x, y), s, width - offset_x);
+    ++y;
+  }
+
+  return truncated;
+}
+
+// blend a rectangular coverage bitmap to the internal buffer as
+// foreground over background colour
+//
+// returns truncation occurred
+bool ILI9486_rect_alpha(
+    ILI9486_type *lcd,              // panel or canvas
+    int x,                          // X coordinate on LCD
+    int y,                          // Y coordinate on LCD
+    int offset_x,                   // X offset in bitmap
+    int offset_y,                   // Y offset in bitmap
+    int width,                      // bitmap width in pixels
+    int height,                     // bitmap height in pixels
+    size_t stride,                  // number of bytes in a bitmap row
+    const uint8_t *coverage,        // 8 bit coverage (1 byte/pixel)
+    ILI9486_colour_type foreground, // colour at full coverage
+    ILI9486_colour_type background  // colour at zero coverage
+) {
+
+  bool truncated = false;
+
+  if (x >= lcd->width || y >= lcd->height) {
+    return true; // off the screen
+  }
+
+  if (y + height - offset_y > lcd->height) {
+    height = lcd->height - y + offset_y;
+    truncated = true;
+  }
+
+  if (x + width - offset_x > lcd->width) {
+    width = lcd->width - x + offset_x;
+    truncated = true;
+  }
+
+  // clip anything left of or above the screen
+  if (x < 0) {
+    offset_x -= x;
+    x = 0;
+  }
+  if (y < 0) {
+    offset_y -= y;
+    y = 0;
+  }
+
+  for (int h = offset_y; h < height && offset_x < width; ++h) {
+    lcd->kernels->alpha(pixel(lcd, x, y), coverage + h * stride + offset_x,
+                        width - offset_x, foreground, background);
+    ++y;
+  }
+
+  return truncated;
+}
+
+// blend a foreground colour by a coverage bitmap over what the
+// internal buffer holds
+//
+// returns truncation occurred
+bool ILI9486_rect_over(ILI9486_type *lcd, int x, int y, int offset_x,
+                       int offset_y, int width, int height, size_t stride,
+                       const uint8_t *coverage,
+                       ILI9486_colour_type foreground) {
+
+  bool truncated = false;
+
+  if (x >= lcd->width || y >= lcd->height) {
+    return true; // off the screen
+  }
+
+  if (y + height - offset_y > lcd->height) {
+    height = lcd->height - y + offset_y;
+    truncated = true;
+  }
+
+  if (x + width - offset_x > lcd->width) {
+    width = lcd->width - x + offset_x;
+    truncated = true;
+  }
+
+  // clip anything left of or above the screen
+  if (x < 0) {
+    offset_x -= x;
+    x = 0;
+  }
+  if (y < 0) {
+    offset_y -= y;
+    y = 0;
+  }
+
+  for (int h = offset_y; h < height && offset_x < width; ++h) {
+    lcd->kernels->over(pixel(lcd, x, y), coverage + h * stride + offset_x,
+                       width - offset_x, foreground);
     ++y;
   }
 
   return truncated;
 }
+
+// draw a sprite already in the framebuffer format, blended by its
+// alpha plane or copied when it has none
+bool ILI9486_rect_sprite(ILI9486_type *lcd, int x, int y, int width,
+                         int height, const uint8_t *pixels,
+                         const uint8_t *alpha) {
+
+  bool truncated;
+  rect_type r = {.x = x, .y = y, .width = width, .height = height};
+  if (!clip_screen(lcd, &r, &truncated)) {
+    return truncated;
+  }
+
+  const size_t bytes = lcd->kernels->bytes;
+  for (int h = 0; h < r.height; ++h) {
+    size_t n = (size_t)(r.y - y + h) * width + (r.x - x);
+    if (alpha == NULL) {
+      memcpy(pixel(lcd, r.x, r.y + h), pixels + n * bytes, r.width * bytes);
+    } else {
+      lcd->kernels->sprite(pixel(lcd, r.x, r.y + h), pixels + n * bytes,
+                           alpha + n, r.width);
+    }
+  }
+
+  return truncated;
+}
+
+#if TESTING
+
+#include <assert.h>
+
+// a bus that sends nothing, only the internal buffer is checked
+static void test_select(void *context, bool data) {
+  (void)context;
+  (void)data;
+}
+
+static void test_send(void *context, const void *buffer, size_t length) {
+  (void)context;
+  (void)buffer;
+  (void)length;
+}
+
+static void test_read(void *context, const void *buffer, void *received,
+                      size_t length) {
+  (void)context;
+  (void)buffer;
+  memset(received, 0, length);
+}
+
+static bool test_speed(void *context, uint32_t bps) {
+  (void)context;
+  (void)bps;
+  return true;
+}
+
+// a different byte pattern in every pixel
+static void test_pattern(ILI9486_type *lcd) {
+  for (int y = 0; y < lcd->height; ++y) {
+    for (int x = 0; x < lcd->width; ++x) {
+      uint8_t *p = pixel(lcd, x, y);
+      for (size_t i = 0; i < lcd->kernels->bytes; ++i) {
+        p[i] = (uint8_t)(x * 7 + y * 13 + i * 101);
+      }
+    }
+  }
+}
+
+// forget all damage
+static void test_undamage(ILI9486_type *lcd) {
+  memset(lcd->damage_count, 0, sizeof(lcd->damage_count));
+}
+
+// the damage is exactly one rectangle, or none if width is 0
+static void test_damage(ILI9486_type *lcd, int priority, rect_type r) {
+  for (int p = 0; p < ILI9486_PRIORITIES; ++p) {
+    size_t expected = (p == priority && r.width > 0) ? 1 : 0;
+    assert(lcd->damage_count[p] == expected);
+  }
+  if (r.width > 0) {
+    const rect_type *d = &lcd->damage[priority][0];
+    printf("damage: %d %d %d×%d\n", d->x, d->y, d->width, d->height);
+    assert(d->x == r.x && d->y == r.y && d->width == r.width &&
+           d->height == r.height);
+  }
+}
+
+// copy pixel by pixel from a snapshot and compare, with the damage
+// as the destination pixels that were on the screen
+static void test_copy(ILI9486_type *lcd, uint8_t *before, int x, int y,
+                      int width, int height, int to_x, int to_y) {
+
+  const size_t size = (size_t)lcd->height * lcd->stride * lcd->kernels->bytes;
+  const size_t bytes = lcd->kernels->bytes;
+  uint8_t *expected = before + size;
+  test_pattern(lcd);
+  memcpy(before, lcd->framebuffer, size);
+  memcpy(expected, lcd->framebuffer, size);
+  test_undamage(lcd);
+
+  bool truncated =
+      ILI9486_copy_rect(lcd, x, y, width, height, to_x, to_y,
+                        ILI9486_PRIORITY_NORMAL);
+
+  int left = lcd->width;
+  int top = lcd->height;
+  int right = 0;
+  int bottom = 0;
+  bool expected_truncated = width <= 0 || height <= 0; // as fills
+  for (int sy = y; sy < y + height; ++sy) {
+    for (int sx = x; sx < x + width; ++sx) {
+      int dx = sx + to_x - x;
+      int dy = sy + to_y - y;
+      if (sx < 0 || sy < 0 || sx >= lcd->width || sy >= lcd->height ||
+          dx < 0 || dy < 0 || dx >= lcd->width || dy >= lcd->height) {
+        expected_truncated = true;
+        continue;
+      }
+      size_t from = ((size_t)sy * lcd->stride + sx) * bytes;
+      size_t to = ((size_t)dy * lcd->stride + dx) * bytes;
+      memcpy(expected + to, before + from, bytes);
+      left = dx < left ? dx : left;
+      top = dy < top ? dy : top;
+      right = dx + 1 > right ? dx + 1 : right;
+      bottom = dy + 1 > bottom ? dy + 1 : bottom;
+    }
+  }
+
+  assert(memcmp(lcd->framebuffer, expected, size) == 0);
+  assert(truncated == expected_truncated);
+  rect_type damage = {0};
+  if (right > left) {
+    damage = (rect_type){
+        .x = left, .y = top, .width = right - left, .height = bottom - top};
+  }
+  test_damage(lcd, ILI9486_PRIORITY_NORMAL, damage);
+}
+
+// fill and compare, with the damage as the pixels on the screen
+static void test_fill(ILI9486_type *lcd, uint8_t *before, int x, int y,
+                      int width, int height) {
+
+  const size_t size = (size_t)lcd->height * lcd->stride * lcd->kernels->bytes;
+  const size_t bytes = lcd->kernels->bytes;
+  const ILI9486_colour_type colour = {.red = 0xfc, .green = 0x80};
+  uint8_t filled[4];
+  rect_type one = {.width = 1, .height = 1};
+  fill_area(lcd, &one, colour);
+  memcpy(filled, pixel(lcd, 0, 0), bytes);
+
+  test_pattern(lcd);
+  memcpy(before, lcd->framebuffer, size);
+  test_undamage(lcd);
+
+  bool truncated =
+      ILI9486_fill_rect(lcd, x, y, width, height, colour,
+                        ILI9486_PRIORITY_HIGH);
+
+  rect_type damage = {.x = x, .y = y, .width = width, .height = height};
+  rect_type screen = {.width = lcd->width, .height = lcd->height};
+  if (!clip_rect(&damage, &screen)) {
+    damage = (rect_type){0};
+  }
+  assert(truncated != (damage.x == x && damage.y == y &&
+                       damage.width == width && damage.height == height));
+  for (int h = 0; h < damage.height; ++h) {
+    for (int w = 0; w < damage.width; ++w) {
+      size_t at = ((size_t)(damage.y + h) * lcd->stride + damage.x + w) * bytes;
+      memcpy(before + at, filled, bytes);
+    }
+  }
+  assert(memcmp(lcd->framebuffer, before, size) == 0);
+  test_damage(lcd, ILI9486_PRIORITY_HIGH, damage);
+}
+
+// both halves of a pair agree with blend() for every input
+static void test_blend_pair(void) {
+  for (unsigned int alpha = 0; alpha < 256; ++alpha) {
+    for (unsigned int fg = 0; fg < 256; ++fg) {
+      for (unsigned int bg = 0; bg < 256; ++bg) {
+        uint32_t pair = blend_pair(fg | (255 - fg) << 16,
+                                   bg | (255 - bg) << 16, alpha);
+        assert((pair & 0xff) == blend(fg, bg, alpha));
+        assert(pair >> 16 == blend(255 - fg, 255 - bg, alpha));
+      }
+    }
+  }
+}
+
+// the over kernel against blending each component of a loaded pixel
+static void test_over(const kernels_type *kernels) {
+  enum { count = 4096 };
+  uint8_t p[count * 3];
+  uint8_t expected[count * 3];
+  uint8_t coverage[count];
+  const ILI9486_colour_type foreground = {
+      .red = 0xe4, .green = 0x3b, .blue = 0x91};
+
+  uint32_t seed = 1;
+  for (size_t i = 0; i < sizeof(p); ++i) {
+    seed = seed * 1103515245 + 12345;
+    p[i] = (uint8_t)(seed >> 16);
+  }
+  for (size_t n = 0; n < count; ++n) {
+    coverage[n] = (uint8_t)n;
+    uint8_t rgb[3];
+    kernels->load(p + n * kernels->bytes, rgb);
+    const ILI9486_colour_type c = {
+        .red = blend(foreground.red, rgb[0], coverage[n]),
+        .green = blend(foreground.green, rgb[1], coverage[n]),
+        .blue = blend(foreground.blue, rgb[2], coverage[n]),
+    };
+    kernels->fill(expected + n * kernels->bytes, 1, c);
+  }
+  kernels->over(p, coverage, count, foreground);
+  assert(memcmp(p, expected, count * kernels->bytes) == 0);
+}
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  test_blend_pair();
+  test_over(&rgb666_kernels);
+  test_over(&rgb565_kernels);
+
+  const ILI9486_transport_type transport = {
+      .select = test_select,
+      .send = test_send,
+      .read = test_read,
+      .speed = test_speed,
+  };
+  ILI9486_config_type config = ILI9486_CONFIG_WAVESHARE;
+  config.transport = &transport;
+  ILI9486_type *lcd = ILI9486_create(&config, false);
+  assert(lcd != NULL);
+  printf("panel: %d×%d\n", lcd->width, lcd->height);
+
+  // a snapshot and the expected buffer
+  uint8_t *before =
+      malloc(2 * (size_t)lcd->height * lcd->stride * lcd->kernels->bytes);
+  assert(before != NULL);
+
+  // overlapping copies in every direction, including within a row
+  const int shift[][2] = {{5, 0},  {-5, 0}, {0, 5},  {0, -5},
+                          {3, 4},  {-3, 4}, {3, -4}, {-3, -4},
+                          {1, 0},  {0, 1},  {0, 0}};
+  for (size_t i = 0; i < sizeof(shift) / sizeof(shift[0]); ++i) {
+    test_copy(lcd, before, 100, 100, 50, 40, 100 + shift[i][0],
+              100 + shift[i][1]);
+  }
+
+  // clipped at each edge of the source and the destination
+  test_copy(lcd, before, -10, -20, 50, 40, 30, 60);
+  test_copy(lcd, before, 30, 60, 50, 40, -10, -20);
+  test_copy(lcd, before, lcd->width - 20, lcd->height - 10, 50, 40, 10, 10);
+  test_copy(lcd, before, 10, 10, 50, 40, lcd->width - 20, lcd->height - 10);
+  test_copy(lcd, before, -10, 0, 50, 40, 5, 0);
+
+  // wholly off the screen, or empty
+  test_copy(lcd, before, -100, 0, 50, 40, 10, 10);
+  test_copy(lcd, before, 10, 10, 50, 40, lcd->width, 10);
+  test_copy(lcd, before, 10, 10, 0, 40, 20, 20);
+
+  // fills clipped the same way
+  test_fill(lcd, before, 10, 20, 30, 40);
+  test_fill(lcd, before, -10, -20, 30, 40);
+  test_fill(lcd, before, lcd->width - 10, lcd->height - 20, 30, 40);
+  test_fill(lcd, before, lcd->width, 0, 30, 40);
+  test_fill(lcd, before, 0, -40, 30, 40);
+  test_fill(lcd, before, 0, 0, -5, 40);
+
+  free(before);
+  ILI9486_destroy(lcd);
+  return 0;
+}
+#endif
@@ -4,7 +4,9 @@
 #define ILI9486_H 1
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 
 // rotation of the LCD
@@ -15,30 +17,236 @@ typedef enum {
   ILI9486_ROTATION_180 = 1,
 } ILI9486_rotation_type;
 
+// an RGB colour
+typedef struct {
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+} ILI9486_colour_type;
+
+// pixel formats of the internal buffer, as sent to the panel
+typedef enum {
+  ILI9486_FORMAT_RGB666 = 0, // R, G, B bytes, the low two bits ignored
+  ILI9486_FORMAT_RGB565 = 1, // 5-6-5 bits, most significant byte first
+} ILI9486_format_type;
+
+// type to hold a panel, or several panels tiled as one canvas
+typedef struct ILI9486_struct ILI9486_type;
+
+// most panels that can be tiled into a canvas
+#define ILI9486_MAX_TILES 4
+
+// priority of changed areas sent by ILI9486_sync
+typedef enum {
+  ILI9486_PRIORITY_HIGH = 0, // always sent, first
+  ILI9486_PRIORITY_NORMAL,   // sent while the frame budget lasts
+  ILI9486_PRIORITY_LOW,      // ..
+} ILI9486_priority_type;
+
+#define ILI9486_PRIORITIES 3
+
+// the bus to a panel: SPI with RS on a GPIO pin, unless replaced, e.g.
+// by a simulation for benchmarks
+typedef struct {
+  void *context;
+
+  // RS low before command bytes, high before parameters and pixels
+  void (*select)(void *context, bool data);
+
+  // send length bytes
+  void (*send)(void *context, const void *buffer, size_t length);
+
+  // send length bytes, keeping the bytes received at the same time
+  void (*read)(void *context, const void *buffer, void *received,
+               size_t length);
+
+  // change the clock
+  // returns false if the bus cannot run at bps
+  bool (*speed)(void *context, uint32_t bps);
+} ILI9486_transport_type;
+
+// connection of a panel
+typedef struct {
+  const char *spi_device;        // SPI bus
+  int spi_address;               // chip select on the bus
+  const char *gpio_device;       // GPIO controller
+  int rs_pin;                    // register select (command/data)
+  int reset_pin;                 // panel reset
+  ILI9486_rotation_type rotate;  // orientation
+  bool threaded;                 // flush from a separate thread
+  const char *model;             // panel profile, NULL for waveshare-c
+  const char *state_file;        // tuned SPI settings, may be NULL
+  // bus to use instead of SPI and GPIO, may be NULL
+  const ILI9486_transport_type *transport;
+} ILI9486_config_type;
+
+// traffic sent to the panels
+typedef struct {
+  uint64_t bytes;     // commands, parameters and pixels
+  uint64_t transfers; // SPI transfers
+} ILI9486_counters_type;
+
+// SPI settings found by ILI9486_calibrate
+typedef struct {
+  uint32_t bps; // clock
+  size_t chunk; // largest pixel transfer in bytes, 0 for one per row
+} ILI9486_tuning_type;
+
+// the Waveshare 3.5inch RPI LCD on the Raspberry Pi header
+#define ILI9486_CONFIG_WAVESHARE                                               \
+  {                                                                            \
+    .spi_device = "/dev/spi0", .spi_address = 0, .gpio_device = "/dev/gpio0",  \
+    .rs_pin = 24, .reset_pin = 25, .rotate = ILI9486_ROTATION_0,               \
+    .threaded = false, .model = NULL, .state_file = NULL, .transport = NULL,   \
+  }
+
 // functions
 // =========
 
+// name of a panel model for ILI9486_config_type.model
+// returns NULL when index is past the last model
+const char *ILI9486_model(size_t index);
+
 // create connection to LCD
-bool ILI9486_create(ILI9486_rotation_type rotate);
+//
+// warm: if the panel is already initialised with the same settings
+//       skip the reset and initialisation so the display does not blank
+// returns NULL on failure
+ILI9486_type *ILI9486_create(const ILI9486_config_type *config, bool warm);
+
+// combine panels of the same size into one canvas, filling the
+// columns left to right then the rows downwards; drawing on the canvas
+// draws on the panels and the canvas refresh flushes all of them, in
+// parallel for threaded panels.  The canvas owns the panels from now
+// on, destroying it destroys them.
+// returns NULL on failure
+ILI9486_type *ILI9486_tile(ILI9486_type **panels, size_t count,
+                           int columns);
+
+// find the fastest SPI clock, then the largest transfer, that the
+// panel reliably accepts by sending test patterns and reading them
+// back from the panel memory; the result is saved to the state file
+// and used by ILI9486_create from then on
+//
+// this overwrites the internal buffer and the display
+// returns false if the panel cannot be read back or even the slowest
+// clock fails
+bool ILI9486_calibrate(ILI9486_type *lcd, ILI9486_tuning_type *tuning);
+
+// run the flush threads of a panel, or of every panel of a canvas, at
+// a SCHED_FIFO priority and only on one CPU; unthreaded panels flush
+// on the caller's thread and are left alone
+//
+// priority: -1 to keep the current scheduling
+// cpu:      -1 to run on any CPU
+// returns false if the threads could not be changed, e.g. not root
+bool ILI9486_realtime(ILI9486_type *lcd, int priority, int cpu);
+
+// bus traffic so far of a panel, or the total of a canvas, after
+// waiting for any flush
+void ILI9486_counters(ILI9486_type *lcd, ILI9486_counters_type *counters);
+
+// SPI clock of a panel, or of the bus shared by the panels of a canvas
+uint32_t ILI9486_bps(ILI9486_type *lcd);
 
 // disconnect LCD and release resources
-bool ILI9486_destroy(void);
+bool ILI9486_destroy(ILI9486_type *lcd);
+
+// display size in pixels
+int ILI9486_width(ILI9486_type *lcd);
+int ILI9486_height(ILI9486_type *lcd);
 
-// sync any changes in the internal buffer to the LCD
-// updated largest marked area and zeros the mark
-void ILI9486_sync(void);
+// pixel format of the internal buffer
+ILI9486_format_type ILI9486_format(ILI9486_type *lcd);
+
+// mark a rectangle of the internal buffer as changed, nothing is
+// marked by drawing so only what is marked here is sent by sync
+void ILI9486_damage(ILI9486_type *lcd, int x, int y, int width, int height,
+                    ILI9486_priority_type priority);
+
+// send the changed areas to the LCD, highest priority first
+//
+// deadline: microseconds the transfer may take, 0 for no limit; high
+//           priority areas are always sent, the rest only while they
+//           fit and whatever does not fit is kept for the next sync
+// returns true if no changes are left
+bool ILI9486_sync(ILI9486_type *lcd, unsigned int deadline);
+
+// when the high priority areas sent by the last sync went over the bus,
+// in CLOCK_REALTIME time
+typedef struct {
+  struct timespec first; // first transfer started
+  struct timespec last;  // last byte sent
+} ILI9486_timing_type;
+
+// timing of the last sync, the earliest and latest of all panels of a
+// canvas
+// returns false if it sent no high priority area
+bool ILI9486_timing(ILI9486_type *lcd, ILI9486_timing_type *timing);
 
 // sync whole internal buffer to the LCD
-void ILI9486_refresh(void);
+void ILI9486_refresh(ILI9486_type *lcd);
+
+// start sending the whole internal buffer to the LCD, threaded panels
+// return at once and the buffer must not be drawn on until
+// ILI9486_wait, otherwise this is the same as ILI9486_refresh; any
+// damage not yet sent is dropped
+void ILI9486_flush(ILI9486_type *lcd);
+
+// wait for a flush to complete
+void ILI9486_wait(ILI9486_type *lcd);
 
 // clear the internal buffer to a colour
-// marks whole buffer as changed so either sync or refresh can be used
-void ILI9486_clear(uint8_t red, uint8_t green, uint8_t blue);
+void ILI9486_clear(ILI9486_type *lcd, uint8_t red, uint8_t green,
+                   uint8_t blue);
+
+// fill a rectangle of the internal buffer with a colour
+//
+// returns truncation occurred
+bool ILI9486_fill(ILI9486_type *lcd, int x, int y, int width, int height,
+                  ILI9486_colour_type colour);
+
+// fill a rectangle of the internal buffer with a colour and mark it
+// changed
+//
+// returns truncation occurred
+bool ILI9486_fill_rect(ILI9486_type *lcd, int x, int y, int width,
+                       int height, ILI9486_colour_type colour,
+                       ILI9486_priority_type priority);
+
+// copy a rectangle of the internal buffer to to_x, to_y and mark the
+// destination changed; the two may overlap
+//
+// returns truncation occurred
+bool ILI9486_copy_rect(ILI9486_type *lcd, int x, int y, int width,
+                       int height, int to_x, int to_y,
+                       ILI9486_priority_type priority);
+
+// move the pixels of a rectangle dx pixels right, or left if negative,
+// and mark the rectangle changed; the dx columns uncovered at one side
+// keep their old pixels for the caller to draw over
+//
+// returns truncation occurred
+bool ILI9486_scroll(ILI9486_type *lcd, int x, int y, int width, int height,
+                    int dx, ILI9486_priority_type priority);
+
+// keep the internal buffer as the background layer, drawn once e.g.
+// for each theme and copied back with ILI9486_restore
+// returns false if the layer cannot be allocated
+bool ILI9486_capture(ILI9486_type *lcd);
+
+// copy a rectangle of the background layer to the internal buffer, it
+// is not marked changed
+//
+// returns truncation occurred, or true when nothing was captured
+bool ILI9486_restore(ILI9486_type *lcd, int x, int y, int width,
+                     int height);
 
 // send a rectangular bitmap to the internal buffer
 //
 // returns truncation occurred
 bool ILI9486_rect_rgba(
+    ILI9486_type *lcd, // panel or canvas
     int x,             // X coordinate on LCD
     int y,             // Y coordinate on LCD
     int offset_x,      // X offset in bitmap
@@ -50,4 +258,42 @@ bool ILI9486_rect_rgba(
                        // total bytes = height * stride * 4
 );
 
+// blend a rectangular coverage bitmap to the internal buffer as
+// foreground over background colour
+//
+// returns truncation occurred
+bool ILI9486_rect_alpha(
+    ILI9486_type *lcd,              // panel or canvas
+    int x,                          // X coordinate on LCD
+    int y,                          // Y coordinate on LCD
+    int offset_x,                   // X offset in bitmap
+    int offset_y,                   // Y offset in bitmap
+    int width,                      // bitmap width in pixels
+    int height,                     // bitmap height in pixels
+    size_t stride,                  // number of bytes in a bitmap row
+    const uint8_t *coverage,        // 8 bit coverage (1 byte/pixel)
+    ILI9486_colour_type foreground, // colour at full coverage
+    ILI9486_colour_type background  // colour at zero coverage
+);
+
+// blend a foreground colour by a rectangular coverage bitmap over the
+// pixels already in the internal buffer, e.g. a restored background;
+// the arguments are as ILI9486_rect_alpha
+//
+// returns truncation occurred
+bool ILI9486_rect_over(ILI9486_type *lcd, int x, int y, int offset_x,
+                       int offset_y, int width, int height, size_t stride,
+                       const uint8_t *coverage,
+                       ILI9486_colour_type foreground);
+
+// draw a sprite whose pixels are already in the format of the internal
+// buffer, rows width pixels apart; it is blended over the internal
+// buffer by an 8 bit alpha plane of the same layout, or copied when
+// alpha is NULL
+//
+// returns truncation occurred
+bool ILI9486_rect_sprite(ILI9486_type *lcd, int x, int y, int width,
+                         int height, const uint8_t *pixels,
+                         const uint8_t *alpha);
+
 #endif
@@ -0,0 +1,234 @@
+// message.c
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "colour.h"
+#include "message.h"
+#include "unicode.h"
+
+// longest markup between braces, enough for two long colour names
+#define MARKUP_SIZE 64
+
+// colours are the same
+static bool same_colour(ILI9486_colour_type a, ILI9486_colour_type b) {
+  return a.red == b.red && a.green == b.green && a.blue == b.blue;
+}
+
+// spans would be drawn the same
+static bool same_style(const MESSAGE_span_type *a,
+                       const MESSAGE_span_type *b) {
+  return a->themed_foreground == b->themed_foreground &&
+         a->themed_background == b->themed_background &&
+         (a->themed_foreground || same_colour(a->foreground, b->foreground)) &&
+         (a->themed_background || same_colour(a->background, b->background));
+}
+
+// apply the markup between braces to a style
+// returns false if it is not a colour change
+static bool markup(const char *body, size_t length,
+                   MESSAGE_span_type *style) {
+
+  MESSAGE_span_type s = *style;
+
+  if (length == 0) {
+    s.themed_foreground = true;
+    s.themed_background = true;
+    *style = s;
+    return true;
+  }
+
+  const char *slash = memchr(body, '/', length);
+  size_t foreground_length = (slash == NULL) ? length : (size_t)(slash - body);
+
+  if (foreground_length > 0) {
+    if (!COLOUR_parse(body, foreground_length, &s.foreground)) {
+      return false;
+    }
+    s.themed_foreground = false;
+  }
+
+  if (slash != NULL) {
+    size_t background_length = length - foreground_length - 1;
+    if (background_length == 0 ||
+        !COLOUR_parse(slash + 1, background_length, &s.background)) {
+      return false;
+    }
+    s.themed_background = false;
+  }
+
+  *style = s;
+  return true;
+}
+
+// find the closing brace of markup starting at body
+// returns NULL if there is none close enough
+static const char *closing(const char *body) {
+  for (size_t i = 0; i < MARKUP_SIZE && body[i] != '\0'; ++i) {
+    if (body[i] == '}') {
+      return &body[i];
+    }
+    if (body[i] == '{') {
+      break;
+    }
+  }
+  return NULL;
+}
+
+// parse markup into codepoints and spans and lay out the cells
+bool MESSAGE_parse(MESSAGE_type *message, const char *src) {
+
+  message->length = 0;
+  message->span_count = 0;
+  message->cell[0] = 0;
+
+  MESSAGE_span_type style = {
+      .themed_foreground = true,
+      .themed_background = true,
+  };
+
+  utf8_cursor_type cursor;
+  utf8_cursor_init(&cursor, src);
+
+  uint32_t c = 0;
+  while (utf8_cursor_next(&cursor, &c)) {
+
+    if (c == '{') {
+      if (*cursor.current == '{') {
+        ++cursor.current; // "{{" is a literal brace
+      } else {
+        const char *end = closing(cursor.current);
+        if (end != NULL &&
+            markup(cursor.current, end - cursor.current, &style)) {
+          cursor.current = end + 1;
+          continue;
+        }
+      }
+    } else if (c == '\n' || c == '\t') {
+      c = ' ';
+    } else if (c < ' ' || (c >= 0x7f && c < 0xa0)) {
+      continue;
+    }
+
+    size_t n = message->length;
+    if (n == MESSAGE_MAX_CODEPOINTS) {
+      return false;
+    }
+
+    // a new span when the colours change, once all spans are used the
+    // last one continues
+    size_t last = message->span_count - 1;
+    if (message->span_count == 0 ||
+        (!same_style(&message->span[last], &style) &&
+         message->span_count < MESSAGE_MAX_SPANS)) {
+      last = message->span_count++;
+      MESSAGE_span_type *span = &message->span[last];
+      *span = style;
+      span->first = n;
+      span->length = 0;
+    }
+    ++message->span[last].length;
+
+    message->text[n] = c;
+    message->cell[n + 1] = message->cell[n] + ucs4_width(c);
+    message->length = n + 1;
+  }
+  return true;
+}
+
+// find the span containing codepoint index
+size_t MESSAGE_span(const MESSAGE_type *message, size_t index) {
+
+  if (index >= message->length) {
+    return message->span_count;
+  }
+
+  // last span starting at or before index
+  size_t low = 0;
+  size_t high = message->span_count;
+  while (high - low > 1) {
+    size_t mid = low + (high - low) / 2;
+    if (message->span[mid].first <= index) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stdio.h>
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  static MESSAGE_type message;
+
+  assert(MESSAGE_parse(&message, "plain 日本"));
+  assert(message.length == 8);
+  assert(message.span_count == 1);
+  assert(message.span[0].themed_foreground);
+  assert(message.span[0].themed_background);
+  assert(message.cell[8] == 10);
+
+  const char *marked = "a{red}bc{#00f/yellow}d{}e{{f{nosuch}\r\n";
+  assert(MESSAGE_parse(&message, marked));
+  for (size_t i = 0; i < message.span_count; ++i) {
+    const MESSAGE_span_type *s = &message.span[i];
+    printf("span: %zu  first: %zu  length: %zu  fg: %d %3d %3d %3d  bg: %d "
+           "%3d %3d %3d\n",
+           i, s->first, s->length, s->themed_foreground, s->foreground.red,
+           s->foreground.green, s->foreground.blue, s->themed_background,
+           s->background.red, s->background.green, s->background.blue);
+  }
+
+  const uint32_t expected[] = {'a', 'b', 'c', 'd', 'e', '{', 'f', '{',
+                               'n', 'o', 's', 'u', 'c', 'h', '}', ' '};
+  assert(message.length == sizeof(expected) / sizeof(expected[0]));
+  assert(memcmp(message.text, expected, sizeof(expected)) == 0);
+
+  assert(message.span_count == 4);
+  assert(message.span[0].first == 0 && message.span[0].length == 1);
+  assert(message.span[1].first == 1 && message.span[1].length == 2);
+  assert(!message.span[1].themed_foreground);
+  assert(message.span[1].foreground.red == 255);
+  assert(message.span[1].themed_background);
+  assert(message.span[2].first == 3 && message.span[2].length == 1);
+  assert(message.span[2].foreground.blue == 255);
+  assert(!message.span[2].themed_background);
+  assert(message.span[2].background.green == 255);
+  assert(message.span[3].first == 4);
+  assert(message.span[3].themed_foreground);
+  assert(message.span[3].themed_background);
+
+  assert(MESSAGE_span(&message, 0) == 0);
+  assert(MESSAGE_span(&message, 2) == 1);
+  assert(MESSAGE_span(&message, 3) == 2);
+  assert(MESSAGE_span(&message, 15) == 3);
+  assert(MESSAGE_span(&message, 16) == 4);
+
+  // markup alone gives no spans
+  assert(MESSAGE_parse(&message, "{red}"));
+  assert(message.length == 0 && message.span_count == 0);
+  assert(MESSAGE_span(&message, 0) == 0);
+
+  // span limit extends the last span
+  char many[MESSAGE_MAX_SPANS * 16];
+  many[0] = '\0';
+  for (int i = 0; i < MESSAGE_MAX_SPANS + 4; ++i) {
+    strcat(many, (i & 1) ? "{red}x" : "{blue}x");
+  }
+  assert(MESSAGE_parse(&message, many));
+  assert(message.span_count == MESSAGE_MAX_SPANS);
+  assert(message.span[MESSAGE_MAX_SPANS - 1].length == 5);
+
+  return 0;
+}
+#endif
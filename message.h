@@ -0,0 +1,61 @@
+// message.h
+
+#if !defined(MESSAGE_H)
+#define MESSAGE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ili9486.h"
+
+// markup
+// ======
+//
+// a message is UTF-8 text with colour changes in braces:
+//
+//   {red}     foreground from an X11 name or #rgb / #rrggbb
+//   {red/#000} foreground and background
+//   {/yellow} background only
+//   {}        back to the theme colours
+//   {{        a literal '{'
+//
+// anything in braces that is not a valid colour change is shown as
+// text.  Line breaks and tabs become spaces, other control characters
+// are dropped.
+
+#define MESSAGE_MAX_CODEPOINTS 1024
+#define MESSAGE_MAX_SPANS 64
+
+// a run of codepoints in the same colours
+typedef struct {
+  size_t first;                   // index of first codepoint
+  size_t length;                  // number of codepoints
+  bool themed_foreground;         // use the theme foreground
+  bool themed_background;         // use the theme background
+  ILI9486_colour_type foreground; // otherwise these
+  ILI9486_colour_type background; // ..
+} MESSAGE_span_type;
+
+// a parsed message with its layout, the spans cover all of the text
+// in order
+typedef struct {
+  uint32_t text[MESSAGE_MAX_CODEPOINTS];
+  uint32_t cell[MESSAGE_MAX_CODEPOINTS + 1]; // cells before each codepoint
+  size_t length;
+  MESSAGE_span_type span[MESSAGE_MAX_SPANS];
+  size_t span_count;
+} MESSAGE_type;
+
+// functions
+// =========
+
+// parse markup into codepoints and spans and lay out the cells
+// returns false if the message was truncated
+bool MESSAGE_parse(MESSAGE_type *message, const char *src);
+
+// find the span containing codepoint index
+// returns span_count if index is past the end
+size_t MESSAGE_span(const MESSAGE_type *message, size_t index);
+
+#endif
@@ -0,0 +1,273 @@
+// pool.c
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+typedef struct {
+  POOL_function_type *function;
+  void *arg;
+} job_type;
+
+typedef struct {
+  POOL_type *pool;
+  void *context;
+  pthread_t thread;
+  bool started;
+} worker_type;
+
+struct POOL_struct {
+  worker_type worker[POOL_MAX_WORKERS];
+  size_t worker_count;
+
+  pthread_mutex_t lock;
+  pthread_cond_t queued;   // a job was queued or the pool is stopping
+  pthread_cond_t finished; // all jobs are done
+  job_type job[POOL_MAX_JOBS];
+  size_t first;   // oldest queued job
+  size_t count;   // jobs queued
+  size_t running; // jobs taken but not finished
+  bool stop;      // workers should exit once the queue is empty
+};
+
+// take jobs until the pool stops
+static void *worker_thread(void *arg) {
+  worker_type *worker = arg;
+  POOL_type *pool = worker->pool;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->count == 0 && !pool->stop) {
+      pthread_cond_wait(&pool->queued, &pool->lock);
+    }
+    if (pool->count == 0) {
+      break; // stopping
+    }
+    job_type job = pool->job[pool->first];
+    pool->first = (pool->first + 1) % POOL_MAX_JOBS;
+    --pool->count;
+    ++pool->running;
+    pthread_mutex_unlock(&pool->lock);
+
+    job.function(worker->context, job.arg);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->running == 0 && pool->count == 0) {
+      pthread_cond_broadcast(&pool->finished);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+// start the workers
+POOL_type *POOL_create(size_t workers, void *const *contexts) {
+
+  if (workers == 0 || workers > POOL_MAX_WORKERS) {
+    warnx("invalid number of workers: %zu (1…%d)", workers,
+          POOL_MAX_WORKERS);
+    return NULL;
+  }
+
+  POOL_type *pool = calloc(1, sizeof(POOL_type));
+  if (pool == NULL) {
+    warn("failed to allocate worker pool");
+    return NULL;
+  }
+
+  if (pthread_mutex_init(&pool->lock, NULL) != 0 ||
+      pthread_cond_init(&pool->queued, NULL) != 0 ||
+      pthread_cond_init(&pool->finished, NULL) != 0) {
+    warnx("cannot create worker pool lock");
+    free(pool);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < workers; ++i) {
+    worker_type *w = &pool->worker[i];
+    w->pool = pool;
+    w->context = contexts[i];
+    if (pthread_create(&w->thread, NULL, worker_thread, w) != 0) {
+      warnx("cannot start worker thread");
+      POOL_destroy(pool);
+      return NULL;
+    }
+    w->started = true;
+    pool->worker_count = i + 1;
+  }
+
+  return pool;
+}
+
+// finish the queued jobs and stop the workers
+bool POOL_destroy(POOL_type *pool) {
+
+  if (pool == NULL) {
+    return false;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->queued);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->worker_count; ++i) {
+    if (pool->worker[i].started) {
+      pthread_join(pool->worker[i].thread, NULL);
+    }
+  }
+
+  pthread_cond_destroy(&pool->finished);
+  pthread_cond_destroy(&pool->queued);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+
+  return true;
+}
+
+// number of workers
+size_t POOL_workers(POOL_type *pool) {
+  return pool->worker_count;
+}
+
+// run the workers at a SCHED_FIFO priority
+bool POOL_realtime(POOL_type *pool, int priority, int cpu) {
+
+  bool ok = true;
+
+  struct sched_param param = {.sched_priority = priority};
+  for (size_t i = 0; priority >= 0 && i < pool->worker_count; ++i) {
+    int rc =
+        pthread_setschedparam(pool->worker[i].thread, SCHED_FIFO, &param);
+    if (rc != 0) {
+      warnx("cannot set worker priority %d: %s", priority, strerror(rc));
+      ok = false;
+    }
+  }
+
+  if (cpu >= 0) {
+    cpuset_t *set = cpuset_create();
+    if (set == NULL) {
+      warn("cannot create cpu set");
+      return false;
+    }
+    cpuset_zero(set);
+    int rc = EINVAL;
+    if (cpuset_set((cpuid_t)cpu, set) == 0) {
+      rc = 0;
+      for (size_t i = 0; rc == 0 && i < pool->worker_count; ++i) {
+        rc = pthread_setaffinity_np(pool->worker[i].thread, cpuset_size(set),
+                                    set);
+      }
+    }
+    cpuset_destroy(set);
+    if (rc != 0) {
+      warnx("cannot pin workers to cpu %d: %s", cpu, strerror(rc));
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+// queue a job for the next free worker
+bool POOL_submit(POOL_type *pool, POOL_function_type *function, void *arg) {
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->count == POOL_MAX_JOBS) {
+    pthread_mutex_unlock(&pool->lock);
+    return false;
+  }
+  pool->job[(pool->first + pool->count) % POOL_MAX_JOBS] = (job_type){
+      .function = function,
+      .arg = arg,
+  };
+  ++pool->count;
+  pthread_cond_signal(&pool->queued);
+  pthread_mutex_unlock(&pool->lock);
+
+  return true;
+}
+
+// wait until every queued job has finished
+void POOL_join(POOL_type *pool) {
+  pthread_mutex_lock(&pool->lock);
+  while (pool->count > 0 || pool->running > 0) {
+    pthread_cond_wait(&pool->finished, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+typedef struct {
+  int jobs;  // run by this worker
+  int total; // sum of the job arguments it saw
+} counter_type;
+
+static void count_job(void *context, void *arg) {
+  counter_type *c = context;
+  ++c->jobs;
+  c->total += *(int *)arg;
+  usleep(1000);
+}
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  assert(POOL_create(0, NULL) == NULL);
+
+  counter_type counters[POOL_MAX_WORKERS];
+  void *contexts[POOL_MAX_WORKERS];
+  memset(counters, 0, sizeof(counters));
+  for (size_t i = 0; i < POOL_MAX_WORKERS; ++i) {
+    contexts[i] = &counters[i];
+  }
+
+  POOL_type *pool = POOL_create(POOL_MAX_WORKERS, contexts);
+  assert(pool != NULL);
+  assert(POOL_workers(pool) == POOL_MAX_WORKERS);
+
+  // join with nothing queued returns at once
+  POOL_join(pool);
+
+  // every job runs once, each worker only touches its own context
+  static int values[POOL_MAX_JOBS];
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < POOL_MAX_JOBS; ++i) {
+      values[i] = i + 1;
+      assert(POOL_submit(pool, count_job, &values[i]));
+    }
+    POOL_join(pool);
+  }
+
+  int jobs = 0;
+  int total = 0;
+  int busy = 0;
+  for (size_t i = 0; i < POOL_MAX_WORKERS; ++i) {
+    printf("worker: %zu  jobs: %d\n", i, counters[i].jobs);
+    jobs += counters[i].jobs;
+    total += counters[i].total;
+    busy += counters[i].jobs > 0;
+  }
+  assert(jobs == 3 * POOL_MAX_JOBS);
+  assert(total == 3 * POOL_MAX_JOBS * (POOL_MAX_JOBS + 1) / 2);
+  assert(busy > 1);
+
+  assert(POOL_destroy(pool));
+  return 0;
+}
+#endif
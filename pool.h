@@ -0,0 +1,57 @@
+// pool.h
+
+#if !defined(POOL_H)
+#define POOL_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// worker pool
+// ===========
+//
+// a few threads, each with a context of its own such as FreeType
+// objects that must not be shared between threads, that run queued
+// jobs; the caller joins before using what the jobs produced
+
+// most workers in a pool
+#define POOL_MAX_WORKERS 4
+
+// most jobs queued between joins
+#define POOL_MAX_JOBS 32
+
+// type to hold a pool
+typedef struct POOL_struct POOL_type;
+
+// a job, run with the context of whichever worker takes it
+typedef void POOL_function_type(void *context, void *arg);
+
+// functions
+// =========
+
+// start the workers
+//
+// contexts: one for each worker
+// returns NULL on failure
+POOL_type *POOL_create(size_t workers, void *const *contexts);
+
+// finish the queued jobs and stop the workers
+bool POOL_destroy(POOL_type *pool);
+
+// number of workers
+size_t POOL_workers(POOL_type *pool);
+
+// run the workers at a SCHED_FIFO priority and only on one CPU
+//
+// priority: -1 to keep the current scheduling
+// cpu:      -1 to run on any CPU
+// returns false if any could not be changed, e.g. not root
+bool POOL_realtime(POOL_type *pool, int priority, int cpu);
+
+// queue a job for the next free worker
+// returns false if the queue is full
+bool POOL_submit(POOL_type *pool, POOL_function_type *function, void *arg);
+
+// wait until every queued job has finished
+void POOL_join(POOL_type *pool);
+
+#endif
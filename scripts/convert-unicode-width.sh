@@ -0,0 +1,151 @@
+#! /bin/sh
+# convert the Unicode EastAsianWidth.txt and DerivedGeneralCategory.txt
+# files to a C header of display cell widths
+#
+# widths:
+#   0  combining marks (Mn, Me), format (Cf) and control (Cc)
+#      characters and Hangul medial vowels and final consonants
+#   2  East Asian Wide (W) and Fullwidth (F)
+#   1  everything else, including Ambiguous (A)
+#
+# the table has two stages: a page index for each 256 code points and
+# the distinct pages, 2 bits per code point
+
+ERROR() {
+  printf 'error: '
+  printf -- "${@}"
+  printf '\n'
+  exit 1
+}
+
+[ -z "${1}" ] && ERROR 'missing argument: /path/to/EastAsianWidth.txt'
+[ -z "${2}" ] && ERROR 'missing argument: /path/to/DerivedGeneralCategory.txt'
+eaw_src="${1}"
+gc_src="${2}"
+
+[ -f "${eaw_src}" ] || ERROR 'file: %s does not exist' "${eaw_src}"
+[ -f "${gc_src}" ] || ERROR 'file: %s does not exist' "${gc_src}"
+
+version=$(sed -n '1s/^#[[:space:]]*//p' "${eaw_src}")
+
+cat <<EOF
+// unicode-width.h
+//
+// generated by scripts/convert-unicode-width.sh from:
+//   ${version}
+
+#if !defined(UNICODE_WIDTH_H)
+#define UNICODE_WIDTH_H 1
+
+EOF
+
+awk '
+  function hex(s,    i, n, c) {
+    n = 0
+    for (i = 1; i <= length(s); ++i) {
+      c = index("0123456789ABCDEF", toupper(substr(s, i, 1)))
+      n = n * 16 + c - 1
+    }
+    return n
+  }
+
+  # set width w for the range first..last
+  function set(first, last, w,    c) {
+    for (c = first; c <= last; ++c) {
+      width[c] = w
+    }
+  }
+
+  BEGIN {
+    # unassigned code points in these blocks default to wide
+    set(hex("3400"), hex("4DBF"), 2)
+    set(hex("4E00"), hex("9FFF"), 2)
+    set(hex("F900"), hex("FAFF"), 2)
+    set(hex("20000"), hex("2FFFD"), 2)
+    set(hex("30000"), hex("3FFFD"), 2)
+  }
+
+  # "XXXX..YYYY ; value # comment" or "XXXX ; value # comment"
+  /^[[:space:]]*[0-9A-Fa-f]/ {
+    split($0, field, "#")
+    split(field[1], part, ";")
+    gsub(/[[:space:]]/, "", part[1])
+    gsub(/[[:space:]]/, "", part[2])
+    n = split(part[1], r, "\\.\\.")
+    first = hex(r[1])
+    last = (n == 2) ? hex(r[2]) : first
+
+    if (FILENAME == eaw) {
+      if (part[2] == "W" || part[2] == "F") {
+        set(first, last, 2)
+      } else {
+        set(first, last, 1)
+      }
+    } else if (part[2] == "Mn" || part[2] == "Me" || part[2] == "Cf" ||
+               part[2] == "Cc") {
+      set(first, last, 0)
+    }
+  }
+
+  END {
+    # soft hyphen is visible, Hangul jamo join with the initial
+    set(hex("00AD"), hex("00AD"), 1)
+    set(hex("1160"), hex("11FF"), 0)
+    set(hex("D7B0"), hex("D7FF"), 0)
+
+    pages = 0
+    for (p = 0; p < 4352; ++p) {
+      key = ""
+      for (i = 0; i < 256; i += 4) {
+        b = 0
+        for (j = 3; j >= 0; --j) {
+          c = p * 256 + i + j
+          b = b * 4 + ((c in width) ? width[c] : 1)
+        }
+        key = key sprintf("0x%02x,", b)
+      }
+      if (!(key in page)) {
+        page[key] = pages
+        block[pages] = key
+        ++pages
+      }
+      index_of[p] = page[key]
+    }
+    if (pages > 256) {
+      print "too many distinct pages: " pages > "/dev/stderr"
+      exit 1
+    }
+
+    printf("// page of each 256 code points\n")
+    printf("static const uint8_t width_page[0x1100] = {\n")
+    for (p = 0; p < 4352; p += 16) {
+      line = " "
+      for (i = 0; i < 16; ++i) {
+        line = line sprintf(" %d,", index_of[p + i])
+      }
+      print line
+    }
+    printf("};\n\n")
+
+    printf("// 2 bit widths, code point 4n+k in bits 2k+1..2k of byte n\n")
+    printf("static const uint8_t width_block[%d][64] = {\n", pages)
+    for (b = 0; b < pages; ++b) {
+      n = split(block[b], v, ",")
+      printf("    {\n")
+      for (i = 0; i < 64; i += 8) {
+        line = "       "
+        for (j = 1; j <= 8; ++j) {
+          line = line " " v[i + j] ","
+        }
+        print line
+      }
+      printf("    },\n")
+    }
+    printf("};\n")
+  }
+' eaw="${eaw_src}" "${eaw_src}" "${gc_src}"
+
+cat <<EOF
+
+#endif
+EOF
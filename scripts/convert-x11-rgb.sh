@@ -1,5 +1,8 @@
 #! /bin/sh
 # convert the X11 rgb.ttx file to C header
+#
+# with -t output a minimal perfect hash table of the names instead,
+# for looking up colours at run time
 
 ERROR() {
   printf 'error: '
@@ -8,11 +11,160 @@ ERROR() {
   exit 1
 }
 
+table=no
+if [ X"${1}" = X"-t" ]
+then
+  table=yes
+  shift
+fi
+
 [ -z "${1}" ] && ERROR 'missing argument: /path/to/rgb.txt'
 rgb_src="${1}"
 
 [ -f "${rgb_src}" ] || ERROR 'file: %s does not exist' "${rgb_src}"
 
+if [ X"${table}" = X"yes" ]
+then
+  cat <<EOF
+// x11-rgb-hash.h
+//
+// generated by: scripts/convert-x11-rgb.sh -t rgb.txt
+//
+// minimal perfect hash of the normalised names: lower case without
+// spaces or underscores.  With the polynomial hash
+//
+//   h(m) = (…((0 * m + c0) * m + c1) * m + …) mod 2^32
+//
+// a name is at x11_rgb_entry[h(x11_rgb_seed[b]) % X11_RGB_ENTRIES]
+// where b = h(X11_RGB_BUCKET_SEED) % X11_RGB_BUCKETS
+
+#if !defined(X11_RGB_HASH_H)
+#define X11_RGB_HASH_H 1
+
+#include <stdint.h>
+
+EOF
+
+  awk < "${rgb_src}" '
+    function hash(s, m,    h, i) {
+      h = 0
+      for (i = 1; i <= length(s); ++i) {
+        h = (h * m + ord[substr(s, i, 1)]) % 4294967296
+      }
+      return h
+    }
+
+    BEGIN {
+      for (i = 32; i < 127; ++i) {
+        ord[sprintf("%c", i)] = i
+      }
+      n = 0
+    }
+
+    /^[[:space:]]*#/ || /^[[:space:]]*$/ {
+      next
+    }
+
+    {
+      name = $4
+      for (i = 5; i <= NF; ++i) {
+        name = name $i
+      }
+      name = tolower(name)
+      gsub(/_/, "", name)
+      rgb = $1 ", " $2 ", " $3
+      if (name in colour) {
+        if (colour[name] != rgb) {
+          print "conflicting colour: " name > "/dev/stderr"
+          exit 1
+        }
+        next
+      }
+      colour[name] = rgb
+      key[n++] = name
+    }
+
+    END {
+      bucket_seed = 31
+      buckets = int((n + 3) / 4)
+
+      # group names into buckets
+      largest = 0
+      for (i = 0; i < n; ++i) {
+        b = hash(key[i], bucket_seed) % buckets
+        member[b, size[b]++] = key[i]
+        if (size[b] > largest) {
+          largest = size[b]
+        }
+      }
+
+      # place the largest buckets first, searching for an odd multiplier
+      # that puts every member of the bucket in a free slot
+      for (s = largest; s >= 1; --s) {
+        for (b = 0; b < buckets; ++b) {
+          if (size[b] + 0 != s) {
+            continue
+          }
+          for (m = 33; ; m += 2) {
+            ok = 1
+            split("", taken)
+            for (j = 0; j < size[b]; ++j) {
+              t = hash(member[b, j], m) % n
+              if ((t in slot) || (t in taken)) {
+                ok = 0
+                break
+              }
+              taken[t] = 1
+            }
+            if (ok) {
+              break
+            }
+            if (m > 65535) {
+              print "no multiplier for bucket: " b > "/dev/stderr"
+              exit 1
+            }
+          }
+          seed[b] = m
+          for (j = 0; j < size[b]; ++j) {
+            slot[hash(member[b, j], m) % n] = member[b, j]
+          }
+        }
+      }
+
+      printf("#define X11_RGB_ENTRIES %d\n", n)
+      printf("#define X11_RGB_BUCKETS %d\n", buckets)
+      printf("#define X11_RGB_BUCKET_SEED %d\n\n", bucket_seed)
+
+      printf("static const uint16_t x11_rgb_seed[X11_RGB_BUCKETS] = {\n")
+      for (b = 0; b < buckets; b += 8) {
+        line = "   "
+        for (j = b; j < b + 8 && j < buckets; ++j) {
+          line = line sprintf(" %d,", (j in seed) ? seed[j] : 1)
+        }
+        print line
+      }
+      printf("};\n\n")
+
+      printf("static const struct {\n")
+      printf("  char name[24];\n")
+      printf("  uint8_t red;\n")
+      printf("  uint8_t green;\n")
+      printf("  uint8_t blue;\n")
+      printf("} x11_rgb_entry[X11_RGB_ENTRIES] = {\n")
+      for (t = 0; t < n; ++t) {
+        printf("    {\"%s\", %s},\n", slot[t], colour[slot[t]])
+      }
+      printf("};\n")
+    }
+  '
+
+  cat <<EOF
+
+#endif
+EOF
+  exit 0
+fi
+
 cat <<EOF
 // x11-rgb-txt.h
 
@@ -0,0 +1,47 @@
+#! /bin/sh
+# write EastAsianWidth.txt and DerivedGeneralCategory.txt in the UCD
+# file format from the Unicode tables built into perl, for running
+# convert-unicode-width.sh where the UCD files are not at hand
+#
+# the version is perl's Unicode version, e.g. perl 5.36 has 14.0.0
+
+ERROR() {
+  printf 'error: '
+  printf -- "${@}"
+  printf '\n'
+  exit 1
+}
+
+[ -z "${1}" ] && ERROR 'missing argument: /path/to/output/directory'
+dst="${1}"
+
+[ -d "${dst}" ] || ERROR 'directory: %s does not exist' "${dst}"
+
+perl -MUnicode::UCD=prop_invmap -e '
+  my ($dst) = @ARGV;
+  my $version = Unicode::UCD::UnicodeVersion();
+
+  # one "XXXX..YYYY;value" line for each range of the inversion map
+  sub dump_property {
+    my ($property, $file, $short) = @_;
+    my ($list, $map) = prop_invmap($property);
+    defined $list or die "no property: $property\n";
+    open(my $f, ">", "$dst/$file.txt") or die "$dst/$file.txt: $!\n";
+    printf $f "# %s-%s.txt rebuilt by perl %vd Unicode::UCD\n\n",
+      $file, $version, $^V;
+    for my $i (0 .. $#$list) {
+      my $first = $list->[$i];
+      my $last = ($i < $#$list) ? $list->[$i + 1] - 1 : 0x10FFFF;
+      my $value = $short->{$map->[$i]} // $map->[$i];
+      if ($first == $last) {
+        printf $f "%04X;%s\n", $first, $value;
+      } else {
+        printf $f "%04X..%04X;%s\n", $first, $last, $value;
+      }
+    }
+    close($f) or die "$dst/$file.txt: $!\n";
+  }
+
+  dump_property("East_Asian_Width", "EastAsianWidth", {"Neutral" => "N"});
+  dump_property("General_Category", "DerivedGeneralCategory", {});
+' "${dst}" || ERROR 'perl failed to write the tables'
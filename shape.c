@@ -0,0 +1,173 @@
+// shape.c
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ili9486.h"
+#include "shape.h"
+
+// pixels of coverage worked out before blending them
+#define CHUNK 256
+
+typedef enum {
+  SHAPE_LINE,
+  SHAPE_RING,
+  SHAPE_DISC,
+} kind_type;
+
+// a shape as the distance from its outline
+typedef struct {
+  kind_type kind;
+  float x0; // start of a line, or the centre
+  float y0; // ..
+  float x1; // end of a line
+  float y1; // ..
+  float radius;
+  float half; // half the width of a line or ring
+} shape_type;
+
+// how far a point is outside the edge, negative inside
+static inline float outside(const shape_type *s, float x, float y) {
+  switch (s->kind) {
+  case SHAPE_LINE: {
+    // distance to the nearest point of the segment
+    float dx = s->x1 - s->x0;
+    float dy = s->y1 - s->y0;
+    float length2 = dx * dx + dy * dy;
+    float t = 0;
+    if (length2 > 0) {
+      t = ((x - s->x0) * dx + (y - s->y0) * dy) / length2;
+      t = t < 0 ? 0 : t > 1 ? 1 : t;
+    }
+    return hypotf(x - s->x0 - t * dx, y - s->y0 - t * dy) - s->half;
+  }
+  case SHAPE_RING:
+    return fabsf(hypotf(x - s->x0, y - s->y0) - s->radius) - s->half;
+  case SHAPE_DISC:
+  default:
+    return hypotf(x - s->x0, y - s->y0) - s->radius;
+  }
+}
+
+static SHAPE_box_type intersect(const SHAPE_box_type *a,
+                                const SHAPE_box_type *b) {
+  return (SHAPE_box_type){
+      .left = a->left > b->left ? a->left : b->left,
+      .top = a->top > b->top ? a->top : b->top,
+      .right = a->right < b->right ? a->right : b->right,
+      .bottom = a->bottom < b->bottom ? a->bottom : b->bottom,
+  };
+}
+
+// box of the pixels within half a pixel of a span of coordinates
+static SHAPE_box_type box_of(float left, float top, float right,
+                             float bottom) {
+  return (SHAPE_box_type){
+      .left = (int)floorf(left - 0.5f),
+      .top = (int)floorf(top - 0.5f),
+      .right = (int)ceilf(right + 0.5f),
+      .bottom = (int)ceilf(bottom + 0.5f),
+  };
+}
+
+// blend a shape over the pixels of a box, skipping the uncovered ends
+// of each chunk of a row
+static void draw(ILI9486_type *lcd, const SHAPE_box_type *clip,
+                 const SHAPE_box_type *box, const shape_type *s,
+                 ILI9486_colour_type colour) {
+
+  SHAPE_box_type screen = {.right = ILI9486_width(lcd),
+                           .bottom = ILI9486_height(lcd)};
+  SHAPE_box_type b = intersect(box, clip);
+  b = intersect(&b, &screen);
+
+  uint8_t coverage[CHUNK];
+  for (int y = b.top; y < b.bottom; ++y) {
+    for (int x = b.left; x < b.right; x += CHUNK) {
+      int count = b.right - x < CHUNK ? b.right - x : CHUNK;
+      int first = count;
+      int last = -1;
+      for (int n = 0; n < count; ++n) {
+        // pixel centres, a full pixel of coverage from half inside
+        float d = 0.5f - outside(s, x + n + 0.5f, y + 0.5f);
+        coverage[n] = d <= 0 ? 0 : d >= 1 ? 255 : (uint8_t)(d * 255 + 0.5f);
+        if (coverage[n] != 0) {
+          first = first < n ? first : n;
+          last = n;
+        }
+      }
+      if (last >= first) {
+        ILI9486_rect_over(lcd, x + first, y, 0, 0, last - first + 1, 1,
+                          CHUNK, coverage + first, colour);
+      }
+    }
+  }
+}
+
+// true if a box holds no pixels
+bool SHAPE_empty(const SHAPE_box_type *box) {
+  return box->left >= box->right || box->top >= box->bottom;
+}
+
+// smallest box holding both
+SHAPE_box_type SHAPE_union(const SHAPE_box_type *a, const SHAPE_box_type *b) {
+  if (SHAPE_empty(a)) {
+    return *b;
+  }
+  if (SHAPE_empty(b)) {
+    return *a;
+  }
+  return (SHAPE_box_type){
+      .left = a->left < b->left ? a->left : b->left,
+      .top = a->top < b->top ? a->top : b->top,
+      .right = a->right > b->right ? a->right : b->right,
+      .bottom = a->bottom > b->bottom ? a->bottom : b->bottom,
+  };
+}
+
+// box of the pixels that a line may touch
+SHAPE_box_type SHAPE_line_box(float x0, float y0, float x1, float y1,
+                              float width) {
+  float half = width / 2;
+  return box_of(fminf(x0, x1) - half, fminf(y0, y1) - half,
+                fmaxf(x0, x1) + half, fmaxf(y0, y1) + half);
+}
+
+// box of the pixels that a disc may touch
+SHAPE_box_type SHAPE_disc_box(float x, float y, float radius) {
+  return box_of(x - radius, y - radius, x + radius, y + radius);
+}
+
+// draw a line of a width with round ends
+void SHAPE_line(ILI9486_type *lcd, const SHAPE_box_type *clip, float x0,
+                float y0, float x1, float y1, float width,
+                ILI9486_colour_type colour) {
+  shape_type s = {.kind = SHAPE_LINE,
+                  .x0 = x0,
+                  .y0 = y0,
+                  .x1 = x1,
+                  .y1 = y1,
+                  .half = width / 2};
+  SHAPE_box_type box = SHAPE_line_box(x0, y0, x1, y1, width);
+  draw(lcd, clip, &box, &s, colour);
+}
+
+// draw a circle of a radius to the middle of its width
+void SHAPE_ring(ILI9486_type *lcd, const SHAPE_box_type *clip, float x,
+                float y, float radius, float width,
+                ILI9486_colour_type colour) {
+  shape_type s = {
+      .kind = SHAPE_RING, .x0 = x, .y0 = y, .radius = radius, .half = width / 2};
+  SHAPE_box_type box = SHAPE_disc_box(x, y, radius + width / 2);
+  draw(lcd, clip, &box, &s, colour);
+}
+
+// draw a filled circle
+void SHAPE_disc(ILI9486_type *lcd, const SHAPE_box_type *clip, float x,
+                float y, float radius, ILI9486_colour_type colour) {
+  shape_type s = {.kind = SHAPE_DISC, .x0 = x, .y0 = y, .radius = radius};
+  SHAPE_box_type box = SHAPE_disc_box(x, y, radius);
+  draw(lcd, clip, &box, &s, colour);
+}
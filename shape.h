@@ -0,0 +1,55 @@
+// shape.h
+
+#if !defined(SHAPE_H)
+#define SHAPE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ili9486.h"
+
+// anti-aliased shapes
+// ===================
+//
+// lines with round ends, rings and discs blended over the internal
+// buffer, each pixel covered by how far its centre is inside the
+// shape; drawing is a row at a time through a small buffer on the
+// stack and only touches pixels inside a clip box
+
+// a box of pixels, right and bottom are exclusive
+typedef struct {
+  int left;
+  int top;
+  int right;
+  int bottom;
+} SHAPE_box_type;
+
+// functions
+// =========
+
+// true if a box holds no pixels
+bool SHAPE_empty(const SHAPE_box_type *box);
+
+// smallest box holding both, either may be empty
+SHAPE_box_type SHAPE_union(const SHAPE_box_type *a, const SHAPE_box_type *b);
+
+// box of the pixels that a line or disc may touch
+SHAPE_box_type SHAPE_line_box(float x0, float y0, float x1, float y1,
+                              float width);
+SHAPE_box_type SHAPE_disc_box(float x, float y, float radius);
+
+// draw a line of a width with round ends
+void SHAPE_line(ILI9486_type *lcd, const SHAPE_box_type *clip, float x0,
+                float y0, float x1, float y1, float width,
+                ILI9486_colour_type colour);
+
+// draw a circle of a radius to the middle of its width
+void SHAPE_ring(ILI9486_type *lcd, const SHAPE_box_type *clip, float x,
+                float y, float radius, float width,
+                ILI9486_colour_type colour);
+
+// draw a filled circle
+void SHAPE_disc(ILI9486_type *lcd, const SHAPE_box_type *clip, float x,
+                float y, float radius, ILI9486_colour_type colour);
+
+#endif
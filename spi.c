@@ -20,8 +20,6 @@ struct SPI_struct {
   SPI_addr_type addr;
   uint32_t bps;
   SPI_mode_type mode;
-  uint8_t *buffer;
-  size_t buffer_length;
 };
 
 // enable SPI access SPI fd
@@ -44,14 +42,6 @@ SPI_type *SPI_create(const char *spi_path, SPI_addr_type addr, uint32_t bps,
   spi->addr = addr;
   spi->bps = bps;
   spi->mode = mode;
-  spi->buffer = malloc(256);
-  spi->buffer_length = 256;
-
-  if (NULL == spi->buffer) {
-    warn("cannot allocate spi buffer: %s", spi_path);
-    free(spi);
-    return NULL;
-  }
 
   spi_ioctl_configure_t cfg;
   cfg.sic_addr = addr;
@@ -74,21 +64,34 @@ bool SPI_destroy(SPI_type *spi) {
   }
   close(spi->fd);
   spi->fd = -1;
-  free(spi->buffer);
-  spi->buffer = NULL;
-  spi->buffer_length = 0;
   free(spi);
   return true;
 }
 
+// change the clock rate
+bool SPI_speed(SPI_type *spi, uint32_t bps) {
+
+  spi_ioctl_configure_t cfg;
+  cfg.sic_addr = spi->addr;
+  cfg.sic_mode = spi->mode;
+  cfg.sic_speed = bps;
+
+  if (ioctl(spi->fd, SPI_IOCTL_CONFIGURE, &cfg) == -1) {
+    warn("SPI_speed error: %d", errno);
+    return false;
+  }
+  spi->bps = bps;
+  return true;
+}
+
 // internal function
-static int spi_transfer(int fd, SPI_addr_type addr, void *send, size_t slen,
-                        void *recv, size_t rlen) {
+static int spi_transfer(int fd, SPI_addr_type addr, const void *send,
+                        size_t slen, void *recv, size_t rlen) {
 
   spi_ioctl_transfer_t tr;
 
   tr.sit_addr = addr;
-  tr.sit_send = send;
+  tr.sit_send = (void *)send; // only read, the driver copies it in
   tr.sit_sendlen = slen;
   tr.sit_recv = recv;
   tr.sit_recvlen = rlen;
@@ -99,21 +102,10 @@ static int spi_transfer(int fd, SPI_addr_type addr, void *send, size_t slen,
   return 0;
 }
 
-// send a data block to SPI device
+// send a data block to SPI device, straight from the caller's buffer
 void SPI_send(SPI_type *spi, const void *buffer, size_t length) {
 
-  if (length > spi->buffer_length) {
-    free(spi->buffer);
-    spi->buffer_length = length;
-    spi->buffer = malloc(spi->buffer_length);
-    if (NULL == spi->buffer) {
-      warn("SPI: send malloc %ld bytes failure", spi->buffer_length);
-      return;
-    }
-  }
-
-  int err = spi_transfer(spi->fd, spi->addr,
-                         memcpy(spi->buffer, buffer, length), length, NULL, 0);
+  int err = spi_transfer(spi->fd, spi->addr, buffer, length, NULL, 0);
   if (err != 0) {
     warn("SPI: send error: %d", err);
   }
@@ -35,6 +35,10 @@ SPI_type *SPI_create(const char *spi_path, SPI_addr_type addr, uint32_t bps,
 // release SPI fd
 bool SPI_destroy(SPI_type *spi);
 
+// change the clock rate
+// returns false if the controller rejects it
+bool SPI_speed(SPI_type *spi, uint32_t bps);
+
 // send a data block to SPI
 void SPI_send(SPI_type *spi, const void *buffer, size_t length);
 
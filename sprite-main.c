@@ -0,0 +1,357 @@
+// sprite-main.c
+//
+// convert images to a sprite sheet in a panel's framebuffer format
+// that lcd_clock can memory map and draw without decoding anything.
+// Images are read as PAM, e.g. from PNG with: pngtopam -alphapam
+
+#include <err.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ili9486.h"
+#include "sprite.h"
+
+#define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof((a)[0]))
+
+// a sprite being built
+typedef struct {
+  SPRITE_entry_type entry;
+  uint8_t *pixels; // framebuffer format
+  uint8_t *alpha;  // NULL when every pixel is opaque
+} sprite_type;
+
+static sprite_type *sprites = NULL;
+static size_t sprite_count = 0;
+
+// the PAM tuple types understood, with their depths
+static const struct {
+  const char *name;
+  unsigned int depth;
+  bool grey;
+  bool alpha;
+} tuple_types[] = {
+    {"RGB", 3, false, false},
+    {"RGB_ALPHA", 4, false, true},
+    {"GRAYSCALE", 1, true, false},
+    {"GRAYSCALE_ALPHA", 2, true, true},
+};
+
+// read one header token, skipping comments
+static bool read_token(FILE *f, char *token, size_t size) {
+  int c;
+  for (;;) {
+    c = getc(f);
+    if (c == '#') {
+      while (c != '\n' && c != EOF) {
+        c = getc(f);
+      }
+    } else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+      break;
+    }
+  }
+  size_t n = 0;
+  while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+    if (n + 1 < size) {
+      token[n++] = c;
+    }
+    c = getc(f);
+  }
+  token[n] = '\0';
+  return n > 0;
+}
+
+// read a sample of one or two bytes scaled to 0…255
+static uint8_t read_sample(FILE *f, unsigned int maxval,
+                           const char *image_path) {
+  int c = getc(f);
+  unsigned int v = c;
+  if (c != EOF && maxval > 255) {
+    c = getc(f);
+    v = v << 8 | c;
+  }
+  if (c == EOF) {
+    errx(EXIT_FAILURE, "truncated image: %s", image_path);
+  }
+  return (v * 255 + maxval / 2) / maxval;
+}
+
+// convert a PAM image to a sprite
+static void add_image(const char *spec, ILI9486_format_type format,
+                      int verbose) {
+
+  // NAME=FILE, or FILE named after its base name without extension
+  char name[sizeof(((SPRITE_entry_type *)NULL)->name) + 1];
+  const char *image_path = spec;
+  const char *equals = strchr(spec, '=');
+  if (equals != NULL) {
+    image_path = equals + 1;
+    snprintf(name, sizeof(name), "%.*s", (int)(equals - spec), spec);
+  } else {
+    const char *base = strrchr(spec, '/');
+    base = (base == NULL) ? spec : base + 1;
+    const char *dot = strrchr(base, '.');
+    int length = (dot == NULL) ? (int)strlen(base) : (int)(dot - base);
+    snprintf(name, sizeof(name), "%.*s", length, base);
+  }
+  if (name[0] == '\0' || strlen(name) >= sizeof(name) - 1) {
+    errx(EXIT_FAILURE, "invalid sprite name: %s", spec);
+  }
+
+  FILE *f = fopen(image_path, "rb");
+  if (f == NULL) {
+    err(EXIT_FAILURE, "cannot open: %s", image_path);
+  }
+
+  char token[64];
+  if (!read_token(f, token, sizeof(token)) || strcmp(token, "P7") != 0) {
+    errx(EXIT_FAILURE, "not a PAM image: %s", image_path);
+  }
+  unsigned long width = 0;
+  unsigned long height = 0;
+  unsigned long depth = 0;
+  unsigned long maxval = 0;
+  size_t type = SIZE_OF_ARRAY(tuple_types);
+  while (read_token(f, token, sizeof(token)) && strcmp(token, "ENDHDR") != 0) {
+    char value[64];
+    if (!read_token(f, value, sizeof(value))) {
+      break;
+    }
+    if (strcmp(token, "WIDTH") == 0) {
+      width = strtoul(value, NULL, 10);
+    } else if (strcmp(token, "HEIGHT") == 0) {
+      height = strtoul(value, NULL, 10);
+    } else if (strcmp(token, "DEPTH") == 0) {
+      depth = strtoul(value, NULL, 10);
+    } else if (strcmp(token, "MAXVAL") == 0) {
+      maxval = strtoul(value, NULL, 10);
+    } else if (strcmp(token, "TUPLTYPE") == 0) {
+      for (type = 0; type < SIZE_OF_ARRAY(tuple_types); ++type) {
+        if (strcmp(value, tuple_types[type].name) == 0) {
+          break;
+        }
+      }
+    }
+  }
+  if (strcmp(token, "ENDHDR") != 0 || width == 0 || width > UINT16_MAX ||
+      height == 0 || height > UINT16_MAX || maxval == 0 || maxval > 65535 ||
+      type == SIZE_OF_ARRAY(tuple_types) || depth != tuple_types[type].depth) {
+    errx(EXIT_FAILURE, "unsupported PAM image: %s (RGB, GRAYSCALE with or "
+                       "without _ALPHA)",
+         image_path);
+  }
+
+  sprites = realloc(sprites, (sprite_count + 1) * sizeof(sprite_type));
+  if (sprites == NULL) {
+    err(EXIT_FAILURE, "cannot allocate sprites");
+  }
+  sprite_type *s = &sprites[sprite_count++];
+  memset(s, 0, sizeof(*s));
+  strlcpy(s->entry.name, name, sizeof(s->entry.name));
+  s->entry.width = width;
+  s->entry.height = height;
+
+  const size_t count = width * height;
+  const size_t bytes = SPRITE_pixel_bytes(format);
+  s->pixels = malloc(count * bytes);
+  s->alpha = malloc(count);
+  if (s->pixels == NULL || s->alpha == NULL) {
+    err(EXIT_FAILURE, "cannot allocate image: %s", image_path);
+  }
+
+  bool opaque = true;
+  for (size_t n = 0; n < count; ++n) {
+    uint8_t rgb[3];
+    rgb[0] = read_sample(f, maxval, image_path);
+    if (tuple_types[type].grey) {
+      rgb[1] = rgb[2] = rgb[0];
+    } else {
+      rgb[1] = read_sample(f, maxval, image_path);
+      rgb[2] = read_sample(f, maxval, image_path);
+    }
+    s->alpha[n] = 255;
+    if (tuple_types[type].alpha) {
+      s->alpha[n] = read_sample(f, maxval, image_path);
+    }
+    opaque = opaque && s->alpha[n] == 255;
+    SPRITE_encode(format, rgb[0], rgb[1], rgb[2], s->pixels + n * bytes);
+  }
+  fclose(f);
+
+  // an opaque sprite is drawn as a copy
+  if (opaque) {
+    free(s->alpha);
+    s->alpha = NULL;
+  }
+
+  if (verbose > 0) {
+    printf("sprite: %s  %lu×%lu  %s\n", name, width, height,
+           opaque ? "opaque" : "alpha");
+  }
+}
+
+static int compare_sprite(const void *a, const void *b) {
+  return strcmp(((const sprite_type *)a)->entry.name,
+                ((const sprite_type *)b)->entry.name);
+}
+
+static uint32_t align4(size_t n) { return (n + 3) & ~(size_t)3; }
+
+static void write_bytes(FILE *f, const void *data, size_t length,
+                        size_t *offset, const char *sheet_path) {
+  static const uint8_t zero[4] = {0};
+  while (*offset % 4 != 0) {
+    if (fwrite(zero, 1, 1, f) != 1) {
+      err(EXIT_FAILURE, "cannot write: %s", sheet_path);
+    }
+    ++*offset;
+  }
+  if (length > 0 && fwrite(data, length, 1, f) != 1) {
+    err(EXIT_FAILURE, "cannot write: %s", sheet_path);
+  }
+  *offset += length;
+}
+
+static void write_sheet(const char *sheet_path, ILI9486_format_type format) {
+
+  // names are looked up by a binary search
+  qsort(sprites, sprite_count, sizeof(sprite_type), compare_sprite);
+  for (size_t i = 1; i < sprite_count; ++i) {
+    if (strcmp(sprites[i - 1].entry.name, sprites[i].entry.name) == 0) {
+      errx(EXIT_FAILURE, "duplicate sprite name: %s", sprites[i].entry.name);
+    }
+  }
+
+  // lay out the file
+  const size_t bytes = SPRITE_pixel_bytes(format);
+  size_t offset = align4(sizeof(SPRITE_header_type));
+  const uint32_t sprite_offset = offset;
+  offset = align4(offset + sprite_count * sizeof(SPRITE_entry_type));
+  for (size_t i = 0; i < sprite_count; ++i) {
+    SPRITE_entry_type *e = &sprites[i].entry;
+    size_t count = (size_t)e->width * e->height;
+    e->pixels_offset = offset;
+    offset = align4(offset + count * bytes);
+    e->alpha_offset = 0;
+    if (sprites[i].alpha != NULL) {
+      e->alpha_offset = offset;
+      offset = align4(offset + count);
+    }
+  }
+  if (offset > UINT32_MAX) {
+    errx(EXIT_FAILURE, "sprite sheet too large: %zu bytes", offset);
+  }
+
+  SPRITE_header_type header = {
+      .magic = SPRITE_MAGIC,
+      .version = SPRITE_VERSION,
+      .byte_order = SPRITE_BYTE_ORDER,
+      .file_length = offset,
+      .format = format,
+      .sprite_count = sprite_count,
+      .sprite_offset = sprite_offset,
+  };
+
+  FILE *f = fopen(sheet_path, "wb");
+  if (f == NULL) {
+    err(EXIT_FAILURE, "cannot create: %s", sheet_path);
+  }
+
+  size_t written = 0;
+  write_bytes(f, &header, sizeof(header), &written, sheet_path);
+  for (size_t i = 0; i < sprite_count; ++i) {
+    write_bytes(f, &sprites[i].entry, sizeof(SPRITE_entry_type), &written,
+                sheet_path);
+  }
+  for (size_t i = 0; i < sprite_count; ++i) {
+    const SPRITE_entry_type *e = &sprites[i].entry;
+    size_t count = (size_t)e->width * e->height;
+    write_bytes(f, sprites[i].pixels, count * bytes, &written, sheet_path);
+    if (sprites[i].alpha != NULL) {
+      write_bytes(f, sprites[i].alpha, count, &written, sheet_path);
+    }
+  }
+  write_bytes(f, NULL, 0, &written, sheet_path); // final alignment
+
+  if (fclose(f) != 0) {
+    err(EXIT_FAILURE, "cannot write: %s", sheet_path);
+  }
+}
+
+void usage(const char *program) {
+  printf("usage: %s [options] [name=]image.pam...\n", program);
+  printf("       --help                 -h            this message\n"
+         "       --verbose              -v            more messages\n"
+         "       --output=FILE          -o FILE       sprite sheet to create\n"
+         "       --format=FORMAT        -f FORMAT     rgb666 (default, "
+         "waveshare-c) or\n"
+         "                                            rgb565 (waveshare-b, "
+         "st7796)\n");
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+
+  extern char *optarg;
+  extern int optind;
+
+  // options descriptor
+  static struct option longopts[] = {
+      {"help", no_argument, NULL, 'h'},
+      {"verbose", no_argument, NULL, 'v'},
+      {"output", required_argument, NULL, 'o'},
+      {"format", required_argument, NULL, 'f'},
+      {NULL, 0, NULL, 0}};
+
+  const char *program = "lcd_sprite";
+  int verbose = 0;
+  const char *sheet_path = NULL;
+  ILI9486_format_type format = ILI9486_FORMAT_RGB666;
+
+  int ch = 0;
+  while ((ch = getopt_long(argc, argv, "f:o:vh", longopts, NULL)) != -1)
+    switch (ch) {
+    case 'f':
+      if (strcmp(optarg, "rgb666") == 0) {
+        format = ILI9486_FORMAT_RGB666;
+      } else if (strcmp(optarg, "rgb565") == 0) {
+        format = ILI9486_FORMAT_RGB565;
+      } else {
+        errx(EXIT_FAILURE, "invalid format: %s (rgb666 or rgb565)", optarg);
+      }
+      break;
+    case 'o':
+      sheet_path = optarg;
+      break;
+    case 'v':
+      ++verbose;
+      break;
+    case 'h':
+    case '?':
+    default:
+      usage(program);
+    }
+  argc -= optind;
+  argv += optind;
+
+  if (sheet_path == NULL || argc < 1) {
+    usage(program);
+  }
+
+  for (int i = 0; i < argc; ++i) {
+    add_image(argv[i], format, verbose);
+  }
+
+  write_sheet(sheet_path, format);
+
+  for (size_t i = 0; i < sprite_count; ++i) {
+    free(sprites[i].pixels);
+    free(sprites[i].alpha);
+  }
+  free(sprites);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,264 @@
+// sprite.c
+
+#include <err.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sprite.h"
+
+// sprite sheet information
+struct SPRITE_struct {
+  const uint8_t *data;
+  size_t length;
+  const SPRITE_header_type *header;
+  const SPRITE_entry_type *sprites;
+};
+
+// bytes of a pixel in a framebuffer format
+size_t SPRITE_pixel_bytes(ILI9486_format_type format) {
+  return format == ILI9486_FORMAT_RGB565 ? 2 : 3;
+}
+
+// convert a colour to a pixel, the same layout as the panel driver's
+// RGB666_STORE and RGB565_STORE
+void SPRITE_encode(ILI9486_format_type format, uint8_t red, uint8_t green,
+                   uint8_t blue, uint8_t *pixel) {
+  if (format == ILI9486_FORMAT_RGB565) {
+    pixel[0] = (red & 0xf8) | (green >> 5);
+    pixel[1] = ((green << 3) & 0xe0) | (blue >> 3);
+  } else {
+    pixel[0] = red;
+    pixel[1] = green;
+    pixel[2] = blue;
+  }
+}
+
+// check a table lies inside the file
+static bool inside(const SPRITE_type *sheet, uint32_t offset, size_t count,
+                   size_t size) {
+  return offset % 4 == 0 && offset <= sheet->length &&
+         count <= (sheet->length - offset) / size;
+}
+
+// map a sprite sheet, returns NULL if missing or invalid
+SPRITE_type *SPRITE_open(const char *sheet_path) {
+
+  SPRITE_type *sheet = malloc(sizeof(SPRITE_type));
+  if (sheet == NULL) {
+    warn("failed to allocate sprite sheet structure");
+    return NULL;
+  }
+
+  int fd = open(sheet_path, O_RDONLY);
+  if (fd < 0) {
+    warn("cannot open sprite sheet: %s", sheet_path);
+    free(sheet);
+    return NULL;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) < 0) {
+    warn("cannot stat sprite sheet: %s", sheet_path);
+    close(fd);
+    free(sheet);
+    return NULL;
+  }
+
+  void *data = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    warn("cannot map sprite sheet: %s", sheet_path);
+    free(sheet);
+    return NULL;
+  }
+
+  sheet->data = data;
+  sheet->length = sb.st_size;
+  sheet->header = data;
+
+  const SPRITE_header_type *h = sheet->header;
+  if (sheet->length < sizeof(SPRITE_header_type) ||
+      memcmp(h->magic, SPRITE_MAGIC, sizeof(h->magic)) != 0 ||
+      h->version != SPRITE_VERSION || h->byte_order != SPRITE_BYTE_ORDER ||
+      h->file_length != sheet->length ||
+      (h->format != ILI9486_FORMAT_RGB666 &&
+       h->format != ILI9486_FORMAT_RGB565) ||
+      !inside(sheet, h->sprite_offset, h->sprite_count,
+              sizeof(SPRITE_entry_type))) {
+    warnx("invalid sprite sheet: %s", sheet_path);
+    SPRITE_close(sheet);
+    return NULL;
+  }
+  sheet->sprites =
+      (const SPRITE_entry_type *)(sheet->data + h->sprite_offset);
+
+  // names must be terminated and in order for the binary search, and
+  // every plane inside the file
+  const size_t bytes = SPRITE_pixel_bytes(h->format);
+  for (uint32_t i = 0; i < h->sprite_count; ++i) {
+    const SPRITE_entry_type *s = &sheet->sprites[i];
+    size_t size = (size_t)s->width * s->height;
+    if (memchr(s->name, '\0', sizeof(s->name)) == NULL ||
+        (i > 0 && strcmp(sheet->sprites[i - 1].name, s->name) >= 0) ||
+        !inside(sheet, s->pixels_offset, size, bytes) ||
+        (s->alpha_offset != 0 && !inside(sheet, s->alpha_offset, size, 1))) {
+      warnx("invalid sprite: %u in: %s", i, sheet_path);
+      SPRITE_close(sheet);
+      return NULL;
+    }
+  }
+
+  return sheet;
+}
+
+// unmap the sheet
+bool SPRITE_close(SPRITE_type *sheet) {
+  if (sheet == NULL) {
+    return false;
+  }
+  munmap((void *)sheet->data, sheet->length);
+  free(sheet);
+  return true;
+}
+
+// framebuffer format of the sheet's pixels
+ILI9486_format_type SPRITE_format(const SPRITE_type *sheet) {
+  return sheet->header->format;
+}
+
+// look up a sprite by name
+const SPRITE_entry_type *SPRITE_find(SPRITE_type *sheet, const char *name,
+                                     const uint8_t **pixels,
+                                     const uint8_t **alpha) {
+
+  // binary search of the sorted names
+  size_t low = 0;
+  size_t high = sheet->header->sprite_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (strcmp(sheet->sprites[mid].name, name) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == sheet->header->sprite_count ||
+      strcmp(sheet->sprites[low].name, name) != 0) {
+    return NULL;
+  }
+
+  const SPRITE_entry_type *s = &sheet->sprites[low];
+  *pixels = sheet->data + s->pixels_offset;
+  *alpha = (s->alpha_offset == 0) ? NULL : sheet->data + s->alpha_offset;
+  return s;
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stddef.h>
+
+// a sheet of two 2×2 sprites: "dot" with alpha then "sun" opaque
+typedef struct {
+  SPRITE_header_type header;
+  SPRITE_entry_type sprite[2];
+  uint8_t dot[12];
+  uint8_t dot_alpha[4];
+  uint8_t sun[12];
+} sheet_type;
+
+static void write_sheet(const char *path, size_t length) {
+
+  sheet_type sheet;
+  memset(&sheet, 0, sizeof(sheet));
+
+  sheet.header = (SPRITE_header_type){
+      .magic = SPRITE_MAGIC,
+      .version = SPRITE_VERSION,
+      .byte_order = SPRITE_BYTE_ORDER,
+      .file_length = length,
+      .format = ILI9486_FORMAT_RGB666,
+      .sprite_count = 2,
+      .sprite_offset = offsetof(sheet_type, sprite),
+  };
+  sheet.sprite[0] = (SPRITE_entry_type){
+      .name = "dot",
+      .width = 2,
+      .height = 2,
+      .pixels_offset = offsetof(sheet_type, dot),
+      .alpha_offset = offsetof(sheet_type, dot_alpha),
+  };
+  sheet.sprite[1] = (SPRITE_entry_type){
+      .name = "sun",
+      .width = 2,
+      .height = 2,
+      .pixels_offset = offsetof(sheet_type, sun),
+  };
+  for (int i = 0; i < 4; ++i) {
+    SPRITE_encode(ILI9486_FORMAT_RGB666, 255, 0, i, &sheet.dot[3 * i]);
+    sheet.dot_alpha[i] = 64 * i;
+    SPRITE_encode(ILI9486_FORMAT_RGB666, 255, 255, 0, &sheet.sun[3 * i]);
+  }
+
+  FILE *f = fopen(path, "wb");
+  assert(f != NULL);
+  assert(fwrite(&sheet, length, 1, f) == 1);
+  assert(fclose(f) == 0);
+}
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  // packed as the driver stores pixels
+  uint8_t p[3];
+  SPRITE_encode(ILI9486_FORMAT_RGB565, 0xff, 0x00, 0xff, p);
+  assert(p[0] == 0xf8 && p[1] == 0x1f);
+  SPRITE_encode(ILI9486_FORMAT_RGB565, 0x00, 0xff, 0x00, p);
+  assert(p[0] == 0x07 && p[1] == 0xe0);
+  assert(SPRITE_pixel_bytes(ILI9486_FORMAT_RGB565) == 2);
+  assert(SPRITE_pixel_bytes(ILI9486_FORMAT_RGB666) == 3);
+
+  char path[] = "/tmp/test_sprite.XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  const size_t length = sizeof(sheet_type);
+  write_sheet(path, length);
+  SPRITE_type *sheet = SPRITE_open(path);
+  assert(sheet != NULL);
+  assert(SPRITE_format(sheet) == ILI9486_FORMAT_RGB666);
+
+  const uint8_t *pixels;
+  const uint8_t *alpha;
+  const SPRITE_entry_type *s = SPRITE_find(sheet, "sun", &pixels, &alpha);
+  assert(s != NULL && s->width == 2 && s->height == 2);
+  assert(alpha == NULL);
+  assert(pixels[0] == 255 && pixels[1] == 255 && pixels[2] == 0);
+
+  s = SPRITE_find(sheet, "dot", &pixels, &alpha);
+  assert(s != NULL && alpha != NULL);
+  assert(alpha[3] == 192 && pixels[9] == 255 && pixels[11] == 3);
+
+  assert(SPRITE_find(sheet, "moon", &pixels, &alpha) == NULL);
+  assert(SPRITE_find(sheet, "", &pixels, &alpha) == NULL);
+  assert(SPRITE_close(sheet));
+
+  // a sheet cut short is refused
+  write_sheet(path, length - 4);
+  assert(SPRITE_open(path) == NULL);
+
+  unlink(path);
+  printf("sprite sheet: ok\n");
+  return 0;
+}
+#endif
@@ -0,0 +1,79 @@
+// sprite.h
+
+#if !defined(SPRITE_H)
+#define SPRITE_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "ili9486.h"
+
+// file format
+// ===========
+//
+// a sprite sheet holds named images already converted to one of the
+// panel framebuffer formats, so that drawing one is a copy or an alpha
+// blend with nothing decoded.  All values are in host byte order;
+// byte_order is checked on loading.  All offsets are from the start of
+// the file and are 4 byte aligned.
+//
+//   header
+//   sprite[sprite_count]                   sorted by name
+//   for each sprite:
+//     pixels[width × height]               framebuffer format, no padding
+//     uint8_t alpha[width × height]        only if not opaque
+
+#define SPRITE_MAGIC "LCDS"
+#define SPRITE_VERSION 1
+#define SPRITE_BYTE_ORDER 0x01020304
+
+typedef struct {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t file_length;
+  uint32_t format; // ILI9486_format_type of the pixels
+  uint32_t sprite_count;
+  uint32_t sprite_offset;
+} SPRITE_header_type;
+
+typedef struct {
+  char name[32]; // NUL terminated
+  uint16_t width;
+  uint16_t height;
+  uint32_t pixels_offset;
+  uint32_t alpha_offset; // zero for an opaque sprite
+} SPRITE_entry_type;
+
+// type to hold a loaded sprite sheet
+typedef struct SPRITE_struct SPRITE_type;
+
+// functions
+// =========
+
+// bytes of a pixel in a framebuffer format
+size_t SPRITE_pixel_bytes(ILI9486_format_type format);
+
+// convert a colour to a pixel in a framebuffer format, as the panel
+// driver stores it
+void SPRITE_encode(ILI9486_format_type format, uint8_t red, uint8_t green,
+                   uint8_t blue, uint8_t *pixel);
+
+// map a sprite sheet, returns NULL if missing or invalid
+SPRITE_type *SPRITE_open(const char *sheet_path);
+
+// unmap the sheet
+bool SPRITE_close(SPRITE_type *sheet);
+
+// framebuffer format of the sheet's pixels
+ILI9486_format_type SPRITE_format(const SPRITE_type *sheet);
+
+// look up a sprite by name
+// returns NULL if not present, otherwise sets the pixels and the alpha
+// plane, which is NULL for an opaque sprite
+const SPRITE_entry_type *SPRITE_find(SPRITE_type *sheet, const char *name,
+                                     const uint8_t **pixels,
+                                     const uint8_t **alpha);
+
+#endif
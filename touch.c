@@ -0,0 +1,589 @@
+// touch.c
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "spi.h"
+#include "touch.h"
+
+// XPT2046 control byte: start bit, channel, 12 bit differential
+#define XPT2046_X 0xd0
+#define XPT2046_Y 0x90
+#define XPT2046_Z1 0xb0
+#define XPT2046_Z2 0xc0
+
+// keep the ADC powered between conversions of a burst, this also
+// masks PENIRQ so sampling does not cause interrupts; the last
+// conversion powers down and re-enables it
+#define XPT2046_ADC_ON 0x01
+
+// samples of each axis in a burst
+#define SAMPLES 7
+
+// conversions in a burst: Z1, Z2 then the X and Y samples
+#define CONVERSIONS (2 + 2 * SAMPLES)
+
+// time between bursts while the pen is down
+#define BURST_INTERVAL_MS 10
+
+// Z1 - Z2 + 4095 at or above this is a touch
+#define PRESSURE_THRESHOLD 200
+
+// a pen down needs this many touched bursts in a row, to ignore
+// bounce as the panel layers meet
+#define PRESS_BURSTS 2
+
+// smallest movement in pixels that is reported
+#define MOVE_THRESHOLD 2
+
+// queued events, consecutive moves are merged
+#define QUEUE_SIZE 32
+
+// slow enough for the controller, which allows 2.5 MHz at most; a
+// whole burst is a single transfer of 33 bytes, about 130 µs, which
+// on a shared bus waits for at most one panel transfer to finish
+static const int spi_bps = 2000000;
+
+// touch panel information
+struct TOUCH_struct {
+  TOUCH_config_type config;
+  TOUCH_controller_type controller;
+
+  // hardware controller
+  SPI_type *spi;
+  int irq_fd; // gpioirq device
+
+  int event_pipe[2]; // readable while events are queued
+  int stop_pipe[2];  // readable when the thread should exit
+
+  pthread_t thread;
+  bool started;
+
+  // event queue, guarded by lock
+  pthread_mutex_t lock;
+  TOUCH_event_type queue[QUEUE_SIZE];
+  size_t head;
+  size_t count;
+  size_t dropped;
+};
+
+// filtered values from one burst
+typedef struct {
+  int x;
+  int y;
+  int pressure;
+} raw_type;
+
+// exchange bytes with the hardware controller
+static void spi_transfer(void *context, const uint8_t *send,
+                         uint8_t *received, size_t length) {
+  SPI_read(context, send, received, length);
+}
+
+static int compare_int(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+// mean of the middle three values, so noise spikes at either end
+// are dropped
+static int middle_mean(int *value, size_t count) {
+  qsort(value, count, sizeof(value[0]), compare_int);
+  size_t mid = count / 2;
+  return (value[mid - 1] + value[mid] + value[mid + 1] + 1) / 3;
+}
+
+// sample the controller once
+// returns true if the panel is touched
+static bool burst(TOUCH_type *touch, raw_type *raw) {
+
+  // in 16 clocks per conversion mode each control byte is sent while
+  // the previous result is clocked out, result i is in bytes 2i+1 and
+  // 2i+2 as a leading zero bit, 12 bits and three zero bits
+  uint8_t send[2 * CONVERSIONS + 1];
+  uint8_t received[sizeof(send)];
+  memset(send, 0, sizeof(send));
+
+  size_t n = 0;
+  send[2 * n++] = XPT2046_Z1 | XPT2046_ADC_ON;
+  send[2 * n++] = XPT2046_Z2 | XPT2046_ADC_ON;
+  for (size_t i = 0; i < SAMPLES; ++i) {
+    send[2 * n++] = XPT2046_X | XPT2046_ADC_ON;
+  }
+  for (size_t i = 0; i < SAMPLES; ++i) {
+    send[2 * n++] = XPT2046_Y | XPT2046_ADC_ON;
+  }
+  send[2 * (n - 1)] &= ~XPT2046_ADC_ON;
+
+  touch->controller.transfer(touch->controller.context, send, received,
+                             sizeof(received));
+
+  int value[CONVERSIONS];
+  for (size_t i = 0; i < CONVERSIONS; ++i) {
+    value[i] = ((received[2 * i + 1] << 8 | received[2 * i + 2]) >> 3) & 0xfff;
+  }
+
+  int pressure = value[0] - value[1] + 4095;
+  raw->pressure = (pressure < 0) ? 0 : (pressure > 4095) ? 4095 : pressure;
+  raw->x = middle_mean(&value[2], SAMPLES);
+  raw->y = middle_mean(&value[2 + SAMPLES], SAMPLES);
+
+  return raw->pressure >= PRESSURE_THRESHOLD;
+}
+
+// clip a coordinate to the screen
+static int clip(double v, int size) {
+  if (v < 0) {
+    return 0;
+  }
+  if (v > size - 1) {
+    return size - 1;
+  }
+  return (int)(v + 0.5);
+}
+
+// map controller values to screen pixels
+static void calibrate(const TOUCH_config_type *config,
+                      TOUCH_event_type *event) {
+  const TOUCH_calibration_type *c = &config->calibration;
+  event->x = clip(c->xx * event->raw_x + c->xy * event->raw_y + c->x0,
+                  config->width);
+  event->y = clip(c->yx * event->raw_x + c->yy * event->raw_y + c->y0,
+                  config->height);
+}
+
+// add an event to the queue and wake the main loop
+static void queue_event(TOUCH_type *touch, const TOUCH_event_type *event) {
+
+  pthread_mutex_lock(&touch->lock);
+
+  // a move replaces a move that has not been taken yet, and when the
+  // queue is full a release or press replaces a trailing move
+  TOUCH_event_type *tail =
+      (touch->count == 0)
+          ? NULL
+          : &touch->queue[(touch->head + touch->count - 1) % QUEUE_SIZE];
+  if (tail != NULL && tail->action == TOUCH_MOVE &&
+      (event->action == TOUCH_MOVE || touch->count == QUEUE_SIZE)) {
+    *tail = *event;
+  } else if (touch->count == QUEUE_SIZE) {
+    ++touch->dropped;
+  } else {
+    touch->queue[(touch->head + touch->count) % QUEUE_SIZE] = *event;
+    ++touch->count;
+  }
+
+  // a full pipe is already readable
+  if (write(touch->event_pipe[1], "", 1) < 0 && errno != EAGAIN) {
+    warn("touch event pipe");
+  }
+
+  pthread_mutex_unlock(&touch->lock);
+}
+
+// sleep until the interrupt descriptor (if not -1) is readable or the
+// timeout in ms (-1 for none) expires
+// returns false when the thread should exit
+static bool wait_for(TOUCH_type *touch, int fd, int timeout) {
+  struct pollfd p[2] = {
+      {.fd = touch->stop_pipe[0], .events = POLLIN},
+      {.fd = fd, .events = POLLIN},
+  };
+  if (poll(p, (fd < 0) ? 1 : 2, timeout) < 0 && errno != EINTR) {
+    warn("touch poll");
+    return false;
+  }
+  return p[0].revents == 0;
+}
+
+// consume pending interrupt edges
+static void drain(int fd) {
+  struct pollfd p = {.fd = fd, .events = POLLIN};
+  uint8_t buffer[16];
+  while (poll(&p, 1, 0) > 0 && (p.revents & POLLIN) != 0) {
+    if (read(fd, buffer, sizeof(buffer)) <= 0) {
+      break;
+    }
+  }
+}
+
+// sampling thread, sleeps until the pen goes down then samples in
+// bursts until it is lifted
+static void *touch_thread(void *arg) {
+  TOUCH_type *touch = arg;
+  int irq_fd = touch->controller.irq_fd;
+
+  while (wait_for(touch, irq_fd, -1)) {
+    drain(irq_fd);
+
+    TOUCH_event_type last = {.action = TOUCH_RELEASE};
+    int touched = 0;
+    for (;;) {
+      raw_type raw;
+      if (!burst(touch, &raw)) {
+        break;
+      }
+
+      TOUCH_event_type event = {
+          .action = TOUCH_MOVE,
+          .raw_x = raw.x,
+          .raw_y = raw.y,
+          .pressure = raw.pressure,
+      };
+      calibrate(&touch->config, &event);
+
+      if (++touched == PRESS_BURSTS) {
+        event.action = TOUCH_PRESS;
+        queue_event(touch, &event);
+        last = event;
+      } else if (touched > PRESS_BURSTS &&
+                 (abs(event.x - last.x) >= MOVE_THRESHOLD ||
+                  abs(event.y - last.y) >= MOVE_THRESHOLD)) {
+        queue_event(touch, &event);
+        last = event;
+      }
+
+      if (!wait_for(touch, -1, BURST_INTERVAL_MS)) {
+        return NULL;
+      }
+    }
+
+    // edges from here on are real presses, so there is no drain and a
+    // spurious wake only costs one burst
+    if (touched >= PRESS_BURSTS) {
+      last.action = TOUCH_RELEASE;
+      last.pressure = 0;
+      queue_event(touch, &last);
+    }
+  }
+  return NULL;
+}
+
+// start sampling a touch panel
+TOUCH_type *TOUCH_create(const TOUCH_config_type *config,
+                         const TOUCH_controller_type *controller) {
+
+  TOUCH_type *touch = calloc(1, sizeof(TOUCH_type));
+  if (touch == NULL) {
+    warn("failed to allocate touch structure");
+    return NULL;
+  }
+  touch->config = *config;
+  touch->irq_fd = -1;
+  touch->event_pipe[0] = touch->event_pipe[1] = -1;
+  touch->stop_pipe[0] = touch->stop_pipe[1] = -1;
+
+  if (pthread_mutex_init(&touch->lock, NULL) != 0) {
+    warnx("cannot create touch lock");
+    free(touch);
+    return NULL;
+  }
+
+  if (controller != NULL) {
+    touch->controller = *controller;
+  } else {
+    touch->spi = SPI_create(config->spi_device, config->spi_address, spi_bps,
+                            SPI_MODE_0);
+    if (touch->spi == NULL) {
+      warnx("touch spi create failed");
+      TOUCH_destroy(touch);
+      return NULL;
+    }
+    touch->irq_fd = open(config->irq_device, O_RDONLY);
+    if (touch->irq_fd < 0) {
+      warn("cannot open touch interrupt: %s", config->irq_device);
+      TOUCH_destroy(touch);
+      return NULL;
+    }
+    touch->controller.context = touch->spi;
+    touch->controller.transfer = spi_transfer;
+    touch->controller.irq_fd = touch->irq_fd;
+  }
+
+  if (pipe(touch->event_pipe) != 0 || pipe(touch->stop_pipe) != 0) {
+    warn("cannot create touch pipes");
+    TOUCH_destroy(touch);
+    return NULL;
+  }
+  fcntl(touch->event_pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(touch->event_pipe[1], F_SETFL, O_NONBLOCK);
+
+  // power down with PENIRQ enabled
+  const uint8_t send[3] = {XPT2046_X};
+  uint8_t received[sizeof(send)];
+  touch->controller.transfer(touch->controller.context, send, received,
+                             sizeof(send));
+
+  if (pthread_create(&touch->thread, NULL, touch_thread, touch) != 0) {
+    warnx("cannot start touch thread");
+    TOUCH_destroy(touch);
+    return NULL;
+  }
+  touch->started = true;
+
+  return touch;
+}
+
+// stop the sampling thread and release resources
+bool TOUCH_destroy(TOUCH_type *touch) {
+
+  if (touch == NULL) {
+    return false;
+  }
+
+  bool ok = true;
+
+  if (touch->started) {
+    if (write(touch->stop_pipe[1], "", 1) != 1) {
+      warn("cannot stop touch thread");
+      ok = false;
+    } else {
+      pthread_join(touch->thread, NULL);
+    }
+  }
+
+  for (size_t i = 0; i < 2; ++i) {
+    if (touch->event_pipe[i] >= 0) {
+      close(touch->event_pipe[i]);
+    }
+    if (touch->stop_pipe[i] >= 0) {
+      close(touch->stop_pipe[i]);
+    }
+  }
+  if (touch->irq_fd >= 0) {
+    close(touch->irq_fd);
+  }
+  if (touch->spi != NULL && !SPI_destroy(touch->spi)) {
+    warn("touch spi destroy failed");
+    ok = false;
+  }
+
+  if (ok) {
+    pthread_mutex_destroy(&touch->lock);
+    free(touch);
+  }
+  return ok;
+}
+
+// descriptor that is readable while events are queued
+int TOUCH_fd(TOUCH_type *touch) {
+  return touch->event_pipe[0];
+}
+
+// take the oldest queued event
+bool TOUCH_event(TOUCH_type *touch, TOUCH_event_type *event) {
+
+  pthread_mutex_lock(&touch->lock);
+
+  bool found = touch->count > 0;
+  if (found) {
+    *event = touch->queue[touch->head];
+    touch->head = (touch->head + 1) % QUEUE_SIZE;
+    --touch->count;
+  } else {
+    // the thread writes with the lock held, so once the queue is seen
+    // empty the pipe can be emptied without losing a wake up
+    uint8_t buffer[64];
+    while (read(touch->event_pipe[0], buffer, sizeof(buffer)) > 0) {
+    }
+  }
+
+  pthread_mutex_unlock(&touch->lock);
+  return found;
+}
+
+#if TESTING
+
+#include <assert.h>
+#include <stdio.h>
+
+// a simulated XPT2046 with a pen at a raw position
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t sampled; // signalled after each burst
+  bool down;
+  int x;
+  int y;
+  unsigned int count;  // position conversions, for noise
+  unsigned int bursts; // transfers
+  int irq[2];          // pen interrupt
+} simulator_type;
+
+static void simulate(void *context, const uint8_t *send, uint8_t *received,
+                     size_t length) {
+  simulator_type *sim = context;
+
+  pthread_mutex_lock(&sim->lock);
+  memset(received, 0, length);
+  for (size_t i = 0; i + 2 < length; i += 2) {
+    if ((send[i] & 0x80) == 0) {
+      continue;
+    }
+
+    // a little noise on every position and a large spike on every
+    // seventh, which the filter must reject
+    int noise = (int)(sim->count % 5) - 2;
+    if (sim->count % 7 == 3) {
+      noise = 900;
+    }
+
+    int v = 0;
+    switch (send[i] & 0x70) {
+    case XPT2046_X & 0x70:
+      v = sim->down ? sim->x + noise : 0;
+      ++sim->count;
+      break;
+    case XPT2046_Y & 0x70:
+      v = sim->down ? sim->y + noise : 0;
+      ++sim->count;
+      break;
+    case XPT2046_Z1 & 0x70:
+      v = sim->down ? 600 : 0;
+      break;
+    case XPT2046_Z2 & 0x70:
+      v = sim->down ? 3400 : 4095;
+      break;
+    }
+    v = (v < 0) ? 0 : (v > 4095) ? 4095 : v;
+    received[i + 1] = v >> 5;
+    received[i + 2] = (v << 3) & 0xff;
+  }
+  ++sim->bursts;
+  pthread_cond_broadcast(&sim->sampled);
+  pthread_mutex_unlock(&sim->lock);
+}
+
+static void pen(simulator_type *sim, bool down, int x, int y) {
+  pthread_mutex_lock(&sim->lock);
+  bool edge = down && !sim->down;
+  sim->down = down;
+  sim->x = x;
+  sim->y = y;
+  pthread_mutex_unlock(&sim->lock);
+  if (edge) {
+    ssize_t n = write(sim->irq[1], "", 1);
+    assert(n == 1);
+    (void)n;
+  }
+}
+
+// bursts sampled so far
+static unsigned int bursts(simulator_type *sim) {
+  pthread_mutex_lock(&sim->lock);
+  unsigned int n = sim->bursts;
+  pthread_mutex_unlock(&sim->lock);
+  return n;
+}
+
+// wait until the thread has sampled n more bursts, the events of all
+// bursts before the last one are queued by then
+static void wait_bursts(simulator_type *sim, unsigned int n) {
+  pthread_mutex_lock(&sim->lock);
+  unsigned int until = sim->bursts + n;
+  while (sim->bursts < until) {
+    pthread_cond_wait(&sim->sampled, &sim->lock);
+  }
+  pthread_mutex_unlock(&sim->lock);
+}
+
+// wait on the event pipe for the next event
+static void next_event(TOUCH_type *touch, TOUCH_event_type *event) {
+  while (!TOUCH_event(touch, event)) {
+    struct pollfd p = {.fd = TOUCH_fd(touch), .events = POLLIN};
+    poll(&p, 1, -1);
+  }
+  printf("event: %d  x: %3d  y: %3d  raw: %4d %4d  pressure: %4d\n",
+         event->action, event->x, event->y, event->raw_x, event->raw_y,
+         event->pressure);
+}
+
+int main(int argc, char *argv[]) {
+
+  (void)argc;
+  (void)argv;
+
+  static simulator_type sim;
+  int rc = pthread_mutex_init(&sim.lock, NULL);
+  assert(rc == 0);
+  rc = pthread_cond_init(&sim.sampled, NULL);
+  assert(rc == 0);
+  rc = pipe(sim.irq);
+  assert(rc == 0);
+  (void)rc;
+
+  TOUCH_controller_type controller = {
+      .context = &sim,
+      .transfer = simulate,
+      .irq_fd = sim.irq[0],
+  };
+  TOUCH_config_type config = {
+      .width = 480,
+      .height = 320,
+      .calibration = {.xx = 0.1, .x0 = 100.0, .yy = 0.1, .y0 = -50.0},
+  };
+
+  TOUCH_type *touch = TOUCH_create(&config, &controller);
+  assert(touch != NULL);
+
+  // nothing happens until the pen goes down
+  TOUCH_event_type event;
+  assert(!TOUCH_event(touch, &event));
+  assert(bursts(&sim) == 1); // the power down
+
+  // press with noise and spikes is reported at the pen
+  pen(&sim, true, 2000, 2000);
+  next_event(touch, &event);
+  assert(event.action == TOUCH_PRESS);
+  assert(event.x == 300 && event.y == 150);
+  assert(event.pressure == 600 - 3400 + 4095);
+
+  // holding still gives no moves
+  wait_bursts(&sim, 5);
+  assert(!TOUCH_event(touch, &event));
+
+  // drag, each position is sampled by at least one whole burst and
+  // the moves end at the new position
+  for (int x = 2000; x <= 3000; x += 100) {
+    pen(&sim, true, x, 1000);
+    wait_bursts(&sim, 2);
+  }
+  do {
+    next_event(touch, &event);
+    assert(event.action == TOUCH_MOVE);
+  } while (event.x != 400);
+  assert(event.y == 50);
+
+  // lifting releases at the last position, the release is queued once
+  // the thread has stopped sampling
+  pen(&sim, false, 0, 0);
+  next_event(touch, &event);
+  assert(event.action == TOUCH_RELEASE);
+  assert(event.x == 400 && event.y == 50);
+  assert(!TOUCH_event(touch, &event));
+  unsigned int idle = bursts(&sim);
+
+  // clipped to the screen, and the sampling restarts with the pen
+  pen(&sim, true, 4095, 0);
+  next_event(touch, &event);
+  assert(event.action == TOUCH_PRESS);
+  assert(event.x == 479 && event.y == 0);
+  assert(bursts(&sim) > idle);
+  (void)idle;
+  pen(&sim, false, 0, 0);
+  next_event(touch, &event);
+  assert(event.action == TOUCH_RELEASE);
+
+  assert(TOUCH_destroy(touch));
+
+  return 0;
+}
+#endif
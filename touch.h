@@ -0,0 +1,100 @@
+// touch.h
+
+#if !defined(TOUCH_H)
+#define TOUCH_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// resistive touch panel
+// =====================
+//
+// an XPT2046 (ADS7846 compatible) controller shares the SPI bus with
+// the LCD on address 1 and pulls TP_IRQ low when the panel is pressed.
+// A thread sleeps on the interrupt edge, samples the controller in
+// short bursts while the pen is down and queues filtered, calibrated
+// events; the main loop waits for them on a file descriptor.
+
+// type to hold a touch panel
+typedef struct TOUCH_struct TOUCH_type;
+
+typedef enum {
+  TOUCH_PRESS,   // pen down
+  TOUCH_MOVE,    // pen moved while down
+  TOUCH_RELEASE, // pen up, at the last position
+} TOUCH_action_type;
+
+// a touch event
+typedef struct {
+  TOUCH_action_type action;
+  int x;        // screen pixels
+  int y;        // ..
+  int raw_x;    // filtered controller values, for calibration
+  int raw_y;    // ..
+  int pressure; // 0…4095, larger is firmer
+} TOUCH_event_type;
+
+// affine map from controller values to screen pixels:
+//   x = xx × raw_x + xy × raw_y + x0
+//   y = yx × raw_x + yy × raw_y + y0
+typedef struct {
+  double xx, xy, x0;
+  double yx, yy, y0;
+} TOUCH_calibration_type;
+
+// connection and calibration of a touch panel
+typedef struct {
+  const char *spi_device;             // SPI bus
+  int spi_address;                    // chip select on the bus
+  const char *irq_device;             // gpioirq(4) on TP_IRQ falling edge
+  int width;                          // screen size for clipping
+  int height;                         // ..
+  TOUCH_calibration_type calibration; // controller to screen
+} TOUCH_config_type;
+
+// the Waveshare 3.5inch RPI LCD in landscape, origin at the GPIO header
+#define TOUCH_CONFIG_WAVESHARE                                                 \
+  {                                                                            \
+    .spi_device = "/dev/spi0", .spi_address = 1,                               \
+    .irq_device = "/dev/gpioirq0", .width = 480, .height = 320,                \
+    .calibration = {                                                           \
+        .xx = 0.0, .xy = 480.0 / 3700, .x0 = -480.0 * 200 / 3700,              \
+        .yx = 320.0 / 3700, .yy = 0.0, .y0 = -320.0 * 200 / 3700,              \
+    },                                                                         \
+  }
+
+// a touch controller: the hardware, or a simulation for testing
+typedef struct {
+  void *context;
+
+  // full duplex exchange of length bytes with the controller
+  void (*transfer)(void *context, const uint8_t *send, uint8_t *received,
+                   size_t length);
+
+  // readable after each pen down edge, each read consumes an edge
+  int irq_fd;
+} TOUCH_controller_type;
+
+// functions
+// =========
+
+// start sampling a touch panel
+//
+// controller: NULL for the hardware described by config, otherwise
+//             a controller that must outlive the touch panel
+// returns NULL on failure
+TOUCH_type *TOUCH_create(const TOUCH_config_type *config,
+                         const TOUCH_controller_type *controller);
+
+// stop the sampling thread and release resources
+bool TOUCH_destroy(TOUCH_type *touch);
+
+// descriptor that is readable while events are queued, for select
+int TOUCH_fd(TOUCH_type *touch);
+
+// take the oldest queued event
+// returns false when the queue is empty
+bool TOUCH_event(TOUCH_type *touch, TOUCH_event_type *event);
+
+#endif
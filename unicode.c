@@ -1,8 +1,13 @@
 // unicode.c
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+#include "unicode-width.h"
+#include "unicode.h"
 
 // see: https://dev.to/rdentato/utf-8-strings-in-c-2-3-3kp1
 //
@@ -120,6 +125,200 @@ static uint32_t ucs4_to_packed(uint32_t codepoint) {
 }
 #endif
 
+// block processing
+// ================
+//
+// 16 bytes are classified at once to give a bit mask per byte class
+// (bit n for byte n), using SSE2 when available.  A run of pure ASCII
+// is widened directly; otherwise the masks are used to check that
+// every sequence in the block is valid, in which case it is decoded
+// without further checks.  Any block that is not entirely valid goes
+// through next_char() so the U+FFFD replacement is unchanged.  Blocks
+// are only read before the terminating NUL, the last few bytes are
+// always decoded one sequence at a time.
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define BLOCK_SIZE 16
+#define BLOCK_MASK ((1U << BLOCK_SIZE) - 1)
+
+// byte class masks of a block
+typedef struct {
+  uint32_t high;  // ≥ 0x80: not ASCII
+  uint32_t cont;  // 0x80…0xbf continuation
+  uint32_t lead2; // 0xc2…0xdf
+  uint32_t lead3; // 0xe0…0xef
+  uint32_t lead4; // 0xf0…0xf4
+  uint32_t bad;   // 0xc0, 0xc1, 0xf5…0xff never valid
+  uint32_t ge_90; // ≥ 0x90
+  uint32_t ge_a0; // ≥ 0xa0
+  uint32_t e0;    // lead bytes with restricted second byte
+  uint32_t ed;    // ..
+  uint32_t f0;    // ..
+  uint32_t f4;    // ..
+} masks_type;
+
+#if defined(__SSE2__)
+
+#define GE_MASK(v, k)                                                          \
+  ((uint32_t)_mm_movemask_epi8(                                                \
+      _mm_cmpeq_epi8(_mm_max_epu8((v), _mm_set1_epi8((char)(k))), (v))))
+#define EQ_MASK(v, k)                                                          \
+  ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8((v), _mm_set1_epi8((char)(k)))))
+
+// high mask only, enough to detect ASCII
+static inline void ascii_masks(const char *src, masks_type *m) {
+  __m128i v = _mm_loadu_si128((const __m128i *)src);
+  m->high = (uint32_t)_mm_movemask_epi8(v);
+}
+
+// all the other masks
+static inline void all_masks(const char *src, masks_type *m) {
+  __m128i v = _mm_loadu_si128((const __m128i *)src);
+  uint32_t ge_c0 = GE_MASK(v, 0xc0);
+  uint32_t ge_c2 = GE_MASK(v, 0xc2);
+  uint32_t ge_e0 = GE_MASK(v, 0xe0);
+  uint32_t ge_f0 = GE_MASK(v, 0xf0);
+  uint32_t ge_f5 = GE_MASK(v, 0xf5);
+  m->cont = m->high & ~ge_c0;
+  m->lead2 = ge_c2 & ~ge_e0;
+  m->lead3 = ge_e0 & ~ge_f0;
+  m->lead4 = ge_f0 & ~ge_f5;
+  m->bad = (ge_c0 & ~ge_c2) | ge_f5;
+  m->ge_90 = GE_MASK(v, 0x90);
+  m->ge_a0 = GE_MASK(v, 0xa0);
+  m->e0 = EQ_MASK(v, 0xe0);
+  m->ed = EQ_MASK(v, 0xed);
+  m->f0 = EQ_MASK(v, 0xf0);
+  m->f4 = EQ_MASK(v, 0xf4);
+}
+
+// widen 16 ASCII bytes to code points
+static inline void widen(const char *src, uint32_t *codepoint) {
+  __m128i v = _mm_loadu_si128((const __m128i *)src);
+  __m128i z = _mm_setzero_si128();
+  __m128i lo = _mm_unpacklo_epi8(v, z);
+  __m128i hi = _mm_unpackhi_epi8(v, z);
+  _mm_storeu_si128((__m128i *)&codepoint[0], _mm_unpacklo_epi16(lo, z));
+  _mm_storeu_si128((__m128i *)&codepoint[4], _mm_unpackhi_epi16(lo, z));
+  _mm_storeu_si128((__m128i *)&codepoint[8], _mm_unpacklo_epi16(hi, z));
+  _mm_storeu_si128((__m128i *)&codepoint[12], _mm_unpackhi_epi16(hi, z));
+}
+
+#else
+
+// portable version only detects all ASCII, checking the other byte
+// classes one at a time is slower than next_char()
+
+#define ASCII_ONLY 1
+
+// high mask only, enough to detect ASCII
+static inline void ascii_masks(const char *src, masks_type *m) {
+  uint64_t a;
+  uint64_t b;
+  memcpy(&a, src, sizeof(a));
+  memcpy(&b, src + sizeof(a), sizeof(b));
+
+  // any byte ≥ 0x80
+  const uint64_t highs = 0x8080808080808080ULL;
+  m->high = ((a | b) & highs) != 0;
+}
+
+// widen 16 ASCII bytes to code points
+static inline void widen(const char *src, uint32_t *codepoint) {
+  for (int i = 0; i < BLOCK_SIZE; ++i) {
+    codepoint[i] = (uint8_t)src[i];
+  }
+}
+
+#endif
+
+// decode the valid prefix of a block that has no NUL
+//
+// src        updated past the decoded bytes
+// codepoint  room for at least BLOCK_SIZE code points
+//
+// returns the number of code points, zero if the block does not start
+// with a valid sequence
+static size_t block_to_ucs4(const char **src, uint32_t *codepoint) {
+
+  const char *s = *src;
+  masks_type m;
+
+  ascii_masks(s, &m);
+  if (m.high == 0) {
+    widen(s, codepoint);
+    *src = s + BLOCK_SIZE;
+    return BLOCK_SIZE;
+  }
+
+#if defined(ASCII_ONLY)
+  return 0;
+#else
+
+  int end = BLOCK_SIZE;
+  uint32_t region = BLOCK_MASK;
+
+  all_masks(s, &m);
+
+  // the region to decode stops before any sequence that would run past
+  // the end of the block
+  // (bit n of region >> (length - 1) is clear if it would)
+  uint32_t crossing = region & ((m.lead2 & ~(region >> 1)) |
+                                (m.lead3 & ~(region >> 2)) |
+                                (m.lead4 & ~(region >> 3)));
+  if (crossing != 0) {
+    end = __builtin_ctz(crossing);
+    region = (1U << end) - 1;
+  }
+  if (end == 0) {
+    return 0;
+  }
+
+  // continuation bytes must be exactly those needed by the lead bytes
+  uint32_t lead2 = m.lead2 & region;
+  uint32_t lead3 = m.lead3 & region;
+  uint32_t lead4 = m.lead4 & region;
+  uint32_t need = (lead2 << 1) | (lead3 << 1) | (lead3 << 2) | (lead4 << 1) |
+                  (lead4 << 2) | (lead4 << 3);
+
+  // the second byte after these leads is restricted to reject
+  // overlong forms, surrogates and values beyond U+10FFFF
+  uint32_t restricted = ((m.e0 << 1) & ~m.ge_a0) | ((m.ed << 1) & m.ge_a0) |
+                        ((m.f0 << 1) & ~m.ge_90) | ((m.f4 << 1) & m.ge_90);
+
+  if ((need & ~region) != 0 || ((m.cont ^ need) & region) != 0 ||
+      ((m.bad | restricted) & region) != 0) {
+    return 0;
+  }
+
+  if ((m.high & region) == 0) {
+    for (int i = 0; i < end; ++i) {
+      codepoint[i] = (uint8_t)s[i];
+    }
+    *src = s + end;
+    return end;
+  }
+
+  // all valid, decode without checking
+  const char *limit = s + end;
+  size_t count = 0;
+  while (s < limit) {
+    int len = utf8_length(s);
+    uint32_t packed = 0;
+    for (int i = 0; i < len; ++i) {
+      packed = (packed << 8) | (uint8_t)(s[i]);
+    }
+    codepoint[count++] = packed_to_ucs4(packed);
+    s += len;
+  }
+  *src = s;
+  return count;
+#endif
+}
+
 // convert a NUL ('\0') terminated UTF-8 string to a series of 32 bit
 // code points
 //
@@ -139,27 +338,130 @@ bool string_to_ucs4(const char *src, uint32_t *codepoint,
 
   size_t count = 0;
   size_t max = *codepoint_length;
-
-  for (size_t i = 0; i < max && *src != '\0'; ++i) {
-    uint32_t packed = 0;
-    int len = next_char(src, &packed);
-    if (packed == 0) {
-      break;
+  const char *end = src + strlen(src);
+
+  while (count < max && *src != '\0') {
+
+    // a block at a time while there is room for a whole block and the
+    // whole block is before the NUL
+    const char *block = src;
+    if (max - count >= BLOCK_SIZE && end - src >= BLOCK_SIZE) {
+      size_t n = block_to_ucs4(&src, &codepoint[count]);
+      if (n > 0) {
+        count += n;
+        continue;
+      }
     }
 
-    codepoint[i] = packed_to_ucs4(packed);
-    ++count;
+    // otherwise one sequence at a time to the end of the block,
+    // replacing anything invalid
+    do {
+      uint32_t packed = 0;
+      int len = next_char(src, &packed);
+      if (packed == 0) {
+        break;
+      }
 
-    src += len;
+      codepoint[count] = packed_to_ucs4(packed);
+      ++count;
+
+      src += len;
+    } while (count < max && src < block + BLOCK_SIZE);
   }
   *codepoint_length = count;
   return *src == '\0';
 }
 
+// start decoding at the beginning of a string
+void utf8_cursor_init(utf8_cursor_type *cursor, const char *src) {
+  cursor->start = src;
+  cursor->current = src;
+}
+
+// decode the codepoint at the cursor and step past it
+//
+// returns false at the end of the string
+bool utf8_cursor_next(utf8_cursor_type *cursor, uint32_t *codepoint) {
+  if (*cursor->current == '\0') {
+    return false;
+  }
+  uint32_t packed = 0;
+  cursor->current += next_char(cursor->current, &packed);
+  if (codepoint != NULL) {
+    *codepoint = packed_to_ucs4(packed);
+  }
+  return true;
+}
+
+// step back one codepoint and decode it
+//
+// a valid sequence ending at the cursor is always a codepoint that
+// forward decoding would produce, anything else was decoded as a single
+// replacement character, so stepping back agrees with stepping forward
+//
+// returns false at the start of the string
+bool utf8_cursor_prev(utf8_cursor_type *cursor, uint32_t *codepoint) {
+  if (cursor->current == cursor->start) {
+    return false;
+  }
+
+  int len = 1;
+  for (int k = 4; k > 1; --k) {
+    if (cursor->current - cursor->start >= k &&
+        utf8_length(cursor->current - k) == k) {
+      uint32_t packed = 0;
+      if (next_char(cursor->current - k, &packed) == k) {
+        len = k;
+        break;
+      }
+    }
+  }
+  cursor->current -= len;
+
+  uint32_t packed = 0;
+  (void)next_char(cursor->current, &packed);
+  if (codepoint != NULL) {
+    *codepoint = packed_to_ucs4(packed);
+  }
+  return true;
+}
+
+// display cells of a code point, 0, 1 or 2
+int ucs4_width(uint32_t codepoint) {
+  if (codepoint > 0x10ffff) {
+    return 1; // shown as the replacement character
+  }
+  uint8_t b = width_block[width_page[codepoint >> 8]][(codepoint & 0xff) >> 2];
+  return (b >> ((codepoint & 3) * 2)) & 3;
+}
+
+// display cells of length codepoints
+size_t ucs4_string_width(const uint32_t *text, size_t length) {
+  size_t cells = 0;
+  for (size_t n = 0; n < length; ++n) {
+    cells += ucs4_width(text[n]);
+  }
+  return cells;
+}
+
+// display cells of a NUL terminated UTF-8 string
+size_t utf8_string_width(const char *src) {
+  utf8_cursor_type cursor;
+  utf8_cursor_init(&cursor, src);
+
+  size_t cells = 0;
+  uint32_t codepoint = 0;
+  while (utf8_cursor_next(&cursor, &codepoint)) {
+    cells += ucs4_width(codepoint);
+  }
+  return cells;
+}
+
 #if TESTING
 
 #include <assert.h>
 #include <stdio.h>
+#include <time.h>
 
 #define SIZE_OF_ARRAY(a) (sizeof(a) / sizeof((a)[0]))
 
@@ -191,6 +493,104 @@ static void test1(const char *s, const pkl_type *p, size_t p_len) {
   }
 }
 
+// the original one sequence at a time conversion, as a reference
+static bool reference_to_ucs4(const char *src, uint32_t *codepoint,
+                              size_t *codepoint_length) {
+  size_t count = 0;
+  while (count < *codepoint_length) {
+    uint32_t packed = 0;
+    int len = next_char(src, &packed);
+    if (packed == 0) {
+      break;
+    }
+    codepoint[count++] = packed_to_ucs4(packed);
+    src += len;
+  }
+  *codepoint_length = count;
+  return *src == '\0';
+}
+
+// random text biased towards sequences that are nearly valid
+static void random_text(char *buffer, size_t size) {
+  static const uint8_t bytes[] = {
+      'a',  '~',  0x7f, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf, 0xc0,
+      0xc1, 0xc2, 0xdf, 0xe0, 0xe6, 0xed, 0xef, 0xf0, 0xf4, 0xf5, 0xff,
+  };
+  for (size_t i = 0; i < size; ++i) {
+    if (rand() % 4 == 0) {
+      buffer[i] = (char)bytes[rand() % SIZE_OF_ARRAY(bytes)];
+    } else {
+      buffer[i] = (char)(' ' + rand() % 95);
+    }
+  }
+}
+
+// block conversion must exactly match the reference
+static void differential(void) {
+  char text[200];
+  uint32_t actual[sizeof(text)];
+  uint32_t expected[sizeof(text)];
+
+  for (int i = 0; i < 200000; ++i) {
+    size_t length = rand() % (sizeof(text) - 1);
+    random_text(text, length);
+    text[length] = '\0';
+    const char *start = &text[rand() % (length + 1)];
+
+    size_t limit =
+        rand() % 2 == 0 ? SIZE_OF_ARRAY(actual) : (size_t)(rand() % 40);
+    size_t actual_length = limit;
+    size_t expected_length = limit;
+    bool f = string_to_ucs4(start, actual, &actual_length);
+    bool g = reference_to_ucs4(start, expected, &expected_length);
+
+    assert(f == g);
+    assert(actual_length == expected_length);
+    assert(memcmp(actual, expected, actual_length * sizeof(uint32_t)) == 0);
+  }
+  printf("differential: pass\n");
+}
+
+static double elapsed(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// conversion rate of the block and reference versions
+static void benchmark(const char *title, const char *pattern) {
+  size_t size = 1 << 20;
+  char *text = malloc(size + 1);
+  uint32_t *codepoint = malloc(size * sizeof(uint32_t));
+  assert(text != NULL && codepoint != NULL);
+
+  size_t pattern_length = strlen(pattern);
+  for (size_t i = 0; i < size; ++i) {
+    text[i] = pattern[i % pattern_length];
+  }
+  text[size - size % pattern_length] = '\0';
+
+  const int rounds = 50;
+  bool (*convert[])(const char *, uint32_t *, size_t *) = {string_to_ucs4,
+                                                           reference_to_ucs4};
+  const char *name[] = {"block", "reference"};
+  for (size_t k = 0; k < SIZE_OF_ARRAY(convert); ++k) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < rounds; ++r) {
+      size_t length = size;
+      bool complete = convert[k](text, codepoint, &length);
+      assert(complete);
+      (void)complete;
+    }
+    double t = elapsed(&start);
+    printf("benchmark: %-8s %-10s %8.1f MB/s\n", title, name[k],
+           rounds * (size / 1e6) / t);
+  }
+  free(codepoint);
+  free(text);
+}
+
 int main(int argc, char *argv[]) {
 
   assert(packed_to_ucs4(INVALID_CHAR_PACKED) == INVALID_CHAR_CODE);
@@ -257,6 +657,60 @@ int main(int argc, char *argv[]) {
 
   assert(cp[SIZE_OF_ARRAY(cp_expected) - 1] == 0xffffffff);
 
+  // cursor must agree with string_to_ucs4 in both directions
+  const char *cursor_tests[] = {t1, t2, "\xe6\xe6\x9b\xb8\x9b", ""};
+  for (size_t t = 0; t < SIZE_OF_ARRAY(cursor_tests); ++t) {
+    uint32_t expected[20];
+    size_t expected_length = SIZE_OF_ARRAY(expected);
+    assert(string_to_ucs4(cursor_tests[t], expected, &expected_length));
+
+    utf8_cursor_type cursor;
+    utf8_cursor_init(&cursor, cursor_tests[t]);
+    uint32_t c = 0;
+    size_t n = 0;
+    while (utf8_cursor_next(&cursor, &c)) {
+      printf("%3zu: next:   0x%08x  expected: 0x%08x\n", n, c, expected[n]);
+      assert(n < expected_length && c == expected[n]);
+      ++n;
+    }
+    assert(n == expected_length);
+    while (utf8_cursor_prev(&cursor, &c)) {
+      --n;
+      printf("%3zu: prev:   0x%08x  expected: 0x%08x\n", n, c, expected[n]);
+      assert(c == expected[n]);
+    }
+    assert(n == 0 && cursor.current == cursor_tests[t]);
+  }
+
+  // cell widths
+  const struct {
+    uint32_t codepoint;
+    int width;
+  } widths[] = {
+      {'A', 1},     {0x00, 0},     {0x1b, 0},     {0xad, 1},
+      {0xdf, 1},    {0x0301, 0},   {0x1100, 2},   {0x1160, 0},
+      {0x200b, 0},  {0x3000, 2},   {0x66f8, 2},   {0xac00, 2},
+      {0xff01, 2},  {0xff61, 1},   {0xfffd, 1},   {0x1f600, 2},
+      {0x2fff0, 2}, {0xe0001, 0},  {0x10ffff, 1}, {0x110000, 1},
+  };
+  for (size_t i = 0; i < SIZE_OF_ARRAY(widths); ++i) {
+    printf("width: 0x%06x  actual: %d  expected: %d\n", widths[i].codepoint,
+           ucs4_width(widths[i].codepoint), widths[i].width);
+    assert(ucs4_width(widths[i].codepoint) == widths[i].width);
+  }
+  assert(utf8_string_width(t1) == 6);
+  assert(utf8_string_width("27-33度  多雲") == 13);
+  assert(utf8_string_width("e\xcc\x81") == 1);
+  assert(ucs4_string_width(cp_expected, SIZE_OF_ARRAY(cp_expected)) == 6);
+
+  differential();
+
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    benchmark("ascii", "The quick brown fox jumps over the lazy dog. ");
+    benchmark("mixed", "Grüße aus Köln — 日曜日 18:30 ");
+    benchmark("cjk", "二〇二六年十月十八日日曜日");
+  }
+
   return 0;
 }
 #endif
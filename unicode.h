@@ -4,6 +4,7 @@
 #define UNICODE_H 1
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 // convert a NUL ('\0') terminated UTF-8 string to a series of 32 bit
@@ -12,4 +13,33 @@
 bool string_to_ucs4(const char *src, uint32_t *codepoint,
                     size_t *codepoint_length);
 
+// a position in a NUL terminated UTF-8 string for decoding one
+// codepoint at a time in either direction
+typedef struct {
+  const char *start;   // first byte of the string
+  const char *current; // next byte to decode
+} utf8_cursor_type;
+
+// start decoding at the beginning of a string
+void utf8_cursor_init(utf8_cursor_type *cursor, const char *src);
+
+// decode the codepoint at the cursor and step past it
+// return false at the end of the string
+bool utf8_cursor_next(utf8_cursor_type *cursor, uint32_t *codepoint);
+
+// step back one codepoint and decode it
+// return false at the start of the string
+bool utf8_cursor_prev(utf8_cursor_type *cursor, uint32_t *codepoint);
+
+// display cells of a code point from the Unicode East Asian Width
+// property: 0 for combining and other zero width characters, 2 for
+// wide and fullwidth characters, otherwise 1
+int ucs4_width(uint32_t codepoint);
+
+// total display cells of length codepoints
+size_t ucs4_string_width(const uint32_t *text, size_t length);
+
+// total display cells of a NUL terminated UTF-8 string
+size_t utf8_string_width(const char *src);
+
 #endif
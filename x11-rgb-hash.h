@@ -0,0 +1,711 @@
+// x11-rgb-hash.h
+//
+// generated by: scripts/convert-x11-rgb.sh -t rgb.txt
+//
+// minimal perfect hash of the normalised names: lower case without
+// spaces or underscores.  With the polynomial hash
+//
+//   h(m) = (…((0 * m + c0) * m + c1) * m + …) mod 2^32
+//
+// a name is at x11_rgb_entry[h(x11_rgb_seed[b]) % X11_RGB_ENTRIES]
+// where b = h(X11_RGB_BUCKET_SEED) % X11_RGB_BUCKETS
+
+#if !defined(X11_RGB_HASH_H)
+#define X11_RGB_HASH_H 1
+
+#include <stdint.h>
+
+#define X11_RGB_ENTRIES 657
+#define X11_RGB_BUCKETS 165
+#define X11_RGB_BUCKET_SEED 31
+
+static const uint16_t x11_rgb_seed[X11_RGB_BUCKETS] = {
+    33, 33, 45, 529, 315, 109, 81, 61,
+    1, 85, 189, 127, 125, 59, 459, 177,
+    1, 1, 311, 37, 33, 33, 205, 341,
+    35, 35, 33, 33, 57, 49, 53, 35,
+    33, 141, 33, 49, 47, 49, 37, 283,
+    33, 621, 81, 165, 35, 145, 81, 763,
+    83, 61, 39, 79, 171, 97, 2381, 289,
+    123, 57, 471, 1245, 39, 33, 71, 81,
+    167, 433, 1913, 693, 61, 81, 35, 33,
+    213, 875, 111, 97, 393, 33, 579, 155,
+    571, 333, 85, 35, 1455, 619, 1109, 117,
+    1281, 835, 285, 43, 33, 59, 1585, 965,
+    131, 59, 49, 105, 35, 57, 135, 547,
+    73, 35, 57, 53, 879, 67, 53, 101,
+    57, 1599, 655, 69, 3125, 4825, 313, 1777,
+    261, 137, 345, 593, 119, 37, 37, 89,
+    37, 117, 35, 39, 527, 33, 33, 91,
+    2633, 2371, 35, 59, 33, 37, 881, 907,
+    379, 3187, 1351, 33, 103, 145, 41, 33,
+    185, 89, 35, 221, 159, 43, 35, 71,
+    35, 43, 37, 151, 61,
+};
+
+static const struct {
+  char name[24];
+  uint8_t red;
+  uint8_t green;
+  uint8_t blue;
+} x11_rgb_entry[X11_RGB_ENTRIES] = {
+    {"antiquewhite1", 255, 239, 219},
+    {"violetred1", 255, 62, 150},
+    {"gray31", 79, 79, 79},
+    {"maroon3", 205, 41, 144},
+    {"deeppink2", 238, 18, 137},
+    {"gray8", 20, 20, 20},
+    {"grey41", 105, 105, 105},
+    {"lightcyan4", 122, 139, 139},
+    {"gray84", 214, 214, 214},
+    {"orchid3", 205, 105, 201},
+    {"gray39", 99, 99, 99},
+    {"gray1", 3, 3, 3},
+    {"palevioletred3", 205, 104, 137},
+    {"mediumslateblue", 123, 104, 238},
+    {"gray41", 105, 105, 105},
+    {"gold2", 238, 201, 0},
+    {"firebrick4", 139, 26, 26},
+    {"blueviolet", 138, 43, 226},
+    {"khaki2", 238, 230, 133},
+    {"darkorchid2", 178, 58, 238},
+    {"lightsalmon", 255, 160, 122},
+    {"saddlebrown", 139, 69, 19},
+    {"darkslateblue", 72, 61, 139},
+    {"gray72", 184, 184, 184},
+    {"orchid", 218, 112, 214},
+    {"grey94", 240, 240, 240},
+    {"gray88", 224, 224, 224},
+    {"grey90", 229, 229, 229},
+    {"deeppink1", 255, 20, 147},
+    {"steelblue2", 92, 172, 238},
+    {"mediumorchid4", 122, 55, 139},
+    {"gray81", 207, 207, 207},
+    {"bisque2", 238, 213, 183},
+    {"gray67", 171, 171, 171},
+    {"blanchedalmond", 255, 235, 205},
+    {"darkgray", 169, 169, 169},
+    {"gray40", 102, 102, 102},
+    {"peachpuff3", 205, 175, 149},
+    {"indianred1", 255, 106, 106},
+    {"lightsteelblue1", 202, 225, 255},
+    {"lightsteelblue2", 188, 210, 238},
+    {"ivory4", 139, 139, 131},
+    {"slategray3", 159, 182, 205},
+    {"lightskyblue2", 164, 211, 238},
+    {"lightskyblue3", 141, 182, 205},
+    {"dimgrey", 105, 105, 105},
+    {"gray60", 153, 153, 153},
+    {"gray15", 38, 38, 38},
+    {"blue3", 0, 0, 205},
+    {"gray71", 181, 181, 181},
+    {"grey80", 204, 204, 204},
+    {"lightyellow1", 255, 255, 224},
+    {"grey79", 201, 201, 201},
+    {"grey23", 59, 59, 59},
+    {"grey34", 87, 87, 87},
+    {"grey86", 219, 219, 219},
+    {"mediumpurple", 147, 112, 219},
+    {"lightcyan1", 224, 255, 255},
+    {"goldenrod4", 139, 105, 20},
+    {"yellow4", 139, 139, 0},
+    {"gray26", 66, 66, 66},
+    {"grey42", 107, 107, 107},
+    {"darkorchid4", 104, 34, 139},
+    {"lightblue4", 104, 131, 139},
+    {"coral", 255, 127, 80},
+    {"grey71", 181, 181, 181},
+    {"magenta1", 255, 0, 255},
+    {"palegoldenrod", 238, 232, 170},
+    {"tan3", 205, 133, 63},
+    {"gray11", 28, 28, 28},
+    {"grey44", 112, 112, 112},
+    {"slategray4", 108, 123, 139},
+    {"lightpink", 255, 182, 193},
+    {"skyblue2", 126, 192, 238},
+    {"skyblue3", 108, 166, 205},
+    {"grey83", 212, 212, 212},
+    {"gray55", 140, 140, 140},
+    {"olivedrab4", 105, 139, 34},
+    {"lightgray", 211, 211, 211},
+    {"salmon", 250, 128, 114},
+    {"hotpink2", 238, 106, 167},
+    {"lemonchiffon1", 255, 250, 205},
+    {"yellow2", 238, 238, 0},
+    {"gray76", 194, 194, 194},
+    {"linen", 250, 240, 230},
+    {"magenta", 255, 0, 255},
+    {"darkgrey", 169, 169, 169},
+    {"gold1", 255, 215, 0},
+    {"gray99", 252, 252, 252},
+    {"palegreen4", 84, 139, 84},
+    {"seashell1", 255, 245, 238},
+    {"grey2", 5, 5, 5},
+    {"grey3", 8, 8, 8},
+    {"maroon2", 238, 48, 167},
+    {"grey10", 26, 26, 26},
+    {"brown", 165, 42, 42},
+    {"thistle4", 139, 123, 139},
+    {"orangered1", 255, 69, 0},
+    {"grey9", 23, 23, 23},
+    {"grey15", 38, 38, 38},
+    {"red1", 255, 0, 0},
+    {"lightgoldenrod3", 205, 190, 112},
+    {"aquamarine3", 102, 205, 170},
+    {"aquamarine4", 69, 139, 116},
+    {"lightyellow", 255, 255, 224},
+    {"ivory1", 255, 255, 240},
+    {"gray30", 77, 77, 77},
+    {"royalblue4", 39, 64, 139},
+    {"mediumorchid2", 209, 95, 238},
+    {"lightslategray", 119, 136, 153},
+    {"gray93", 237, 237, 237},
+    {"grey6", 15, 15, 15},
+    {"lemonchiffon2", 238, 233, 191},
+    {"lemonchiffon3", 205, 201, 165},
+    {"burlywood4", 139, 115, 85},
+    {"grey72", 184, 184, 184},
+    {"darkred", 139, 0, 0},
+    {"lightyellow2", 238, 238, 209},
+    {"dodgerblue1", 30, 144, 255},
+    {"dodgerblue2", 28, 134, 238},
+    {"paleturquoise3", 150, 205, 205},
+    {"wheat2", 238, 216, 174},
+    {"rosybrown2", 238, 180, 180},
+    {"purple3", 125, 38, 205},
+    {"brown4", 139, 35, 35},
+    {"coral2", 238, 106, 80},
+    {"olivedrab2", 179, 238, 58},
+    {"goldenrod", 218, 165, 32},
+    {"snow3", 205, 201, 201},
+    {"gray69", 176, 176, 176},
+    {"salmon4", 139, 76, 57},
+    {"white", 255, 255, 255},
+    {"paleturquoise1", 187, 255, 255},
+    {"grey21", 54, 54, 54},
+    {"grey22", 56, 56, 56},
+    {"magenta4", 139, 0, 139},
+    {"lightcyan2", 209, 238, 238},
+    {"lavender", 230, 230, 250},
+    {"grey69", 176, 176, 176},
+    {"grey60", 153, 153, 153},
+    {"grey28", 71, 71, 71},
+    {"grey31", 79, 79, 79},
+    {"mediumpurple4", 93, 71, 139},
+    {"orangered3", 205, 55, 0},
+    {"pink4", 139, 99, 108},
+    {"gray73", 186, 186, 186},
+    {"gray2", 5, 5, 5},
+    {"lightcoral", 240, 128, 128},
+    {"darkolivegreen", 85, 107, 47},
+    {"grey39", 99, 99, 99},
+    {"cadetblue3", 122, 197, 205},
+    {"skyblue1", 135, 206, 255},
+    {"cornsilk1", 255, 248, 220},
+    {"gray9", 23, 23, 23},
+    {"chartreuse1", 127, 255, 0},
+    {"darkslategray4", 82, 139, 139},
+    {"tomato3", 205, 79, 57},
+    {"mediumspringgreen", 0, 250, 154},
+    {"gray20", 51, 51, 51},
+    {"burlywood3", 205, 170, 125},
+    {"goldenrod1", 255, 193, 37},
+    {"slategray", 112, 128, 144},
+    {"gold3", 205, 173, 0},
+    {"deepskyblue3", 0, 154, 205},
+    {"gray33", 84, 84, 84},
+    {"grey24", 61, 61, 61},
+    {"antiquewhite", 250, 235, 215},
+    {"grey32", 82, 82, 82},
+    {"grey33", 84, 84, 84},
+    {"grey8", 20, 20, 20},
+    {"honeydew4", 131, 139, 131},
+    {"seagreen1", 84, 255, 159},
+    {"grey78", 199, 199, 199},
+    {"orange", 255, 165, 0},
+    {"darkseagreen1", 193, 255, 193},
+    {"seagreen4", 46, 139, 87},
+    {"antiquewhite3", 205, 192, 176},
+    {"floralwhite", 255, 250, 240},
+    {"darkorange", 255, 140, 0},
+    {"gray36", 92, 92, 92},
+    {"pink3", 205, 145, 158},
+    {"wheat3", 205, 186, 150},
+    {"plum4", 139, 102, 139},
+    {"snow4", 139, 137, 137},
+    {"seashell2", 238, 229, 222},
+    {"seashell3", 205, 197, 191},
+    {"deepskyblue", 0, 191, 255},
+    {"plum1", 255, 187, 255},
+    {"lightsalmon2", 238, 149, 114},
+    {"gray16", 41, 41, 41},
+    {"honeydew3", 193, 205, 193},
+    {"brown2", 238, 59, 59},
+    {"dimgray", 105, 105, 105},
+    {"lightblue", 173, 216, 230},
+    {"blue1", 0, 0, 255},
+    {"darkorchid1", 191, 62, 255},
+    {"grey30", 77, 77, 77},
+    {"grey68", 173, 173, 173},
+    {"gray90", 229, 229, 229},
+    {"plum", 221, 160, 221},
+    {"grey81", 207, 207, 207},
+    {"grey43", 110, 110, 110},
+    {"aquamarine", 127, 255, 212},
+    {"grey45", 115, 115, 115},
+    {"grey85", 217, 217, 217},
+    {"palevioletred1", 255, 130, 171},
+    {"grey87", 222, 222, 222},
+    {"lemonchiffon4", 139, 137, 112},
+    {"cyan2", 0, 238, 238},
+    {"snow2", 238, 233, 233},
+    {"cornflowerblue", 100, 149, 237},
+    {"yellow3", 205, 205, 0},
+    {"darksalmon", 233, 150, 122},
+    {"cadetblue1", 152, 245, 255},
+    {"deeppink3", 205, 16, 118},
+    {"gray94", 240, 240, 240},
+    {"darkslategrey", 47, 79, 79},
+    {"bisque3", 205, 183, 158},
+    {"bisque4", 139, 125, 107},
+    {"gray98", 250, 250, 250},
+    {"dodgerblue", 30, 144, 255},
+    {"mediumpurple1", 171, 130, 255},
+    {"gray66", 168, 168, 168},
+    {"ivory", 255, 255, 240},
+    {"rosybrown1", 255, 193, 193},
+    {"seagreen3", 67, 205, 128},
+    {"seashell4", 139, 134, 130},
+    {"hotpink4", 139, 58, 98},
+    {"wheat", 245, 222, 179},
+    {"grey84", 214, 214, 214},
+    {"pink1", 255, 181, 197},
+    {"lightsteelblue4", 110, 123, 139},
+    {"grey51", 130, 130, 130},
+    {"grey88", 224, 224, 224},
+    {"gray3", 8, 8, 8},
+    {"gray97", 247, 247, 247},
+    {"azure", 240, 255, 255},
+    {"gray47", 120, 120, 120},
+    {"gray14", 36, 36, 36},
+    {"grey95", 242, 242, 242},
+    {"grey96", 245, 245, 245},
+    {"chocolate2", 238, 118, 33},
+    {"darkolivegreen3", 162, 205, 90},
+    {"gray7", 18, 18, 18},
+    {"azure4", 131, 139, 139},
+    {"gray42", 107, 107, 107},
+    {"sienna2", 238, 121, 66},
+    {"turquoise4", 0, 134, 139},
+    {"chocolate", 210, 105, 30},
+    {"honeydew1", 240, 255, 240},
+    {"rosybrown4", 139, 105, 105},
+    {"gray19", 48, 48, 48},
+    {"gray4", 10, 10, 10},
+    {"darkgreen", 0, 100, 0},
+    {"thistle2", 238, 210, 238},
+    {"gray44", 112, 112, 112},
+    {"lightpink2", 238, 162, 173},
+    {"paleturquoise", 175, 238, 238},
+    {"rosybrown", 188, 143, 143},
+    {"darkslategray", 47, 79, 79},
+    {"gray68", 173, 173, 173},
+    {"springgreen1", 0, 255, 127},
+    {"gray17", 43, 43, 43},
+    {"navajowhite3", 205, 179, 139},
+    {"navajowhite4", 139, 121, 94},
+    {"grey61", 156, 156, 156},
+    {"burlywood", 222, 184, 135},
+    {"violetred3", 205, 50, 120},
+    {"grey64", 163, 163, 163},
+    {"peachpuff1", 255, 218, 185},
+    {"grey58", 148, 148, 148},
+    {"lightsalmon4", 139, 87, 66},
+    {"antiquewhite4", 139, 131, 120},
+    {"azure2", 224, 238, 238},
+    {"thistle", 216, 191, 216},
+    {"chocolate3", 205, 102, 29},
+    {"grey13", 33, 33, 33},
+    {"tan1", 255, 165, 79},
+    {"grey18", 46, 46, 46},
+    {"paleturquoise4", 102, 139, 139},
+    {"firebrick1", 255, 48, 48},
+    {"grey37", 94, 94, 94},
+    {"gray96", 245, 245, 245},
+    {"salmon3", 205, 112, 84},
+    {"gray83", 212, 212, 212},
+    {"palevioletred2", 238, 121, 159},
+    {"seashell", 255, 245, 238},
+    {"lemonchiffon", 255, 250, 205},
+    {"burlywood1", 255, 211, 155},
+    {"burlywood2", 238, 197, 145},
+    {"gray37", 94, 94, 94},
+    {"thistle3", 205, 181, 205},
+    {"lightsteelblue3", 162, 181, 205},
+    {"slategrey", 112, 128, 144},
+    {"cadetblue4", 83, 134, 139},
+    {"lightblue3", 154, 192, 205},
+    {"steelblue1", 99, 184, 255},
+    {"darkolivegreen2", 188, 238, 104},
+    {"darkseagreen3", 155, 205, 155},
+    {"gray29", 74, 74, 74},
+    {"darkviolet", 148, 0, 211},
+    {"khaki1", 255, 246, 143},
+    {"navajowhite", 255, 222, 173},
+    {"chartreuse", 127, 255, 0},
+    {"gray34", 87, 87, 87},
+    {"gray35", 89, 89, 89},
+    {"darkturquoise", 0, 206, 209},
+    {"steelblue4", 54, 100, 139},
+    {"gray53", 135, 135, 135},
+    {"indianred2", 238, 99, 99},
+    {"paleturquoise2", 174, 238, 238},
+    {"darkorange1", 255, 127, 0},
+    {"pink2", 238, 169, 184},
+    {"cyan3", 0, 205, 205},
+    {"gray59", 150, 150, 150},
+    {"skyblue4", 74, 112, 139},
+    {"chocolate4", 139, 69, 19},
+    {"oldlace", 253, 245, 230},
+    {"lightgoldenrod1", 255, 236, 139},
+    {"blue4", 0, 0, 139},
+    {"darkslategray1", 151, 255, 255},
+    {"cadetblue2", 142, 229, 238},
+    {"magenta3", 205, 0, 205},
+    {"grey20", 51, 51, 51},
+    {"tomato2", 238, 92, 66},
+    {"cornsilk2", 238, 232, 205},
+    {"pink", 255, 192, 203},
+    {"darkorchid", 153, 50, 204},
+    {"slategray1", 198, 226, 255},
+    {"gray10", 26, 26, 26},
+    {"lavenderblush3", 205, 193, 197},
+    {"darkolivegreen1", 202, 255, 112},
+    {"grey47", 120, 120, 120},
+    {"darkcyan", 0, 139, 139},
+    {"beige", 245, 245, 220},
+    {"green", 0, 255, 0},
+    {"mediumorchid3", 180, 82, 205},
+    {"navy", 0, 0, 128},
+    {"gray45", 115, 115, 115},
+    {"gray46", 117, 117, 117},
+    {"purple2", 145, 44, 238},
+    {"lightslateblue", 132, 112, 255},
+    {"violetred4", 139, 34, 82},
+    {"gold", 255, 215, 0},
+    {"goldenrod2", 238, 180, 34},
+    {"tomato1", 255, 99, 71},
+    {"cyan", 0, 255, 255},
+    {"peachpuff2", 238, 203, 173},
+    {"skyblue", 135, 206, 235},
+    {"gray57", 145, 145, 145},
+    {"grey38", 97, 97, 97},
+    {"wheat1", 255, 231, 186},
+    {"lightskyblue4", 96, 123, 139},
+    {"green4", 0, 139, 0},
+    {"purple", 160, 32, 240},
+    {"moccasin", 255, 228, 181},
+    {"indianred3", 205, 85, 85},
+    {"orchid2", 238, 122, 233},
+    {"powderblue", 176, 224, 230},
+    {"coral4", 139, 62, 47},
+    {"cornsilk4", 139, 136, 120},
+    {"peru", 205, 133, 63},
+    {"darkseagreen2", 180, 238, 180},
+    {"violetred", 208, 32, 144},
+    {"grey91", 232, 232, 232},
+    {"grey92", 235, 235, 235},
+    {"gray50", 127, 127, 127},
+    {"gray51", 130, 130, 130},
+    {"grey7", 18, 18, 18},
+    {"chartreuse3", 102, 205, 0},
+    {"grey97", 247, 247, 247},
+    {"grey98", 250, 250, 250},
+    {"gray56", 143, 143, 143},
+    {"darkorange2", 238, 118, 0},
+    {"gray58", 148, 148, 148},
+    {"darkorange4", 139, 69, 0},
+    {"lawngreen", 124, 252, 0},
+    {"darkolivegreen4", 110, 139, 61},
+    {"lightgoldenrod4", 139, 129, 76},
+    {"grey", 190, 190, 190},
+    {"mediumpurple3", 137, 104, 205},
+    {"snow", 255, 250, 250},
+    {"ghostwhite", 248, 248, 255},
+    {"lightgoldenrod2", 238, 220, 130},
+    {"azure1", 240, 255, 255},
+    {"chartreuse4", 69, 139, 0},
+    {"grey93", 237, 237, 237},
+    {"grey82", 209, 209, 209},
+    {"gray5", 13, 13, 13},
+    {"lightgoldenrod", 238, 221, 130},
+    {"midnightblue", 25, 25, 112},
+    {"deeppink", 255, 20, 147},
+    {"darkseagreen", 143, 188, 143},
+    {"gray70", 179, 179, 179},
+    {"lavenderblush2", 238, 224, 229},
+    {"orchid1", 255, 131, 250},
+    {"magenta2", 238, 0, 238},
+    {"gray86", 219, 219, 219},
+    {"gray87", 222, 222, 222},
+    {"rosybrown3", 205, 155, 155},
+    {"gray89", 227, 227, 227},
+    {"grey1", 3, 3, 3},
+    {"deepskyblue1", 0, 191, 255},
+    {"gray64", 163, 163, 163},
+    {"sienna1", 255, 130, 71},
+    {"mediumturquoise", 72, 209, 204},
+    {"darkgoldenrod1", 255, 185, 15},
+    {"red2", 238, 0, 0},
+    {"tan", 210, 180, 140},
+    {"red4", 139, 0, 0},
+    {"green2", 0, 238, 0},
+    {"bisque1", 255, 228, 196},
+    {"grey27", 69, 69, 69},
+    {"maroon4", 139, 28, 98},
+    {"deepskyblue4", 0, 104, 139},
+    {"ivory3", 205, 205, 193},
+    {"cadetblue", 95, 158, 160},
+    {"firebrick3", 205, 38, 38},
+    {"grey12", 31, 31, 31},
+    {"olivedrab3", 154, 205, 50},
+    {"coral3", 205, 91, 69},
+    {"gray85", 217, 217, 217},
+    {"lightseagreen", 32, 178, 170},
+    {"hotpink", 255, 105, 180},
+    {"navajowhite2", 238, 207, 161},
+    {"indianred", 205, 92, 92},
+    {"gainsboro", 220, 220, 220},
+    {"greenyellow", 173, 255, 47},
+    {"gray80", 204, 204, 204},
+    {"papayawhip", 255, 239, 213},
+    {"tan2", 238, 154, 73},
+    {"khaki", 240, 230, 140},
+    {"lightslategrey", 119, 136, 153},
+    {"navajowhite1", 255, 222, 173},
+    {"grey29", 74, 74, 74},
+    {"gray49", 125, 125, 125},
+    {"gray74", 189, 189, 189},
+    {"darkorchid3", 154, 50, 205},
+    {"violetred2", 238, 58, 140},
+    {"gray75", 191, 191, 191},
+    {"grey40", 102, 102, 102},
+    {"mintcream", 245, 255, 250},
+    {"blue", 0, 0, 255},
+    {"gray79", 201, 201, 201},
+    {"chartreuse2", 118, 238, 0},
+    {"gray0", 0, 0, 0},
+    {"grey46", 117, 117, 117},
+    {"gray32", 82, 82, 82},
+    {"grey48", 122, 122, 122},
+    {"cyan4", 0, 139, 139},
+    {"slateblue1", 131, 111, 255},
+    {"springgreen2", 0, 238, 118},
+    {"purple4", 85, 26, 139},
+    {"gray54", 138, 138, 138},
+    {"mediumorchid1", 224, 102, 255},
+    {"mistyrose1", 255, 228, 225},
+    {"mistyrose2", 238, 213, 210},
+    {"goldenrod3", 205, 155, 29},
+    {"mistyrose4", 139, 125, 123},
+    {"grey36", 92, 92, 92},
+    {"palegreen2", 144, 238, 144},
+    {"palegreen3", 124, 205, 124},
+    {"salmon2", 238, 130, 98},
+    {"gray21", 54, 54, 54},
+    {"royalblue1", 72, 118, 255},
+    {"grey65", 166, 166, 166},
+    {"ivory2", 238, 238, 224},
+    {"antiquewhite2", 238, 223, 204},
+    {"thistle1", 255, 225, 255},
+    {"lightsteelblue", 176, 196, 222},
+    {"gray12", 31, 31, 31},
+    {"khaki4", 139, 134, 78},
+    {"grey0", 0, 0, 0},
+    {"gray92", 235, 235, 235},
+    {"grey100", 255, 255, 255},
+    {"salmon1", 255, 140, 105},
+    {"darkgoldenrod2", 238, 173, 14},
+    {"springgreen3", 0, 205, 102},
+    {"gray23", 59, 59, 59},
+    {"wheat4", 139, 126, 102},
+    {"grey54", 138, 138, 138},
+    {"lavenderblush4", 139, 131, 134},
+    {"turquoise2", 0, 229, 238},
+    {"gray28", 71, 71, 71},
+    {"darkgoldenrod4", 139, 101, 8},
+    {"plum2", 238, 174, 238},
+    {"gray24", 61, 61, 61},
+    {"forestgreen", 34, 139, 34},
+    {"gray48", 122, 122, 122},
+    {"royalblue", 65, 105, 225},
+    {"mediumpurple2", 159, 121, 238},
+    {"turquoise1", 0, 245, 255},
+    {"lightblue2", 178, 223, 238},
+    {"turquoise3", 0, 197, 205},
+    {"grey70", 179, 179, 179},
+    {"grey52", 133, 133, 133},
+    {"mediumorchid", 186, 85, 211},
+    {"lightblue1", 191, 239, 255},
+    {"darkseagreen4", 105, 139, 105},
+    {"gray91", 232, 232, 232},
+    {"black", 0, 0, 0},
+    {"lightgreen", 144, 238, 144},
+    {"blue2", 0, 0, 238},
+    {"slategray2", 185, 211, 238},
+    {"palevioletred4", 139, 71, 93},
+    {"red3", 205, 0, 0},
+    {"gray77", 196, 196, 196},
+    {"grey53", 135, 135, 135},
+    {"grey49", 125, 125, 125},
+    {"grey16", 41, 41, 41},
+    {"orange2", 238, 154, 0},
+    {"brown3", 205, 51, 51},
+    {"grey19", 48, 48, 48},
+    {"grey59", 150, 150, 150},
+    {"steelblue3", 79, 148, 205},
+    {"gray100", 255, 255, 255},
+    {"deepskyblue2", 0, 178, 238},
+    {"grey17", 43, 43, 43},
+    {"darkorange3", 205, 102, 0},
+    {"royalblue3", 58, 95, 205},
+    {"limegreen", 50, 205, 50},
+    {"slateblue3", 105, 89, 205},
+    {"khaki3", 205, 198, 115},
+    {"seagreen", 46, 139, 87},
+    {"lightsalmon1", 255, 160, 122},
+    {"honeydew", 240, 255, 240},
+    {"red", 255, 0, 0},
+    {"firebrick", 178, 34, 34},
+    {"gray65", 166, 166, 166},
+    {"aquamarine1", 127, 255, 212},
+    {"aquamarine2", 118, 238, 198},
+    {"orange4", 139, 90, 0},
+    {"yellow1", 255, 255, 0},
+    {"sandybrown", 244, 164, 96},
+    {"chocolate1", 255, 127, 36},
+    {"gray", 190, 190, 190},
+    {"whitesmoke", 245, 245, 245},
+    {"peachpuff", 255, 218, 185},
+    {"darkgoldenrod", 184, 134, 11},
+    {"grey56", 143, 143, 143},
+    {"cornsilk3", 205, 200, 177},
+    {"maroon", 176, 48, 96},
+    {"tomato", 255, 99, 71},
+    {"lightskyblue1", 176, 226, 255},
+    {"tan4", 139, 90, 43},
+    {"grey67", 171, 171, 171},
+    {"gray82", 209, 209, 209},
+    {"lavenderblush", 255, 240, 245},
+    {"gray6", 15, 15, 15},
+    {"gray62", 158, 158, 158},
+    {"peachpuff4", 139, 119, 101},
+    {"lightpink3", 205, 140, 149},
+    {"maroon1", 255, 52, 179},
+    {"hotpink1", 255, 110, 180},
+    {"gray38", 97, 97, 97},
+    {"hotpink3", 205, 96, 144},
+    {"brown1", 255, 64, 64},
+    {"grey57", 145, 145, 145},
+    {"darkslategray3", 121, 205, 205},
+    {"grey99", 252, 252, 252},
+    {"cyan1", 0, 255, 255},
+    {"darkgoldenrod3", 205, 149, 12},
+    {"grey4", 10, 10, 10},
+    {"grey5", 13, 13, 13},
+    {"orangered2", 238, 64, 0},
+    {"gray63", 161, 161, 161},
+    {"orangered4", 139, 37, 0},
+    {"plum3", 205, 150, 205},
+    {"lightpink4", 139, 95, 101},
+    {"orange1", 255, 165, 0},
+    {"yellow", 255, 255, 0},
+    {"mediumaquamarine", 102, 205, 170},
+    {"lightgoldenrodyellow", 250, 250, 210},
+    {"firebrick2", 238, 44, 44},
+    {"purple1", 155, 48, 255},
+    {"turquoise", 64, 224, 208},
+    {"mistyrose3", 205, 183, 181},
+    {"mediumblue", 0, 0, 205},
+    {"honeydew2", 224, 238, 224},
+    {"gray95", 242, 242, 242},
+    {"gray43", 110, 110, 110},
+    {"grey35", 89, 89, 89},
+    {"orangered", 255, 69, 0},
+    {"darkkhaki", 189, 183, 107},
+    {"yellowgreen", 154, 205, 50},
+    {"sienna", 160, 82, 45},
+    {"darkmagenta", 139, 0, 139},
+    {"green3", 0, 205, 0},
+    {"mistyrose", 255, 228, 225},
+    {"lightsalmon3", 205, 129, 98},
+    {"palegreen1", 154, 255, 154},
+    {"gray13", 33, 33, 33},
+    {"sienna3", 205, 104, 57},
+    {"sienna4", 139, 71, 38},
+    {"gray78", 199, 199, 199},
+    {"mediumseagreen", 60, 179, 113},
+    {"green1", 0, 255, 0},
+    {"lightpink1", 255, 174, 185},
+    {"olivedrab1", 192, 255, 62},
+    {"springgreen4", 0, 139, 69},
+    {"springgreen", 0, 255, 127},
+    {"darkblue", 0, 0, 139},
+    {"gray61", 156, 156, 156},
+    {"palevioletred", 219, 112, 147},
+    {"navyblue", 0, 0, 128},
+    {"lightskyblue", 135, 206, 250},
+    {"lavenderblush1", 255, 240, 245},
+    {"steelblue", 70, 130, 180},
+    {"palegreen", 152, 251, 152},
+    {"lightyellow4", 139, 139, 122},
+    {"coral1", 255, 114, 86},
+    {"indianred4", 139, 58, 58},
+    {"azure3", 193, 205, 205},
+    {"grey73", 186, 186, 186},
+    {"grey74", 189, 189, 189},
+    {"grey14", 36, 36, 36},
+    {"grey76", 194, 194, 194},
+    {"lightyellow3", 205, 205, 180},
+    {"darkslategray2", 141, 238, 238},
+    {"royalblue2", 67, 110, 238},
+    {"gray18", 46, 46, 46},
+    {"lightcyan", 224, 255, 255},
+    {"grey50", 127, 127, 127},
+    {"grey75", 191, 191, 191},
+    {"tomato4", 139, 54, 38},
+    {"gray22", 56, 56, 56},
+    {"grey77", 196, 196, 196},
+    {"dodgerblue3", 24, 116, 205},
+    {"dodgerblue4", 16, 78, 139},
+    {"grey63", 161, 161, 161},
+    {"gray27", 69, 69, 69},
+    {"snow1", 255, 250, 250},
+    {"gold4", 139, 117, 0},
+    {"cornsilk", 255, 248, 220},
+    {"grey25", 64, 64, 64},
+    {"aliceblue", 240, 248, 255},
+    {"deeppink4", 139, 10, 80},
+    {"slateblue4", 71, 60, 139},
+    {"grey55", 140, 140, 140},
+    {"seagreen2", 78, 238, 148},
+    {"gray25", 64, 64, 64},
+    {"slateblue", 106, 90, 205},
+    {"bisque", 255, 228, 196},
+    {"grey62", 158, 158, 158},
+    {"orange3", 205, 133, 0},
+    {"grey11", 28, 28, 28},
+    {"lightgrey", 211, 211, 211},
+    {"grey66", 168, 168, 168},
+    {"gray52", 133, 133, 133},
+    {"slateblue2", 122, 103, 238},
+    {"lightcyan3", 180, 205, 205},
+    {"orchid4", 139, 71, 137},
+    {"grey26", 66, 66, 66},
+    {"olivedrab", 107, 142, 35},
+    {"mediumvioletred", 199, 21, 133},
+    {"violet", 238, 130, 238},
+    {"grey89", 227, 227, 227},
+};
+
+#endif